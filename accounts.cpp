@@ -25,6 +25,7 @@
 Accounts::Accounts(AWAHSipLib *parentLib, QObject *parent) : QObject(parent), m_lib(parentLib)
 {
     connect(this, &Accounts::signalSipStatus, this, &Accounts::OnsignalSipStatus);
+    m_calls.resize(PJSUA_MAX_CALLS);
 }
 
 void Accounts::createAccount(QString accountName, QString server, QString user, QString password, QString filePlayPath, QString fileRecPath, bool fileRecordRXonly, bool fixedJitterBuffer, uint fixedJitterBufferValue, QString autoconnectToBuddyUID, bool autoconnectEnable, bool hasDTMFGPIO ,QList<s_callHistory> history , QString uid)
@@ -32,8 +33,9 @@ void Accounts::createAccount(QString accountName, QString server, QString user,
     QString idUri = "\""+ accountName +"\" <sip:"+ user +"@"+ server +">";
     QString registrarUri = "sip:"+ server;
     s_account newAccount;
+    StartupSpan span(m_lib->m_Startup, "createAccount " + accountName);
     if(m_accounts.count() > 63){
-        m_lib->m_Log->writeLog(1,"CreateAccount: Account creation failed, only 64 accounts allowed!");
+        AWAHLOG(m_lib->m_Log, 1,"CreateAccount: Account creation failed, only 64 accounts allowed!");
         return;
     }
     if(uid.isEmpty())
@@ -49,7 +51,7 @@ void Accounts::createAccount(QString accountName, QString server, QString user,
         aCfg.sipConfig.authCreds.push_back(cred);
         PJAccount *account = new PJAccount(m_lib,this);
         account->create(aCfg);
-        m_lib->m_Log->writeLog(3,"Account creation successful");
+        AWAHLOG(m_lib->m_Log, 3,"Account creation successful");
         newAccount.name = accountName;
         newAccount.user = user;
         newAccount.password = password;
@@ -72,12 +74,14 @@ void Accounts::createAccount(QString accountName, QString server, QString user,
         }
         else newAccount.gpioDev = nullptr;
         m_accounts.append(newAccount);
+        m_accountsByID.insert(m_accounts.last().AccID, &m_accounts.last());
+        m_accountsByUID.insert(m_accounts.last().uid, &m_accounts.last());
         m_lib->m_Settings->saveAccConfig();
-        m_lib->m_AudioRouter->conferenceBridgeChanged();
+        m_lib->m_AudioRouter->conferenceBridgeChanged(uid);
         emit AccountsChanged(&m_accounts);
     }
     catch(Error& err){
-        m_lib->m_Log->writeLog(0,(QString("CreateAccount: Account creation failed") + err.info().c_str()));
+        AWAHLOG(m_lib->m_Log, 0,(QString("CreateAccount: Account creation failed") + err.info().c_str()));
     }
 }
 
@@ -112,11 +116,11 @@ void Accounts::modifyAccount(QString uid, QString accountName, QString server, Q
             try{
                 acc.accountPtr->modify(aCfg);
                 m_lib->m_Settings->saveAccConfig();
-                m_lib->m_AudioRouter->conferenceBridgeChanged();
+                m_lib->m_AudioRouter->conferenceBridgeChanged(uid);
                 emit AccountsChanged(&m_accounts);
             }
             catch (Error &err){
-                m_lib->m_Log->writeLog(0,(QString("ModifyAccount: failed") + err.info().c_str()));
+                AWAHLOG(m_lib->m_Log, 0,(QString("ModifyAccount: failed") + err.info().c_str()));
             }
             if(hasDTMFGPIO && acc.gpioDev == nullptr){
                  acc.gpioDev = GpioDeviceManager::instance()->create(acc);
@@ -125,7 +129,7 @@ void Accounts::modifyAccount(QString uid, QString accountName, QString server, Q
                 GpioDeviceManager::instance()->removeDevice(uid);
             }
             m_lib->m_Settings->saveAccConfig();
-            m_lib->m_AudioRouter->conferenceBridgeChanged();
+            m_lib->m_AudioRouter->conferenceBridgeChanged(uid);
             emit AccountsChanged(&m_accounts);
             break;
         }
@@ -146,32 +150,78 @@ void Accounts::removeAccount(QString uid)
         while(it.hasNext()){
             s_account &acc = it.next();
             if(acc.uid == uid){
+                for(auto& entry : m_calls){
+                    if(entry.account == &acc){
+                        entry = s_callEntry();
+                    }
+                }
+                m_accountsByID.remove(acc.AccID);
+                m_accountsByUID.remove(acc.uid);
                 it.remove();
                 break;
             }
         }
-        m_lib->m_AudioRouter->conferenceBridgeChanged();
+        m_lib->m_AudioRouter->conferenceBridgeChanged(uid);
         m_lib->m_Settings->saveAccConfig();
         emit AccountsChanged(&m_accounts);
     }
 }
 
 s_account* Accounts::getAccountByID(int ID){
-    for(auto& account : m_accounts){
-        if(account.AccID == ID){
-            return &account;
-        }
-    }
-    return nullptr;
+    return m_accountsByID.value(ID, nullptr);
 }
 
 s_account* Accounts::getAccountByUID(QString uid) {
-    for(auto& account : m_accounts){
-        if(account.uid == uid){
-            return &account;
+    return m_accountsByUID.value(uid, nullptr);
+}
+
+s_Call* Accounts::getCallByID(int callId, int AccID) const
+{
+    if(callId < 0 || callId >= m_calls.size())
+        return nullptr;
+    const s_callEntry &entry = m_calls.at(callId);
+    if(entry.call == nullptr || (AccID != PJSUA_INVALID_ID && entry.account->AccID != AccID))
+        return nullptr;
+    return entry.call;
+}
+
+s_account* Accounts::getAccountByCallID(int callId) const
+{
+    if(callId < 0 || callId >= m_calls.size())
+        return nullptr;
+    return m_calls.at(callId).account;
+}
+
+s_Call* Accounts::addCall(s_account *account, const s_Call &call)
+{
+    if(call.callId < 0 || call.callId >= m_calls.size()){
+        AWAHLOG(m_lib->m_Log, 1,QString("addCall: invalid call id %1").arg(call.callId));
+        account->CallList.append(call);
+        return &account->CallList.last();
+    }
+    if(m_calls.at(call.callId).call != nullptr){                                          // pjsua reused the id of a call we missed the disconnect of
+        removeCall(call.callId);
+    }
+    account->CallList.append(call);
+    account->CallList.last().callSeq = m_lib->m_Log->beginCall(call.callId);               // the call logs of the new call get their own sequence
+    m_calls[call.callId].account = account;
+    m_calls[call.callId].call = &account->CallList.last();
+    return m_calls[call.callId].call;
+}
+
+void Accounts::removeCall(int callId)
+{
+    s_account* account = getAccountByCallID(callId);
+    if(account == nullptr)
+        return;
+    QMutableListIterator<s_Call> i(account->CallList);
+    while(i.hasNext()){
+        if(i.next().callId == callId){
+            i.remove();
+            break;
         }
     }
-    return nullptr;
+    m_calls[callId] = s_callEntry();
 }
 
 void Accounts::makeCall(QString number, int AccID, s_codec codec)
@@ -187,11 +237,11 @@ void Accounts::makeCall(QString number, int AccID, s_codec codec)
         newCall = new PJCall(this, m_lib, m_lib->m_MessageManager, *account->accountPtr);
         CallOpParam prm(true);        // Use default call settings
         try{
-            m_lib->m_Log->writeLog(3,(QString("MakeCall: Trying to call: ") +number ));
+            AWAHLOG(m_lib->m_Log, 3,(QString("MakeCall: Trying to call: ") +number ));
             newCall->makeCall(fulladdr.toStdString(), prm);
         }
         catch(Error& err){
-            m_lib->m_Log->writeLog(1,QString("MakeCall: Call could not be made ") + err.info().c_str());
+            AWAHLOG(m_lib->m_Log, 1,QString("MakeCall: Call could not be made ") + err.info().c_str());
         }
     }
 }
@@ -209,12 +259,12 @@ void Accounts::acceptCall(int callId, int AccID)
             s_Call thisCall(account->splitterSlot);
             thisCall.callptr = newCall;
             thisCall.callId = callId;
-            m_lib->m_Log->writeLog(3,(QString("AcceptCall: Account: ") + account->name + " accepting call with ID: " + QString::number(callId)));
+            AWAHCALLLOG(m_lib->m_Log, 3, AccID, callId, (QString("AcceptCall: Account: ") + account->name + " accepting call with ID: " + QString::number(callId)));
             newCall->answer(prm);
             emit AccountsChanged(getAccounts());
         }
         catch(Error& err){
-            m_lib->m_Log->writeLog(1,(QString("AcceptCall: Account: ") + account->name + "accepting call failed: " + err.info().c_str()));
+            AWAHCALLLOG(m_lib->m_Log, 1, AccID, callId, (QString("AcceptCall: Account: ") + account->name + "accepting call failed: " + err.info().c_str()));
         }
     }
 }
@@ -223,19 +273,15 @@ void Accounts::hangupCall(int callId, int AccID)
 {
     s_account* account = getAccountByID(AccID);
     PJCall *call = nullptr;
-    QMutableListIterator<s_Call> i(account->CallList);
-    while(i.hasNext()){
-        s_Call &callentry = i.next();                    //check if its a valid
-        if(callentry.callId == callId){
-            call = callentry.callptr;
-            callentry.CallStatusCode = 8;
-            emit callStateChanged(account->AccID,0,callentry.callId,0,0,8,8,"trying to hang up",callentry.ConnectedTo);
-            break;
-        }
+    s_Call* callentry = getCallByID(callId, AccID);     //check if its a valid
+    if(callentry != nullptr){
+        call = callentry->callptr;
+        callentry->CallStatusCode = 8;
+        emit callStateChanged(account->AccID,0,callentry->callId,0,0,8,8,"trying to hang up",callentry->ConnectedTo);
     }
 
     if(account && call != Q_NULLPTR){
-        m_lib->m_Log->writeLog(3,(QString("HangupCall: Account: ") + account->name + " hang up call with ID: " + QString::number(callId)));
+        AWAHCALLLOG(m_lib->m_Log, 3, AccID, callId, (QString("HangupCall: Account: ") + account->name + " hang up call with ID: " + QString::number(callId)));
         if(callId >= 0){
             try{
                 CallInfo ci = call->getInfo();
@@ -250,11 +296,11 @@ void Accounts::hangupCall(int callId, int AccID)
                     call->hangup(prm);                                                                // callobject gets deleted in onCallState callback
                 }
                 else{
-                    m_lib->m_Log->writeLog(1, "HangupCall: Hang up call, max. calls bug");                                                   // todo check if this bug exists anymore!
+                    AWAHCALLLOG(m_lib->m_Log, 1, AccID, callId, "HangupCall: Hang up call, max. calls bug");                                                   // todo check if this bug exists anymore!
                 }
             }
             catch(Error& err){
-                m_lib->m_Log->writeLog(1,(QString("HangupCall: Hang up call failed ") + err.info().c_str()));
+                AWAHCALLLOG(m_lib->m_Log, 1, AccID, callId, (QString("HangupCall: Hang up call failed ") + err.info().c_str()));
             }
         }
     }
@@ -264,33 +310,31 @@ void Accounts::holdCall(int callId, int AccID)
 {
     s_account* account = getAccountByID(AccID);
     PJCall *m_call = Q_NULLPTR;
-
-    for (int pos = 0; pos<account->CallList.count(); pos++){       // Check if callId is valid
-        if (account->CallList.at(pos).callId == callId){
-            m_call = account->CallList.at(pos).callptr;
-        }
+    s_Call* callentry = getCallByID(callId, AccID);                 // Check if callId is valid
+    if (callentry != nullptr){
+        m_call = callentry->callptr;
     }
 
     if(account && m_call != Q_NULLPTR){
         try{
-            m_lib->m_Log->writeLog(3,(QString("HoldCall: Account: ") + account->name + " hold call with ID: " + QString::number(callId)));
+            AWAHCALLLOG(m_lib->m_Log, 3, AccID, callId, (QString("HoldCall: Account: ") + account->name + " hold call with ID: " + QString::number(callId)));
             CallOpParam prm(true);
 
             if(!m_call->isOnHold()){
-                m_lib->m_Log->writeLog(3,(QString("HoldCall: Account: ") + account->name + " set call to hold "));
+                AWAHCALLLOG(m_lib->m_Log, 3, AccID, callId, (QString("HoldCall: Account: ") + account->name + " set call to hold "));
                 m_call->setHoldTo(true);
                 prm.statusCode = PJSIP_SC_QUEUED;
                 m_call->setHold(prm);
             }
             else{
-                m_lib->m_Log->writeLog(3,(QString("HoldCall: Account: ") + account->name + " re-invite call"));
+                AWAHCALLLOG(m_lib->m_Log, 3, AccID, callId, (QString("HoldCall: Account: ") + account->name + " re-invite call"));
                 m_call->setHoldTo(false);
                 prm.opt.flag = PJSUA_CALL_UNHOLD;
                 m_call->reinvite(prm);
             }
         }
         catch(Error& err){
-            m_lib->m_Log->writeLog(1,(QString("HoldCall: Hold call failed ") + err.info().c_str()));
+            AWAHCALLLOG(m_lib->m_Log, 1, AccID, callId, (QString("HoldCall: Hold call failed ") + err.info().c_str()));
         }
     }
 }
@@ -300,22 +344,20 @@ void Accounts::transferCall(int callId, int AccID, QString destination)
 {
     s_account* account = getAccountByID(AccID);
     PJCall *m_call = Q_NULLPTR;
-
-    for (int pos = 0; pos<account->CallList.count(); pos++){       // Check if callId is valid
-        if (account->CallList.at(pos).callId == callId){
-            m_call = account->CallList.at(pos).callptr;
-        }
+    s_Call* callentry = getCallByID(callId, AccID);                 // Check if callId is valid
+    if (callentry != nullptr){
+        m_call = callentry->callptr;
     }
 
     if(account && m_call != Q_NULLPTR){
         try{
-            m_lib->m_Log->writeLog(3,(QString("TransferCall: Account: ") + account->name + " transfer call to " + destination));
+            AWAHCALLLOG(m_lib->m_Log, 3, AccID, callId, (QString("TransferCall: Account: ") + account->name + " transfer call to " + destination));
             CallOpParam prm;
             prm.statusCode = PJSIP_SC_CALL_BEING_FORWARDED;
             m_call->xfer(destination.toStdString(), prm);
         }
         catch(Error& err){
-            m_lib->m_Log->writeLog(1,(QString("TransferCall: Transfering call failed ") + err.info().c_str()));
+            AWAHCALLLOG(m_lib->m_Log, 1, AccID, callId, (QString("TransferCall: Transfering call failed ") + err.info().c_str()));
         }
     }
 }
@@ -345,13 +387,13 @@ void Accounts::sendDTMFtoAllCalls(QString Uid, char DTMFdigit)
                 try {
                     AWAHSipLib::instance()->sendDtmf(account->CallList.at(pos).callId, account->AccID,QString(DTMFdigit));
                 }  catch (Error& err) {
-                     m_lib->m_Log->writeLog(1,(QString("sendDTMF: failed ") + err.info().c_str()));
+                     AWAHLOG(m_lib->m_Log, 1,(QString("sendDTMF: failed ") + err.info().c_str()));
                 }
             }
         }
         break;
     default:
-        m_lib->m_Log->writeLog(3,(QString("sendDTMFtoAllCalls: Invalid DTMF Digit ") + QString( DTMFdigit)));
+        AWAHLOG(m_lib->m_Log, 3,(QString("sendDTMFtoAllCalls: Invalid DTMF Digit ") + QString( DTMFdigit)));
         return;
     }
 }
@@ -367,15 +409,13 @@ QJsonObject Accounts::getCallInfo(int callId, int AccID){
     CallInfo callinfo;
     pjsua_call_info ci;
 
-    for (int pos = 0; pos<account->CallList.count(); pos++){       // Check if callId is valid
-        if (account->CallList.at(pos).callId == callId && callId >= 0 && callId < (int)m_lib->epCfg.uaConfig.maxCalls){
-            try {
-                pjCall = account->CallList.at(pos).callptr;
-                PJSUA2_CHECK_EXPR( pjsua_call_get_info(callId, &ci) );
-            }  catch (Error &err) {
-                m_lib->m_Log->writeLog(0,(QString("Accounts::getCallInfo() failed") + err.info().c_str()));
-            }
-            break;          // found!
+    s_Call* callentry = getCallByID(callId, AccID);                 // Check if callId is valid
+    if (callentry != nullptr){
+        try {
+            pjCall = callentry->callptr;
+            PJSUA2_CHECK_EXPR( pjsua_call_get_info(callId, &ci) );
+        }  catch (Error &err) {
+            AWAHLOG(m_lib->m_Log, 0,(QString("Accounts::getCallInfo() failed") + err.info().c_str()));
         }
     }
 
@@ -458,20 +498,16 @@ QJsonObject Accounts::getCallInfo(int callId, int AccID){
         }
         catch(Error& err){
             callInfo["Error: "] = err.info().c_str();
-            m_lib->m_Log->writeLog(1,(QString("Callinfo: Call info failed") + err.info().c_str()));
+            AWAHLOG(m_lib->m_Log, 1,(QString("Callinfo: Call info failed") + err.info().c_str()));
         }
     }
     return callInfo;
 }
 
 QString Accounts::getSDP(int callId, int AccID){
-    s_account* account = getAccountByID(AccID);
-    if(account != nullptr){
-        for (auto & call : account->CallList){
-            if(call.callId == callId){
-                return call.SDP;
-            }
-        }
+    s_Call* call = getCallByID(callId, AccID);
+    if(call != nullptr){
+        return call->SDP;
     }
     return QString("no SDP available");
 }
@@ -547,10 +583,10 @@ void Accounts::sendPresenceStatus(int AccID, AWAHPresenceState AWAHpresence)
            account->accountPtr->setOnlineStatus(ps);
            account->presenceState = AWAHpresence;
        } catch(Error& err) {
-           m_lib->m_Log->writeLog(2,(QString("PJSUA: send presence of account: ") + account->name + " failed: " + QString::fromStdString(err.info().c_str())));
+           AWAHLOG(m_lib->m_Log, 2,(QString("PJSUA: send presence of account: ") + account->name + " failed: " + QString::fromStdString(err.info().c_str())));
            return;
        }
-       m_lib->m_Log->writeLog(4,(QString("PJSUA: send presence of account: ") + account->name + " to: " + QString::fromStdString(ps.note)));
+       AWAHLOG(m_lib->m_Log, 4,(QString("PJSUA: send presence of account: ") + account->name + " to: " + QString::fromStdString(ps.note)));
    }
 }
 
@@ -558,13 +594,7 @@ void Accounts::OncallStateChanged(int accID, int role, int callId, bool remoteof
 {
     emit callStateChanged(accID, role, callId, remoteofferer, calldur, state, lastStatusCode, statustxt, remoteUri);
     s_account* thisAccount = getAccountByID(accID);
-    s_Call* thisCall = nullptr;
-    for(auto& call : thisAccount->CallList){
-        if(call.callId == callId){
-            thisCall = &call;
-            break;
-        }
-    }
+    s_Call* thisCall = getCallByID(callId, accID);
     if(thisCall == nullptr){
         return;
     }
@@ -592,7 +622,7 @@ void Accounts::OncallStateChanged(int accID, int role, int callId, bool remoteof
     else if(state == PJSIP_INV_STATE_DISCONNECTED) {
         sendPresenceStatus(accID, online);
     }
-    m_lib->m_Log->writeLog(3,(QString("Accounts::OncallStateChanged(): Callstate of ") + remoteUri + " is  " + thisCall->CallStatusText));
+    AWAHCALLLOG(m_lib->m_Log, 3, accID, callId, (QString("Accounts::OncallStateChanged(): Callstate of ") + remoteUri + " is  " + thisCall->CallStatusText));
 }
 
 void Accounts::OnsignalSipStatus(int accId, int status, QString remoteUri)
@@ -620,8 +650,7 @@ void Accounts::CallInspector(pj_timer_heap_t *timer_heap, pj_timer_entry *entry)
     QJsonObject info;
     QList<s_account> *accounts = AWAHSipLib::instance()->m_Accounts->getAccounts();
     for(auto& account : *accounts ){                                                   // send callInfo for every call one a second
-       int accID = account.AccID;
-        for(auto& call : AWAHSipLib::instance()->m_Accounts->getAccountByID(accID)->CallList ){
+        for(auto& call : account.CallList ){
             if(call.callId < 0){
                 break;
             }
@@ -634,7 +663,7 @@ void Accounts::CallInspector(pj_timer_heap_t *timer_heap, pj_timer_entry *entry)
             if(AWAHSipLib::instance()->m_Accounts->m_MaxCallTime){                                                          // hang up calls if call time is exeeded
                 if(AWAHSipLib::instance()->m_Accounts->m_MaxCallTime*60 <= (pjCallInfo.connectDuration.sec) && pjCallInfo.remOfferer){
                     AWAHSipLib::instance()->m_Accounts->hangupCall(pjCallInfo.id,pjCallInfo.accId);
-                    AWAHSipLib::instance()->m_Log->writeLog(3,(QString("Max call time exeeded on account ")+ account.name + ": call with ID: "+ QString::number(pjCallInfo.id) +" disconnected"));
+                    AWAHLOG(AWAHSipLib::instance()->m_Log, 3,(QString("Max call time exeeded on account ")+ account.name + ": call with ID: "+ QString::number(pjCallInfo.id) +" disconnected"));
                     pj_time_val loctimeDelay;                                                       // restart Timer and return because call is deleted
                     loctimeDelay.msec=7;
                     loctimeDelay.sec=1;
@@ -648,7 +677,7 @@ void Accounts::CallInspector(pj_timer_heap_t *timer_heap, pj_timer_entry *entry)
                 call.lastJBemptyGETevent = emptyGetevent;
                 if(call.RXlostSeconds >= AWAHSipLib::instance()->m_Accounts->m_CallDisconnectRXTimeout){
                     AWAHSipLib::instance()->m_Accounts->hangupCall(pjCallInfo.id,pjCallInfo.accId);
-                    AWAHSipLib::instance()->m_Log->writeLog(3,(QString("No packets recieved for mor than 10 seconds on ")+ account.name + ": call with ID: "+ QString::number(pjCallInfo.id) +": disconnecting call"));
+                    AWAHLOG(AWAHSipLib::instance()->m_Log, 3,(QString("No packets recieved for mor than 10 seconds on ")+ account.name + ": call with ID: "+ QString::number(pjCallInfo.id) +": disconnecting call"));
                     pj_time_val loctimeDelay;                                                       // restart Timer and return because call is deleted
                     loctimeDelay.msec=7;
                     loctimeDelay.sec=1;
@@ -660,7 +689,7 @@ void Accounts::CallInspector(pj_timer_heap_t *timer_heap, pj_timer_entry *entry)
             else if(call.RXlostSeconds && pjsua_call_is_active(call.callId) != 0){    // RX media recovered
                 call.RXlostSeconds = 0;
                 emit  AWAHSipLib::instance()->m_Accounts->callStateChanged(pjCallInfo.accId, pjCallInfo.role, pjCallInfo.id, pjCallInfo.remOfferer, pjCallInfo.connectDuration.sec, 5, pjCallInfo.state , QString::fromStdString(pjCallInfo.stateText),call.ConnectedTo);
-                AWAHSipLib::instance()->m_Log->writeLog(3,(QString("Account: ")+ account.name + QString(", Call ID: ") + QString::number(pjCallInfo.id) + " RX stream locked"));
+                AWAHLOG(AWAHSipLib::instance()->m_Log, 3,(QString("Account: ")+ account.name + QString(", Call ID: ") + QString::number(pjCallInfo.id) + " RX stream locked"));
             }
         }
     }
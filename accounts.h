@@ -22,9 +22,14 @@
 #include <QObject>
 #include "types.h"
 #include <QTimer>
+#include <QHash>
+#include <QVector>
 
 class AWAHSipLib;
 
+static_assert(QTypeInfo<s_account>::isLarge || QTypeInfo<s_account>::isStatic, "Accounts relies on QList storing s_account indirectly");
+static_assert(QTypeInfo<s_Call>::isLarge || QTypeInfo<s_Call>::isStatic, "Accounts relies on QList storing s_Call indirectly");
+
 class Accounts : public QObject
 {
     Q_OBJECT
@@ -99,6 +104,32 @@ public:
     */
     s_account* getAccountByUID(QString uid);
 
+    /**
+    * @brief get a call by it's pjsua call id
+    * @param callId the ID of the call
+    * @param AccID if set the call is only returned if it belongs to this account
+    * @return the call entry from the CallList of the account or nullptr, the pointer is valid until the call is removed
+    */
+    s_Call* getCallByID(int callId, int AccID = PJSUA_INVALID_ID) const;
+
+    /**
+    * @brief get the account that owns a call
+    * @return the Account struct or nullptr
+    */
+    s_account* getAccountByCallID(int callId) const;
+
+    /**
+    * @brief add a call to the CallList of an account
+    * @return the stored call entry
+    */
+    s_Call* addCall(s_account *account, const s_Call &call);
+
+    /**
+    * @brief remove a call from the CallList of its account
+    * @param callId the ID of the call
+    */
+    void removeCall(int callId);
+
     /**
     * @brief establish a new call
     * @param number the number you like to call
@@ -198,8 +229,23 @@ private:
     /**
     * @brief All accounts are added to this list
     *       in order to save and load current setup
+    * @details QList allocates every s_account on its own (the type is large and not movable), so an account keeps
+    *       its address while other accounts are added or removed. The indices below and the pointers returned by
+    *       getAccountByID() and getAccountByUID() rely on that, the list must never be copied (a copy would detach it)
     */
     QList<s_account> m_accounts;
+    QHash<int, s_account*> m_accountsByID;
+    QHash<QString, s_account*> m_accountsByUID;
+
+    /**
+    * @brief the calls of all accounts indexed by the pjsua call id (bounded by PJSUA_MAX_CALLS)
+    * @details the entries point into the CallList of the accounts, which keeps the addresses stable like m_accounts
+    */
+    struct s_callEntry{
+        s_account *account = nullptr;
+        s_Call *call = nullptr;
+    };
+    QVector<s_callEntry> m_calls;
 
 };
 
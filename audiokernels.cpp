@@ -0,0 +1,210 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "audiokernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIOKERNELS_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIOKERNELS_NEON
+#endif
+
+#if defined(AUDIOKERNELS_SSE2)
+static inline void transpose8x8(__m128i *rows)
+{
+    __m128i a0 = _mm_unpacklo_epi16(rows[0], rows[1]);
+    __m128i a1 = _mm_unpackhi_epi16(rows[0], rows[1]);
+    __m128i a2 = _mm_unpacklo_epi16(rows[2], rows[3]);
+    __m128i a3 = _mm_unpackhi_epi16(rows[2], rows[3]);
+    __m128i a4 = _mm_unpacklo_epi16(rows[4], rows[5]);
+    __m128i a5 = _mm_unpackhi_epi16(rows[4], rows[5]);
+    __m128i a6 = _mm_unpacklo_epi16(rows[6], rows[7]);
+    __m128i a7 = _mm_unpackhi_epi16(rows[6], rows[7]);
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+    rows[0] = _mm_unpacklo_epi64(b0, b4);
+    rows[1] = _mm_unpackhi_epi64(b0, b4);
+    rows[2] = _mm_unpacklo_epi64(b1, b5);
+    rows[3] = _mm_unpackhi_epi64(b1, b5);
+    rows[4] = _mm_unpacklo_epi64(b2, b6);
+    rows[5] = _mm_unpackhi_epi64(b2, b6);
+    rows[6] = _mm_unpacklo_epi64(b3, b7);
+    rows[7] = _mm_unpackhi_epi64(b3, b7);
+}
+#elif defined(AUDIOKERNELS_NEON)
+static inline void transpose8x8(int16x8_t *rows)
+{
+    int16x8x2_t a0 = vtrnq_s16(rows[0], rows[1]);
+    int16x8x2_t a1 = vtrnq_s16(rows[2], rows[3]);
+    int16x8x2_t a2 = vtrnq_s16(rows[4], rows[5]);
+    int16x8x2_t a3 = vtrnq_s16(rows[6], rows[7]);
+    int32x4x2_t b0 = vtrnq_s32(vreinterpretq_s32_s16(a0.val[0]), vreinterpretq_s32_s16(a1.val[0]));
+    int32x4x2_t b1 = vtrnq_s32(vreinterpretq_s32_s16(a0.val[1]), vreinterpretq_s32_s16(a1.val[1]));
+    int32x4x2_t b2 = vtrnq_s32(vreinterpretq_s32_s16(a2.val[0]), vreinterpretq_s32_s16(a3.val[0]));
+    int32x4x2_t b3 = vtrnq_s32(vreinterpretq_s32_s16(a2.val[1]), vreinterpretq_s32_s16(a3.val[1]));
+    rows[0] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(b0.val[0]), vget_low_s32(b2.val[0])));
+    rows[1] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(b1.val[0]), vget_low_s32(b3.val[0])));
+    rows[2] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(b0.val[1]), vget_low_s32(b2.val[1])));
+    rows[3] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(b1.val[1]), vget_low_s32(b3.val[1])));
+    rows[4] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(b0.val[0]), vget_high_s32(b2.val[0])));
+    rows[5] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(b1.val[0]), vget_high_s32(b3.val[0])));
+    rows[6] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(b0.val[1]), vget_high_s32(b2.val[1])));
+    rows[7] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(b1.val[1]), vget_high_s32(b3.val[1])));
+}
+#endif
+
+void AudioKernels::deinterleave(qint16 *const *dst, const qint16 *src, unsigned channels, unsigned samplesPerChannel)
+{
+    unsigned done = 0;                                  // samples per channel done by the vector path
+#if defined(AUDIOKERNELS_SSE2)
+    if (channels == 2) {
+        for (; done + 8 <= samplesPerChannel; done += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(src + done * 2));
+            __m128i b = _mm_loadu_si128((const __m128i*)(src + done * 2 + 8));
+            __m128i left = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+            __m128i right = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+            _mm_storeu_si128((__m128i*)(dst[0] + done), left);
+            _mm_storeu_si128((__m128i*)(dst[1] + done), right);
+        }
+    } else if (channels % 8 == 0) {
+        __m128i rows[8];
+        for (; done + 8 <= samplesPerChannel; done += 8) {
+            for (unsigned ch = 0; ch < channels; ch += 8) {
+                for (unsigned r = 0; r < 8; r++) {
+                    rows[r] = _mm_loadu_si128((const __m128i*)(src + (done + r) * channels + ch));
+                }
+                transpose8x8(rows);
+                for (unsigned r = 0; r < 8; r++) {
+                    _mm_storeu_si128((__m128i*)(dst[ch + r] + done), rows[r]);
+                }
+            }
+        }
+    }
+#elif defined(AUDIOKERNELS_NEON)
+    if (channels == 2) {
+        for (; done + 8 <= samplesPerChannel; done += 8) {
+            int16x8x2_t lr = vld2q_s16(src + done * 2);
+            vst1q_s16(dst[0] + done, lr.val[0]);
+            vst1q_s16(dst[1] + done, lr.val[1]);
+        }
+    } else if (channels % 8 == 0) {
+        int16x8_t rows[8];
+        for (; done + 8 <= samplesPerChannel; done += 8) {
+            for (unsigned ch = 0; ch < channels; ch += 8) {
+                for (unsigned r = 0; r < 8; r++) {
+                    rows[r] = vld1q_s16(src + (done + r) * channels + ch);
+                }
+                transpose8x8(rows);
+                for (unsigned r = 0; r < 8; r++) {
+                    vst1q_s16(dst[ch + r] + done, rows[r]);
+                }
+            }
+        }
+    }
+#endif
+    // channel by channel so every destination buffer is written sequentially, the source stays in the cache
+    for (unsigned ch = 0; ch < channels; ch++) {
+        qint16 *out = dst[ch];
+        const qint16 *in = src + ch;
+        for (unsigned i = done; i < samplesPerChannel; i++) {
+            out[i] = in[i * channels];
+        }
+    }
+}
+
+void AudioKernels::interleave(qint16 *dst, const qint16 *const *src, unsigned channels, unsigned samplesPerChannel)
+{
+    unsigned done = 0;
+#if defined(AUDIOKERNELS_SSE2)
+    if (channels == 2 && src[0] && src[1]) {
+        for (; done + 8 <= samplesPerChannel; done += 8) {
+            __m128i left = _mm_loadu_si128((const __m128i*)(src[0] + done));
+            __m128i right = _mm_loadu_si128((const __m128i*)(src[1] + done));
+            _mm_storeu_si128((__m128i*)(dst + done * 2), _mm_unpacklo_epi16(left, right));
+            _mm_storeu_si128((__m128i*)(dst + done * 2 + 8), _mm_unpackhi_epi16(left, right));
+        }
+    } else if (channels % 8 == 0) {
+        __m128i rows[8];
+        for (; done + 8 <= samplesPerChannel; done += 8) {
+            for (unsigned ch = 0; ch < channels; ch += 8) {
+                for (unsigned r = 0; r < 8; r++) {
+                    rows[r] = src[ch + r] ? _mm_loadu_si128((const __m128i*)(src[ch + r] + done)) : _mm_setzero_si128();
+                }
+                transpose8x8(rows);
+                for (unsigned r = 0; r < 8; r++) {
+                    _mm_storeu_si128((__m128i*)(dst + (done + r) * channels + ch), rows[r]);
+                }
+            }
+        }
+    }
+#elif defined(AUDIOKERNELS_NEON)
+    if (channels == 2 && src[0] && src[1]) {
+        for (; done + 8 <= samplesPerChannel; done += 8) {
+            int16x8x2_t lr;
+            lr.val[0] = vld1q_s16(src[0] + done);
+            lr.val[1] = vld1q_s16(src[1] + done);
+            vst2q_s16(dst + done * 2, lr);
+        }
+    } else if (channels % 8 == 0) {
+        int16x8_t rows[8];
+        for (; done + 8 <= samplesPerChannel; done += 8) {
+            for (unsigned ch = 0; ch < channels; ch += 8) {
+                for (unsigned r = 0; r < 8; r++) {
+                    rows[r] = src[ch + r] ? vld1q_s16(src[ch + r] + done) : vdupq_n_s16(0);
+                }
+                transpose8x8(rows);
+                for (unsigned r = 0; r < 8; r++) {
+                    vst1q_s16(dst + (done + r) * channels + ch, rows[r]);
+                }
+            }
+        }
+    }
+#endif
+    for (unsigned ch = 0; ch < channels; ch++) {
+        const qint16 *in = src[ch];
+        qint16 *out = dst + ch;
+        if (in == nullptr) {
+            for (unsigned i = done; i < samplesPerChannel; i++) {
+                out[i * channels] = 0;
+            }
+            continue;
+        }
+        for (unsigned i = done; i < samplesPerChannel; i++) {
+            out[i * channels] = in[i];
+        }
+    }
+}
+
+const char* AudioKernels::instructionSet()
+{
+#if defined(AUDIOKERNELS_SSE2)
+    return "SSE2";
+#elif defined(AUDIOKERNELS_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,51 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef AUDIOKERNELS_H
+#define AUDIOKERNELS_H
+
+#include <QtGlobal>
+
+/**
+ * @brief Sample kernels for the audio paths the library processes itself
+ * @details all kernels work on 16 bit PCM. They use SSE2 on x86 and NEON on ARM, every kernel has
+ * a scalar fallback for other targets, for the tail of a block and for channel counts without a vector path.
+ * Stereo and multiples of 8 channels are vectorised, the latter as 8x8 transposes of 8 channels and 8 samples.
+ * Buffers don't need to be aligned.
+ */
+class AudioKernels
+{
+public:
+    /**
+     * @brief split an interleaved frame into one buffer per channel
+     * @param dst one buffer of samplesPerChannel samples for every channel
+     */
+    static void deinterleave(qint16 *const *dst, const qint16 *src, unsigned channels, unsigned samplesPerChannel);
+
+    /**
+     * @brief build an interleaved frame from one buffer per channel, a nullptr buffer is written as silence
+     */
+    static void interleave(qint16 *dst, const qint16 *const *src, unsigned channels, unsigned samplesPerChannel);
+
+    /**
+     * @brief the instruction set the kernels were built for, e.g. for getVersions
+     */
+    static const char* instructionSet();
+};
+
+#endif // AUDIOKERNELS_H
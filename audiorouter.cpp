@@ -18,16 +18,26 @@
 
 #include "audiorouter.h"
 #include "awahsiplib.h"
+#include "multichanneladapter.h"
+#include "sounddevicemonitor.h"
 #include "pjmedia.h"
 #include "pjlib-util.h" /* pj_getopt */
 #include "pjlib.h"
 #include "pjsua-lib/pjsua_internal.h"
 #include "pj/string.h"
+#include <QDateTime>
 #include <QDebug>
 #include <QThread>
 #include <QSettings>
+#include <QMutex>
 
 #define THIS_FILE		"audiorouter.cpp"
+#define LEVELRAMP_SIGNATURE PJMEDIA_SIGNATURE('A', 'W', 'L', 'R')
+
+// the ramp port is static, the bridge may call it after the router is deleted until the library is destroyed
+static pjmedia_port s_levelRampPort;
+static QMutex s_levelRampMutex;                     // guards s_levelRampRouter and the ramps of the router
+static AudioRouter *s_levelRampRouter = nullptr;
 
 
 AudioRouter::AudioRouter(AWAHSipLib *parentLib, QObject *parent) : QObject(parent), m_lib(parentLib)
@@ -36,12 +46,21 @@ AudioRouter::AudioRouter(AWAHSipLib *parentLib, QObject *parent) : QObject(paren
     m_SoundDeviceInspectorTimer->setInterval(5000);
     connect(m_SoundDeviceInspectorTimer, SIGNAL(timeout()), this, SLOT(SoundDeviceInspector()));
     m_sounddevCount = pjmedia_snd_get_dev_count();
-    m_SoundDeviceInspectorTimer->start();
+    m_SoundDeviceMonitor = new SoundDeviceMonitor(m_lib, this);
+    if(m_SoundDeviceMonitor->isWatching())                              // sound cards are reported when they are plugged, no need to poll
+        connect(m_SoundDeviceMonitor, &SoundDeviceMonitor::cardsChanged, this, &AudioRouter::soundCardsChanged);
+    else
+        m_SoundDeviceInspectorTimer->start();
 }
 
 AudioRouter::~AudioRouter()
 {
     m_SoundDeviceInspectorTimer->stop();
+    s_levelRampMutex.lock();
+    s_levelRampRouter = nullptr;
+    s_levelRampMutex.unlock();
+    if(m_levelRampSlot != PJSUA_INVALID_ID)
+        pjsua_conf_remove_port(m_levelRampSlot);
     QList<s_IODevices> *audioDevs = getAudioDevices();
     if(themaster != nullptr){
         pjmedia_master_port_stop(themaster);
@@ -138,8 +157,8 @@ void AudioRouter::AddClockingDevice(int recordDevId, int playbackDevId, QString
     }
     else channelCnt = playbackdev.outputCount;
 
-    if (channelCnt > 64){                                                             // important edit splitcomb.c line 34  #define MAX_CHANNELS from 16 to 64
-        channelCnt = 64;                                                              // limit the number of channels acorrding to MAX_CHANNEL set
+    if (channelCnt > 64){                                                             // keep the number of conference ports per device within bounds
+        channelCnt = 64;                                                              // limit the number of channels
     }
     if (channelCnt == 0){
         m_lib->m_Log->writeLog(3,"AddClockingDevice: Device has either no input or no outputs!" );
@@ -164,53 +183,35 @@ void AudioRouter::AddClockingDevice(int recordDevId, int playbackDevId, QString
     }
  m_lib->m_Log->writeLog(3,(QString("AddClockingDevice:mediaconfig clockrate: ") + QString::number(m_lib->epCfg.medConfig.clockRate)));
  m_lib->m_Log->writeLog(3,(QString("AddClockingDevice:masterportinfo spf: ") + QString::number(samples_per_frame)));
-    pjmedia_port *splitcomb;
-    status = pjmedia_splitcomb_create(
-                /* pointer to the memory pool */        m_lib->pool,
-                /* clock rate*/                         m_lib->epCfg.medConfig.clockRate,
-                /*channel count */                      channelCnt,
-                /*samples per frame*/                   samples_per_frame,
-                /* bits per sample*/                    16,
-                /* options*/                            0,
-                &splitcomb);
-    if (status != PJ_SUCCESS){
-        char buf[50];
-        pj_strerror	(status,buf,sizeof (buf) );
-        m_lib->m_Log->writeLog(1,(QString("AddClockingDevice: create splitcomb port failed: ") + buf));
-        return;
-    }
+    MultichannelAdapter *adapter = new MultichannelAdapter(m_lib->epCfg.medConfig.clockRate, channelCnt, samples_per_frame / channelCnt);
 
     for (int i = 0; i<channelCnt;i++)
     {
-        pjmedia_port *revch;
+        pjmedia_port *revch = adapter->channelPort(i);
         QString name = "AD:" + uid + "-Ch:" + QString::number(i+1);
-        status = pjmedia_splitcomb_create_rev_channel(m_lib->pool, splitcomb, i, 0, &revch);
-        if (status != PJ_SUCCESS){
-            char buf[50];
-            pj_strerror	(status,buf,sizeof (buf) );
-            m_lib->m_Log->writeLog(1,(QString("AddClockingDevice: could not create splittcomb revchannel: ") + buf));
-            return;
-        }
         pj_strdup2(m_lib->pool, &revch->info.name, name.toStdString().c_str());
         status = pjsua_conf_add_port(m_lib->pool, revch, &slot);
         if (status != PJ_SUCCESS){
             char buf[50];
             pj_strerror	(status,buf,sizeof (buf) );
             m_lib->m_Log->writeLog(1,(QString("AddClockingDevice: adding  conference port failed: ") + buf));
+            discardSoundDevice(soundport, adapter, connectedSlots);
             return;
         }
         pjsua_conf_connect(0,slot);        // connect masterport to sound dev to keep it open all the time to prevent different latencies (see issue #29)
         pjsua_data* intData = pjsua_get_var();
         pjmedia_conf_adjust_conn_level(intData->mconf, 0, slot,  -128);
-        status = pjmedia_snd_port_connect(soundport, splitcomb);
-        if (status != PJ_SUCCESS){
-            char buf[50];
-            pj_strerror	(status,buf,sizeof (buf) );
-            m_lib->m_Log->writeLog(1,(QString("AddClockingDevice: connecting sound port failed: ") + buf));
-            return;
-        }
+        registerConfPort(slot, revch->info.name, AudioDeviceOwner, uid, i+1, soundDevPortDirection(i+1, recorddev.inputCount, playbackdev.outputCount));
         connectedSlots.append(slot);
     }
+    status = pjmedia_snd_port_connect(soundport, adapter->devicePort());
+    if (status != PJ_SUCCESS){
+        char buf[50];
+        pj_strerror	(status,buf,sizeof (buf) );
+        m_lib->m_Log->writeLog(1,(QString("AddClockingDevice: connecting sound port failed: ") + buf));
+        discardSoundDevice(soundport, adapter, connectedSlots);
+        return;
+    }
     Audiodevice.inputname = QString::fromStdString(recorddev.name);                      // update devicelist for saving and recalling current setup
     Audiodevice.outputame = QString::fromStdString(playbackdev.name);
     Audiodevice.devicetype = SoundDevice;
@@ -219,8 +220,11 @@ void AudioRouter::AddClockingDevice(int recordDevId, int playbackDevId, QString
     Audiodevice.RecDevID = recordDevId;
     Audiodevice.portNo = connectedSlots;
     Audiodevice.soundport = soundport;
+    Audiodevice.adapter = adapter;
     Audiodevice.inChannelCount = recorddev.inputCount;
     Audiodevice.outChannelCount = playbackdev.outputCount;
+    Audiodevice.typeSpecificSettings["recordCard"] = SoundDeviceMonitor::cardOfDevice(Audiodevice.inputname).toJSON();
+    Audiodevice.typeSpecificSettings["playbackCard"] = SoundDeviceMonitor::cardOfDevice(Audiodevice.outputame).toJSON();
     bool devicefound = false;
     for (auto & existingaudiodev : m_AudioDevices){                                     // uptate existing audio dev when offline device is changing to online
         if (existingaudiodev.uid == uid){
@@ -233,7 +237,7 @@ void AudioRouter::AddClockingDevice(int recordDevId, int playbackDevId, QString
          m_AudioDevices.append(Audiodevice);
     }
     m_lib->m_Settings->saveIODevConfig();
-    conferenceBridgeChanged();
+    conferenceBridgeChanged(uid);
     emit AudioDevicesChanged(m_AudioDevices);
     return;
 }
@@ -247,6 +251,7 @@ void AudioRouter::addAudioDevice(int recordDevId, int playbackDevId, QString uid
     int samples_per_frame, channelCnt;
     QList<int> connectedSlots;
     s_IODevices Audiodevice;
+    StartupSpan span(m_lib->m_Startup, QString("addAudioDevice %1/%2").arg(recordDevId).arg(playbackDevId));
 
     for(auto& device : m_AudioDevices){
         if(device.devicetype == SoundDevice){
@@ -267,8 +272,8 @@ void AudioRouter::addAudioDevice(int recordDevId, int playbackDevId, QString uid
     }
     else channelCnt = playbackdev.outputCount;
 
-    if (channelCnt > 64){                                                             // important edit splitcomb.c line 34  #define MAX_CHANNELS from 16 to 64
-        channelCnt = 64;                                                              // limit the number of channels acorrding to MAX_CHANNEL set
+    if (channelCnt > 64){                                                             // keep the number of conference ports per device within bounds
+        channelCnt = 64;                                                              // limit the number of channels
     }
     if (channelCnt == 0){
         m_lib->m_Log->writeLog(3,"AddAudioDevice: Device has either no input or no outputs!" );
@@ -302,53 +307,35 @@ void AudioRouter::addAudioDevice(int recordDevId, int playbackDevId, QString uid
     }
 // m_lib->m_Log->writeLog(3,(QString("AddClockingDevice:masterportinfo clockrate: ") + QString::number(masterPortInfo.clock_rate)));
 // m_lib->m_Log->writeLog(3,(QString("AddClockingDevice:masterportinfo spf: ") + QString::number(samples_per_frame)));
-    pjmedia_port *splitcomb;
-    status = pjmedia_splitcomb_create(
-                /* pointer to the memory pool */        m_lib->pool,
-                /* clock rate*/                         masterPortInfo.clock_rate,
-                /*channel count */                      channelCnt,
-                /*samples per frame*/                   samples_per_frame,
-                /* bits per sample*/                    16,
-                /* options*/                            0,
-                &splitcomb);
-    if (status != PJ_SUCCESS){
-        char buf[50];
-        pj_strerror	(status,buf,sizeof (buf) );
-        m_lib->m_Log->writeLog(1,(QString("AddAudioDevice: create splitcomb port failed: ") + buf));
-        return;
-    }
+    MultichannelAdapter *adapter = new MultichannelAdapter(masterPortInfo.clock_rate, channelCnt, samples_per_frame / channelCnt);
     for (int i = 0; i<channelCnt;i++)
     {
-        pjmedia_port *revch;
+        pjmedia_port *revch = adapter->channelPort(i);
         QString name = "AD:" + uid + "-Ch:" + QString::number(i+1);
-        status = pjmedia_splitcomb_create_rev_channel(m_lib->pool, splitcomb, i, 0, &revch);
-        if (status != PJ_SUCCESS){
-            char buf[50];
-            pj_strerror	(status,buf,sizeof (buf) );
-            m_lib->m_Log->writeLog(1,(QString("Add audiodevice: could not create splittcomb revchannel: ") + buf));
-            return;
-        }
         pj_strdup2(m_lib->pool, &revch->info.name, name.toStdString().c_str());
         status = pjsua_conf_add_port(m_lib->pool, revch, &slot);
         if (status != PJ_SUCCESS){
             char buf[50];
             pj_strerror	(status,buf,sizeof (buf) );
             m_lib->m_Log->writeLog(1,(QString("Add audiodevice: adding  conference port failed: ") + buf));
+            discardSoundDevice(soundport, adapter, connectedSlots);
             return;
         }
         pjsua_conf_connect(masterPortInfo.slot_id,slot);        // connect masterport to sound dev to keep it open all the time to prevent different latencies (see issue #29)
         pjsua_data* intData = pjsua_get_var();
         pjmedia_conf_adjust_conn_level(intData->mconf, masterPortInfo.slot_id, slot,  -128);
 
-        status = pjmedia_snd_port_connect(soundport, splitcomb);
-        if (status != PJ_SUCCESS){
-            char buf[50];
-            pj_strerror	(status,buf,sizeof (buf) );
-            m_lib->m_Log->writeLog(1,(QString("Add audiodevice: connecting sound port failed: ") + buf));
-            return;
-        }
+        registerConfPort(slot, revch->info.name, AudioDeviceOwner, uid, i+1, soundDevPortDirection(i+1, recorddev.inputCount, playbackdev.outputCount));
         connectedSlots.append(slot);
     }
+    status = pjmedia_snd_port_connect(soundport, adapter->devicePort());
+    if (status != PJ_SUCCESS){
+        char buf[50];
+        pj_strerror	(status,buf,sizeof (buf) );
+        m_lib->m_Log->writeLog(1,(QString("Add audiodevice: connecting sound port failed: ") + buf));
+        discardSoundDevice(soundport, adapter, connectedSlots);
+        return;
+    }
 
     Audiodevice.inputname = QString::fromStdString(recorddev.name);                      // update devicelist for saving and recalling current setup
     Audiodevice.outputame = QString::fromStdString(playbackdev.name);
@@ -358,8 +345,11 @@ void AudioRouter::addAudioDevice(int recordDevId, int playbackDevId, QString uid
     Audiodevice.RecDevID = recordDevId;
     Audiodevice.portNo = connectedSlots;
     Audiodevice.soundport = soundport;
+    Audiodevice.adapter = adapter;
     Audiodevice.inChannelCount = recorddev.inputCount;
     Audiodevice.outChannelCount = playbackdev.outputCount;
+    Audiodevice.typeSpecificSettings["recordCard"] = SoundDeviceMonitor::cardOfDevice(Audiodevice.inputname).toJSON();
+    Audiodevice.typeSpecificSettings["playbackCard"] = SoundDeviceMonitor::cardOfDevice(Audiodevice.outputame).toJSON();
     bool devicefound = false;
     for (auto & existingaudiodev : m_AudioDevices){                                     // uptate existing audio dev when offline device is changing to online
         if (existingaudiodev.uid == uid){
@@ -372,12 +362,12 @@ void AudioRouter::addAudioDevice(int recordDevId, int playbackDevId, QString uid
          m_AudioDevices.append(Audiodevice);
     }
     m_lib->m_Settings->saveIODevConfig();
-    conferenceBridgeChanged();
+    conferenceBridgeChanged(uid);
     emit AudioDevicesChanged(m_AudioDevices);
     return;
 }
 
-void AudioRouter::setAudioDeviceToOffline(QString inputName, QString outputName, QString uid)
+void AudioRouter::setAudioDeviceToOffline(QString inputName, QString outputName, QString uid, const QJsonObject &typeSpecificSettings)
 {
     s_IODevices* offlineDevice = nullptr;
     pj_status_t status;
@@ -395,6 +385,7 @@ void AudioRouter::setAudioDeviceToOffline(QString inputName, QString outputName,
         Audiodevice.RecDevID = -1;
         Audiodevice.devicetype = SoundDevice;
         Audiodevice.uid = uid;
+        Audiodevice.typeSpecificSettings = typeSpecificSettings;
         m_AudioDevices.append(Audiodevice);
         m_lib->m_Settings->saveIODevConfig();
         emit AudioDevicesChanged(m_AudioDevices);
@@ -407,22 +398,16 @@ void AudioRouter::setAudioDeviceToOffline(QString inputName, QString outputName,
                 for(auto& slot : offlineDevice->portNo){
                     try{
                         pj_status_t status;
-                        bool save = false;
-                        QMutableListIterator<s_audioRoutes> i(m_audioRoutes);
-                        while(i.hasNext()){
-                            s_audioRoutes& route = i.next();
-                            if(route.srcSlot == slot || route.destSlot == slot){
-                                status = pjsua_conf_disconnect(route.srcSlot, route.destSlot);
-                                if (status != PJ_SUCCESS){
-                                    char buf[50];
-                                    pj_strerror	(status,buf,sizeof (buf) );
-                                    m_lib->m_Log->writeLog(2,(QString("setAudioDeviceToOffline: disconnect slot failed from slot: ") + QString::number(route.srcSlot) + " : " + buf));
-                                }
-                                route.persistant ? (save = true) : false;
-                                if(save){
-                                    m_offlineRoutes.append(route);
-                                    i.remove();
-                                }
+                        for(auto& route : routesOfSlot(slot)){
+                            status = pjsua_conf_disconnect(route.srcSlot, route.destSlot);
+                            if (status != PJ_SUCCESS){
+                                char buf[50];
+                                pj_strerror	(status,buf,sizeof (buf) );
+                                m_lib->m_Log->writeLog(2,(QString("setAudioDeviceToOffline: disconnect slot failed from slot: ") + QString::number(route.srcSlot) + " : " + buf));
+                            }
+                            if(route.persistant){
+                                m_offlineRoutes.append(route);
+                                eraseRoute(route.srcSlot, route.destSlot);
                             }
                         }
                         status = pjsua_conf_remove_port(slot);
@@ -432,6 +417,7 @@ void AudioRouter::setAudioDeviceToOffline(QString inputName, QString outputName,
                             m_lib->m_Log->writeLog(1,(QString("setAudioDeviceToOffline: could not remove port - ERROR: ") + buf));
                             return;
                         }
+                        unregisterConfPort(slot);
                     }
                     catch(Error &err)
                     {
@@ -446,13 +432,14 @@ void AudioRouter::setAudioDeviceToOffline(QString inputName, QString outputName,
                     m_lib->m_Log->writeLog(1,(QString("setAudioDeviceToOffline: could not remove sound device - ERROR: ") + buf));
                     return;
                 }
+                retireAdapter(*offlineDevice);
                 m_lib->m_Log->writeLog(3,(QString("setAudioDeviceToOffline: removing: ")  +   offlineDevice->inputname));
             }
         }
         offlineDevice->PBDevID = -1;
         offlineDevice->RecDevID = -1;
         emit AudioDevicesChanged(m_AudioDevices);
-        conferenceBridgeChanged();
+        conferenceBridgeChanged(uid);
         m_lib->m_Settings->saveIODevConfig();
     }
 }
@@ -486,6 +473,7 @@ void AudioRouter::removeAudioDevice(QString uid)
                 m_lib->m_Log->writeLog(1,(QString("removeAudioDevice: could not remove port - ERROR: ") + buf));
                 return;
             }
+            unregisterConfPort(slot);
         }
         catch(Error &err)
         {
@@ -503,6 +491,7 @@ void AudioRouter::removeAudioDevice(QString uid)
                 m_lib->m_Log->writeLog(1,(QString("removeAudioDevice: could not remove sound device - ERROR: ") + buf));
                 return;
             }
+            retireAdapter(*deviceToRemove);
             m_lib->m_Log->writeLog(3,(QString("removeAudioDevice: removing: ")  +   deviceToRemove->inputname));
         }
     }
@@ -566,7 +555,7 @@ void AudioRouter::removeAudioDevice(QString uid)
         }
     }
     removeAllCustomNamesWithUID(uid);
-    conferenceBridgeChanged();
+    conferenceBridgeChanged(uid);
     m_lib->m_Settings->saveIODevConfig();
     emit AudioDevicesChanged(m_AudioDevices);
 }
@@ -632,7 +621,8 @@ void AudioRouter::addToneGen(int freq, QString uid){
     Audiodevice.mediaport = genPort;
     m_AudioDevices.append(Audiodevice);
     m_lib->m_Settings->saveIODevConfig();
-    conferenceBridgeChanged();
+    registerConfPort(slot, label, ToneGeneratorOwner, uid, 0, ConfPortSource);
+    conferenceBridgeChanged(uid);
     emit AudioDevicesChanged(m_AudioDevices);
     return;
 }
@@ -686,7 +676,8 @@ void AudioRouter::addFilePlayer(QString PlayerName, QString File, QString uid)
     Audiodevice.PBDevID = player_id;
     Audiodevice.mediaport = player_media_port;
     m_AudioDevices.append(Audiodevice);
-    conferenceBridgeChanged();
+    registerConfPort(slot, player_media_port->info.name, FilePlayerOwner, uid, 0, ConfPortSource);
+    conferenceBridgeChanged(uid);
     m_lib->m_Settings->saveIODevConfig();
     emit AudioDevicesChanged(m_AudioDevices);
     return;
@@ -735,7 +726,8 @@ void AudioRouter::addFileRecorder(QString File, QString uid)
     Audiodevice.mediaport = media_port;
     m_AudioDevices.append(Audiodevice);
     m_lib->m_Settings->saveIODevConfig();
-    conferenceBridgeChanged();
+    registerConfPort(slot, media_port->info.name, FileRecorderOwner, uid, 0, ConfPortDestination);
+    conferenceBridgeChanged(uid);
     emit AudioDevicesChanged(m_AudioDevices);
     return;
 }
@@ -791,6 +783,7 @@ int AudioRouter::addSplittComb(s_account &account)
         pjsua_conf_connect(masterPortInfo.slot_id,slot);        // connect masterport to sound dev to keep it open all the time to prevent different latencies (see issue #29)
         pjsua_data* intData = pjsua_get_var();
         pjmedia_conf_adjust_conn_level(intData->mconf, masterPortInfo.slot_id, slot,  -128);
+        registerConfPort(slot, revch->info.name, AccountOwner, account.uid, i+1, ConfPortBidirectional);
     }
 
     status = pjsua_conf_add_port(m_lib->pool, account.splitComb, &slot);
@@ -819,140 +812,162 @@ s_IODevices* AudioRouter::getADeviceByUID(QString uid)
     return nullptr;
 }
 
-s_audioPortList AudioRouter::listConfPorts(){
-    QStringList confportlist;
-    s_audioPortList audioPortList;
-    pjsua_conf_port_info confinfo;
-    pj_status_t status;
-    QString debugSlotOut;
-    m_srcAudioSlotMap.clear();
-    m_destAudioSlotMap.clear();
-    pjsua_conf_port_id confports[PJSUA_MAX_CONF_PORTS];
-    unsigned port_cnt=PJ_ARRAY_SIZE(confports);
-    status = pjsua_enum_conf_ports(confports,&port_cnt);
-    if (status != PJ_SUCCESS){
-        char buf[50];
-        pj_strerror	(status,buf,sizeof (buf) );
-        m_lib->m_Log->writeLog(2,(QString("ListConfPorts: reading conf port list failed: ") + buf));
-    }
-    for (unsigned int i=0;i<port_cnt;i++){
-        s_audioPort src, dest;
-        int slot = confports[i];
-        pjsua_conf_get_port_info(slot, &confinfo);
-        QString portName = pj2Str(confinfo.name);
-        QStringList split = portName.split("-");
-        if(portName.startsWith("AD:")){
-            QString uid = split[0].remove("AD:");
-            const s_IODevices* aDevice = getADeviceByUID(uid);
-            if(aDevice != nullptr){
-                if(aDevice->devicetype == TestToneGenerator){
-                    src.pjName = confinfo.name;
-                    if(m_customSourceLabels.contains(pj2Str(src.pjName))){
-                        src.name = m_customSourceLabels[pj2Str(src.pjName)];
-                    }
-                    else{
-                        src.name = aDevice->inputname;
-                    }
-                    src.slot = slot;
-                    audioPortList.srcPorts.append(src);
-                    m_srcAudioSlotMap[slot] = pj2Str(confinfo.name);
-                } else {
-                    QString channelString = split.at(1);
-                    uint channel = channelString.remove("Ch:").toUInt();
-                    if(channel <= aDevice->inChannelCount) {
-                        src.pjName = confinfo.name;
-                        if(m_customSourceLabels.contains(pj2Str(src.pjName))){
-                            src.name = m_customSourceLabels[pj2Str(src.pjName)];
-                        }
-                        else{
-                            src.name = aDevice->inputname + " " + split.at(1);
-                        }
-                        src.slot = slot;
-                        audioPortList.srcPorts.append(src);
-                        m_srcAudioSlotMap[slot] = pj2Str(confinfo.name);
-                    }
-                    if(channel <= aDevice->outChannelCount) {
-                        dest.pjName = confinfo.name;
-                        if(m_customDestLabels.contains(pj2Str(dest.pjName))){
-                            dest.name = m_customDestLabels[pj2Str(dest.pjName)];
-                        }
-                        else{
-                            dest.name = aDevice->outputame + " " + split.at(1);
-                        }
-                        dest.slot = slot;
-                        audioPortList.destPorts.append(dest);
-                        m_destAudioSlotMap[slot] = pj2Str(confinfo.name);
-                    }
-                }
-            }
-        } else if(portName.startsWith("Acc:")){
-            QString uid = split[0].remove("Acc:");
-            const s_account* account = m_lib->m_Accounts->getAccountByUID(uid);
+void AudioRouter::registerConfPort(int slot, const pj_str_t &pjName, ConfPortOwner owner, const QString &uid, uint channel, int direction)
+{
+    s_confPortInfo info;
+    info.slot = slot;
+    info.pjName = pjName;
+    info.owner = owner;
+    info.uid = uid;
+    info.channel = channel;
+    info.direction = direction;
+    auto previous = m_confPorts.constFind(slot);                        // the slot number was reused by pjsua
+    if(previous != m_confPorts.constEnd() && previous->uid != uid){
+        m_confPortsByUid[previous->uid].remove(slot);
+        m_confPortSlots.remove(pj2Str(previous->pjName));
+    }
+    m_confPorts[slot] = info;
+    m_confPortSlots[pj2Str(pjName)] = slot;
+    m_confPortsByUid[uid].insert(slot);
+}
+
+void AudioRouter::unregisterConfPort(int slot)
+{
+    auto registered = m_confPorts.find(slot);
+    if(registered == m_confPorts.end())
+        return;
+    m_confPortSlots.remove(pj2Str(registered->pjName));
+    m_confPorts.erase(registered);                                      // the uid index is cleaned up by conferenceBridgeChanged(uid)
+}
+
+int AudioRouter::soundDevPortDirection(uint channel, uint inChannelCount, uint outChannelCount)
+{
+    int direction = 0;
+    if(channel <= inChannelCount)
+        direction |= ConfPortSource;
+    if(channel <= outChannelCount)
+        direction |= ConfPortDestination;
+    return direction;
+}
+
+const s_confPortInfo* AudioRouter::getConfPortInfo(int slot) const
+{
+    auto registered = m_confPorts.constFind(slot);
+    if(registered == m_confPorts.constEnd())
+        return nullptr;
+    return &registered.value();
+}
+
+QList<int> AudioRouter::getSlotsByUID(const QString &uid) const
+{
+    QList<int> portSlots;
+    for(const int slot : m_confPortsByUid.value(uid)){
+        if(m_confPorts.contains(slot))
+            portSlots.append(slot);
+    }
+    std::sort(portSlots.begin(), portSlots.end());
+    return portSlots;
+}
+
+int AudioRouter::getSrcSlotByName(const QString &pjName) const
+{
+    int slot = m_confPortSlots.value(pjName, PJSUA_INVALID_ID);
+    return m_srcAudioSlotMap.contains(slot) ? slot : PJSUA_INVALID_ID;
+}
+
+int AudioRouter::getDestSlotByName(const QString &pjName) const
+{
+    int slot = m_confPortSlots.value(pjName, PJSUA_INVALID_ID);
+    return m_destAudioSlotMap.contains(slot) ? slot : PJSUA_INVALID_ID;
+}
+
+void AudioRouter::updateConfPort(int slot, s_audioPortList &changedPorts, s_audioPortList &removedPorts)
+{
+    s_audioPort src, dest;
+    bool hasSrc = false, hasDest = false;
+    src.slot = slot;
+    dest.slot = slot;
+    const s_confPortInfo *info = getConfPortInfo(slot);
+    if(info != nullptr){
+        const QString channel = "Ch:" + QString::number(info->channel);
+        src.pjName = info->pjName;
+        dest.pjName = info->pjName;
+        if(info->owner == AccountOwner){
+            const s_account* account = m_lib->m_Accounts->getAccountByUID(info->uid);
             if(account != nullptr) {
-                src.pjName = confinfo.name;
-                if(m_customSourceLabels.contains(pj2Str(src.pjName))){
-                    src.name = m_customSourceLabels[pj2Str(src.pjName)];
-                }
-                else{
-                    src.name = account->name + " " + split.at(1);
-                }
-                src.slot = slot;
-                dest.pjName = confinfo.name;
-                if(m_customDestLabels.contains(pj2Str(dest.pjName))){
-                    dest.name = m_customDestLabels[pj2Str(dest.pjName)];
-                }
-                else{
-                    dest.name = account->name + " " + split.at(1);
-                }
-                dest.slot = slot;
-                audioPortList.srcPorts.append(src);
-                audioPortList.destPorts.append(dest);
-                m_srcAudioSlotMap[slot] = pj2Str(confinfo.name);
-                m_destAudioSlotMap[slot] = pj2Str(confinfo.name);
+                src.name = account->name + " " + channel;
+                dest.name = account->name + " " + channel;
+                hasSrc = true;
+                hasDest = true;
             }
-        } else if(portName.startsWith("FP:")){
-            QString uid = split[0].remove("FP:");
-            const s_IODevices* aDevice = getADeviceByUID(uid);
-            if(aDevice != nullptr) {
-                if(aDevice->devicetype == FilePlayer){
-                    src.pjName = confinfo.name;
-                    if(m_customSourceLabels.contains(pj2Str(src.pjName))){
-                        src.name = m_customSourceLabels[pj2Str(src.pjName)];
-                    }
-                    else{
-                        src.name = "File Player: " + aDevice->inputname;
-                    }
-                    src.slot = slot;
-                    audioPortList.srcPorts.append(src);
-                    m_srcAudioSlotMap[slot] = pj2Str(confinfo.name);
+        } else {
+            const s_IODevices* aDevice = getADeviceByUID(info->uid);
+            if(aDevice != nullptr){
+                switch (info->owner) {
+                case AudioDeviceOwner:
+                    src.name = aDevice->inputname + " " + channel;
+                    dest.name = aDevice->outputame + " " + channel;
+                    break;
+                case ToneGeneratorOwner:
+                    src.name = aDevice->inputname;
+                    break;
+                case FilePlayerOwner:
+                    src.name = "File Player: " + aDevice->inputname;
+                    break;
+                case FileRecorderOwner:
+                    dest.name = aDevice->outputame;
+                    break;
+                case AccountOwner:
+                    break;
                 }
+                hasSrc = info->direction & ConfPortSource;
+                hasDest = info->direction & ConfPortDestination;
             }
         }
-        else if(portName.startsWith("FR:")){
-            QString uid = split[0].remove("FR:");
-            const s_IODevices* aDevice = getADeviceByUID(uid);
-            if(aDevice != nullptr) {
-                if(aDevice->devicetype == FileRecorder){
-                    dest.pjName = confinfo.name;
-                    if(m_customDestLabels.contains(pj2Str(dest.pjName))){
-                        dest.name = m_customDestLabels[pj2Str(dest.pjName)];
-                    }
-                    else{
-                        dest.name = aDevice->outputame;
-                    }
-                    dest.slot = slot;
-                    audioPortList.destPorts.append(dest);
-                    m_srcAudioSlotMap[slot] = pj2Str(confinfo.name);
-                }
-            }
+        const QString portName = pj2Str(info->pjName);
+        if(hasSrc && m_customSourceLabels.contains(portName)){
+            src.name = m_customSourceLabels[portName];
+        }
+        if(hasDest && m_customDestLabels.contains(portName)){
+            dest.name = m_customDestLabels[portName];
         }
-        debugSlotOut.clear();
-        debugSlotOut.append(QString::number(slot));
-        debugSlotOut.append(": ");
-        debugSlotOut.append(confinfo.name.ptr);
-        confportlist.append(debugSlotOut);
     }
-    return audioPortList;
+    publishConfPort(src, hasSrc, m_srcPorts, m_srcAudioSlotMap, changedPorts.srcPorts, removedPorts.srcPorts);
+    publishConfPort(dest, hasDest, m_destPorts, m_destAudioSlotMap, changedPorts.destPorts, removedPorts.destPorts);
+}
+
+void AudioRouter::publishConfPort(const s_audioPort &port, bool present, QMap<int, s_audioPort> &ports, QMap<int, QString> &slotMap, QList<s_audioPort> &changedPorts, QList<s_audioPort> &removedPorts)
+{
+    auto existing = ports.find(port.slot);
+    if(!present){
+        if(existing != ports.end()){
+            removedPorts.append(existing.value());
+            ports.erase(existing);
+            slotMap.remove(port.slot);
+        }
+        return;
+    }
+    if(existing != ports.end() && existing->name == port.name && pj2Str(existing->pjName) == pj2Str(port.pjName)){
+        return;                                                         // nothing changed
+    }
+    ports[port.slot] = port;
+    slotMap[port.slot] = pj2Str(port.pjName);
+    changedPorts.append(port);
+}
+
+void AudioRouter::updateConfPorts(const QList<int> &portSlots)
+{
+    s_audioPortList changedPorts, removedPorts;
+    for(const int slot : portSlots){
+        updateConfPort(slot, changedPorts, removedPorts);
+    }
+    if(!changedPorts.srcPorts.isEmpty() || !changedPorts.destPorts.isEmpty() || !removedPorts.srcPorts.isEmpty() || !removedPorts.destPorts.isEmpty()){
+        m_confPortList.srcPorts = m_srcPorts.values();
+        m_confPortList.destPorts = m_destPorts.values();
+        emit audioPortsChanged(changedPorts, removedPorts);
+    }
+    emit audioRoutesTableChanged(m_confPortList);
+    emit audioRoutesChanged(getAudioRoutes());
 }
 
 int AudioRouter::connectConfPort(int src_slot, int sink_slot, int level, bool persistant)
@@ -972,19 +987,11 @@ int AudioRouter::connectConfPort(int src_slot, int sink_slot, int level, bool pe
     status = pjsua_conf_connect2(src, sink, &param);
     if (status == PJ_SUCCESS){
         m_lib->m_Log->writeLog(3,(QString("connect slot: ") + QString::number(src_slot) + " to " + QString::number(sink_slot) + " successfully" ));
-        bool routeExists = false;
-        for(auto& existingroute : m_audioRoutes){                                                   // check if route is already connected
-            if(existingroute.srcSlot == route.srcSlot && existingroute.destSlot == route.destSlot){
-                existingroute = route;
-                routeExists = true;
-                m_lib->m_Log->writeLog(2,(QString("connectConfPort: route already connected! updating it instead: ") + QString::number(src_slot) + " to " + QString::number(sink_slot)));
-                break;
-            }
+        if(getAudioRoute(src_slot, sink_slot) != nullptr){                                          // check if route is already connected
+            m_lib->m_Log->writeLog(2,(QString("connectConfPort: route already connected! updating it instead: ") + QString::number(src_slot) + " to " + QString::number(sink_slot)));
         }
-        if(!routeExists){
-            m_audioRoutes.append(route);
-        }
-        emit audioRoutesChanged(m_audioRoutes);
+        insertRoute(route);
+        emit audioRoutesChanged(getAudioRoutes());
         changeConfPortLevel(src_slot,sink_slot, level);     // this is called to set the exact db values with the factor used in this function it is not in every case correct!!
         if(persistant)
             m_lib->m_Settings->saveAudioRoutes();
@@ -1006,15 +1013,14 @@ int AudioRouter::disconnectConfPort(int src_slot, int sink_slot)
     status = pjsua_conf_disconnect(src, sink);
     if (status == PJ_SUCCESS){
         m_lib->m_Log->writeLog(3,(QString("disconnect slot: ") + QString::number(sink_slot) + " to " + QString::number(src_slot) + " successfully" ));
-        for(int i = 0; i < m_audioRoutes.size(); ++i){
-            if(m_audioRoutes.at(i).srcSlot == src_slot && m_audioRoutes.at(i).destSlot == sink_slot){
-                bool persistant = m_audioRoutes.at(i).persistant;
-                m_audioRoutes.removeAt(i);
-                if(persistant)
-                    m_lib->m_Settings->saveAudioRoutes();
-            }
+        s_audioRoutes* route = getAudioRoute(src_slot, sink_slot);
+        if(route != nullptr){
+            bool persistant = route->persistant;
+            eraseRoute(src_slot, sink_slot);
+            if(persistant)
+                m_lib->m_Settings->saveAudioRoutes();
         }
-        emit audioRoutesChanged(m_audioRoutes);
+        emit audioRoutesChanged(getAudioRoutes());
     }
     else{
         char buf[50];
@@ -1031,17 +1037,23 @@ void AudioRouter::changeConfPortLevel(int src_slot, int sink_slot, int level)
     pjsua_conf_port_id src = src_slot;
     pjsua_conf_port_id sink = sink_slot;
     int leveladjust = dBtoAdjLevel(level);
+    s_audioRoutes* current = getAudioRoute(src_slot, sink_slot);
 
-    status = pjmedia_conf_adjust_conn_level(intData->mconf, src, sink,  leveladjust);
+    if(current != nullptr){
+        int currentLevel = current->level;
+        status = rampConnLevel(src, sink, dBtoAdjLevel(currentLevel), leveladjust);
+    }
+    else{
+        status = pjmedia_conf_adjust_conn_level(intData->mconf, src, sink,  leveladjust);
+    }
     if (status == PJ_SUCCESS){
         m_lib->m_Log->writeLog(4,(QString("ChangeConfPortLevel: changed level from slot: ") + QString::number(src_slot) + " to " + QString::number(sink_slot) + " successfully" ));
-        for(auto& route : m_audioRoutes){
-            if(route.srcSlot == src_slot && route.destSlot == sink_slot){
-                route.level = level;
-                emit confportLevelChanged(route);
-                if(route.persistant)
-                    m_lib->m_Settings->saveAudioRoutes();
-            }
+        s_audioRoutes* route = getAudioRoute(src_slot, sink_slot);
+        if(route != nullptr){
+            route->level = level;
+            emit confportLevelChanged(*route);
+            if(route->persistant)
+                m_lib->m_Settings->saveAudioRoutes();
         }
     }
     else{
@@ -1051,30 +1063,315 @@ void AudioRouter::changeConfPortLevel(int src_slot, int sink_slot, int level)
     }
 }
 
+int AudioRouter::applyRouteBatch(const QList<s_audioRouteOp> &ops)
+{
+    pjsua_data* intData = pjsua_get_var();
+    pj_status_t status = PJ_SUCCESS, result = PJ_SUCCESS;
+    QHash<quint64, bool> connected;                                         // simulated state of the routes touched by the batch
+    for(const auto& op : ops){
+        quint64 key = routeKey(op.srcSlot, op.destSlot);
+        bool isConnected = connected.contains(key) ? connected.value(key) : m_audioRoutes.contains(key);
+        bool valid = false;
+        switch (op.op) {
+        case ROUTE_CONNECT:
+            valid = m_srcAudioSlotMap.contains(op.srcSlot) && m_destAudioSlotMap.contains(op.destSlot);
+            connected[key] = true;
+            break;
+        case ROUTE_DISCONNECT:
+            valid = isConnected;
+            connected[key] = false;
+            break;
+        case ROUTE_CHANGE_LEVEL:
+            valid = isConnected;
+            break;
+        }
+        if(!valid){
+            m_lib->m_Log->writeLog(2,(QString("applyRouteBatch: batch rejected, invalid operation from slot: ") + QString::number(op.srcSlot) + " to " + QString::number(op.destSlot)));
+            return PJ_EINVAL;
+        }
+    }
+
+    QSet<quint64> changed;
+    QHash<quint64, s_audioRoutes> removed;
+    bool save = false;
+    for(const auto& op : ops){
+        quint64 key = routeKey(op.srcSlot, op.destSlot);
+        int level = op.level;
+        switch (op.op) {
+        case ROUTE_CONNECT:{
+            const s_audioRoutes* existing = getAudioRoute(op.srcSlot, op.destSlot);
+            bool replaced = existing != nullptr;
+            s_audioRoutes previous = replaced ? *existing : s_audioRoutes();
+            pjsua_conf_connect_param param;
+            param.level = 0.5;
+            status = pjsua_conf_connect2(op.srcSlot, op.destSlot, &param);
+            if (status != PJ_SUCCESS)
+                break;
+            s_levelRampMutex.lock();                                        // a running ramp would move the crosspoint back to its target
+            m_levelRamps.remove(key);
+            s_levelRampMutex.unlock();
+            status = pjmedia_conf_adjust_conn_level(intData->mconf, op.srcSlot, op.destSlot, dBtoAdjLevel(level));
+            if (status != PJ_SUCCESS){                                      // don't leave a crosspoint at an unknown level
+                if(replaced)
+                    pjmedia_conf_adjust_conn_level(intData->mconf, op.srcSlot, op.destSlot, dBtoAdjLevel(previous.level));
+                else
+                    pjsua_conf_disconnect(op.srcSlot, op.destSlot);
+                break;
+            }
+            s_audioRoutes route;
+            route.srcSlot = op.srcSlot;
+            route.destSlot = op.destSlot;
+            route.srcDevName = m_srcAudioSlotMap.value(op.srcSlot);
+            route.destDevName = m_destAudioSlotMap.value(op.destSlot);
+            route.level = level;
+            route.persistant = op.persistant;
+            insertRoute(route);
+            (route.persistant || previous.persistant) ? (save = true) : false;     // a replaced persistent route has to leave the journal
+            changed.insert(key);
+            removed.remove(key);
+            break;
+        }
+        case ROUTE_DISCONNECT:{
+            status = pjsua_conf_disconnect(op.srcSlot, op.destSlot);
+            if (status != PJ_SUCCESS)
+                break;
+            s_audioRoutes route = m_audioRoutes.value(key);
+            route.persistant ? (save = true) : false;
+            eraseRoute(op.srcSlot, op.destSlot);
+            removed.insert(key, route);
+            changed.remove(key);
+            break;
+        }
+        case ROUTE_CHANGE_LEVEL:{
+            s_audioRoutes* route = getAudioRoute(op.srcSlot, op.destSlot);
+            int currentLevel = route != nullptr ? route->level : level;
+            status = rampConnLevel(op.srcSlot, op.destSlot, dBtoAdjLevel(currentLevel), dBtoAdjLevel(level));
+            if (status != PJ_SUCCESS)
+                break;
+            if(route != nullptr){
+                route->level = level;
+                route->persistant ? (save = true) : false;
+                changed.insert(key);
+            }
+            break;
+        }
+        }
+        if (status != PJ_SUCCESS){
+            char buf[50];
+            pj_strerror	(status,buf,sizeof (buf) );
+            m_lib->m_Log->writeLog(2,(QString("applyRouteBatch: operation from slot: ") + QString::number(op.srcSlot) + " to " + QString::number(op.destSlot) + " failed: " + buf));
+            result = status;
+        }
+    }
+
+    QList<s_audioRoutes> changedRoutes;
+    for(const quint64 key : qAsConst(changed)){
+        changedRoutes.append(m_audioRoutes.value(key));
+    }
+    m_lib->m_Log->writeLog(3,(QString("applyRouteBatch: applied ") + QString::number(ops.size()) + " operations, " + QString::number(changedRoutes.size()) + " routes changed, " + QString::number(removed.size()) + " removed"));
+    if(save)
+        m_lib->m_Settings->saveAudioRoutes();
+    emit audioRoutesDiff(changedRoutes, removed.values());
+    emit audioRoutesChanged(getAudioRoutes());
+    return result;
+}
+
 void AudioRouter::conferenceBridgeChanged()
 {
-    m_confPortList = listConfPorts();
-    emit audioRoutesTableChanged(m_confPortList);
-    emit audioRoutesChanged(m_audioRoutes);
+    QList<int> portSlots;
+    for(const auto& uidSlots : qAsConst(m_confPortsByUid)){
+        portSlots.append(uidSlots.values());
+    }
+    updateConfPorts(portSlots);
+    for(const auto& uid : m_confPortsByUid.keys()){
+        pruneConfPortIndex(uid);
+    }
+}
+
+void AudioRouter::conferenceBridgeChanged(const QString &uid)
+{
+    updateConfPorts(m_confPortsByUid.value(uid).values());
+    pruneConfPortIndex(uid);
+}
+
+void AudioRouter::pruneConfPortIndex(const QString &uid)
+{
+    auto it = m_confPortsByUid.find(uid);
+    if(it == m_confPortsByUid.end())
+        return;
+    QSet<int> cachedSlots;
+    for(const int slot : qAsConst(it.value())){
+        if(m_confPorts.contains(slot))
+            cachedSlots.insert(slot);
+    }
+    if(cachedSlots.isEmpty())
+        m_confPortsByUid.erase(it);
+    else
+        it.value() = cachedSlots;
+}
+
+s_audioRoutes* AudioRouter::getAudioRoute(int src_slot, int sink_slot)
+{
+    auto it = m_audioRoutes.find(routeKey(src_slot, sink_slot));
+    if(it == m_audioRoutes.end())
+        return nullptr;
+    return &it.value();
+}
+
+QList<s_audioRoutes> AudioRouter::getAudioRoutes() const
+{
+    QList<s_audioRoutes> routes;
+    routes.reserve(m_routeOrder.size());
+    for(const quint64 key : m_routeOrder){
+        routes.append(m_audioRoutes.value(key));
+    }
+    return routes;
+}
+
+void AudioRouter::insertRoute(const s_audioRoutes &route)
+{
+    quint64 key = routeKey(route.srcSlot, route.destSlot);
+    m_audioRoutes.insert(key, route);
+    if(!m_routeSequence.contains(key)){
+        m_routeSequence.insert(key, m_nextRouteSequence);
+        m_routeOrder.insert(m_nextRouteSequence++, key);
+    }
+    m_routesFromSlot[route.srcSlot].insert(route.destSlot);
+    m_routesToSlot[route.destSlot].insert(route.srcSlot);
+}
+
+bool AudioRouter::eraseRoute(int src_slot, int sink_slot)
+{
+    s_levelRampMutex.lock();
+    m_levelRamps.remove(routeKey(src_slot, sink_slot));
+    s_levelRampMutex.unlock();
+    if(m_audioRoutes.remove(routeKey(src_slot, sink_slot)) == 0)
+        return false;
+    m_routeOrder.remove(m_routeSequence.take(routeKey(src_slot, sink_slot)));
+    auto from = m_routesFromSlot.find(src_slot);
+    if(from != m_routesFromSlot.end()){
+        from.value().remove(sink_slot);
+        if(from.value().isEmpty())
+            m_routesFromSlot.erase(from);
+    }
+    auto to = m_routesToSlot.find(sink_slot);
+    if(to != m_routesToSlot.end()){
+        to.value().remove(src_slot);
+        if(to.value().isEmpty())
+            m_routesToSlot.erase(to);
+    }
+    return true;
+}
+
+pj_status_t AudioRouter::rampConnLevel(int src_slot, int sink_slot, int fromAdjust, int toAdjust)
+{
+    pjsua_data* intData = pjsua_get_var();
+    quint64 key = routeKey(src_slot, sink_slot);
+    QMutexLocker locker(&s_levelRampMutex);
+    auto it = m_levelRamps.find(key);
+    if(it != m_levelRamps.end())
+        fromAdjust = it.value().current;                    // continue from the level the running ramp reached
+
+    if(fromAdjust == toAdjust || (m_levelRampSlot == PJSUA_INVALID_ID && !addLevelRampPort())){     // without the ramp port the level is set at once
+        m_levelRamps.remove(key);
+        return pjmedia_conf_adjust_conn_level(intData->mconf, src_slot, sink_slot, toAdjust);
+    }
+    s_levelRamp ramp;
+    ramp.srcSlot = src_slot;
+    ramp.destSlot = sink_slot;
+    ramp.target = toAdjust;
+    ramp.steps = LEVELRAMP_STEPS - 1;
+    ramp.current = fromAdjust + (toAdjust - fromAdjust) / LEVELRAMP_STEPS;   // the first step is set now to check the slots
+    pj_status_t status = pjmedia_conf_adjust_conn_level(intData->mconf, src_slot, sink_slot, ramp.current);
+    if(status != PJ_SUCCESS){
+        m_levelRamps.remove(key);
+        return status;
+    }
+    m_levelRamps.insert(key, ramp);
+    return status;
+}
+
+bool AudioRouter::addLevelRampPort()
+{
+    pjsua_conf_port_info masterPortInfo;
+    pj_status_t status = pjsua_conf_get_port_info( 0, &masterPortInfo );                // the ramp port runs at the frame rate of the bridge
+    if (status == PJ_SUCCESS) {
+        pj_str_t name = pj_str(const_cast<char*>("awahramp"));
+        pj_bzero(&s_levelRampPort, sizeof(s_levelRampPort));
+        pjmedia_port_info_init(&s_levelRampPort.info, &name, LEVELRAMP_SIGNATURE, masterPortInfo.clock_rate, 1, 16,
+                               masterPortInfo.samples_per_frame / qMax(1u, masterPortInfo.channel_count));
+        s_levelRampPort.put_frame = &AudioRouter::levelRampPutFrame;
+        s_levelRampRouter = this;
+        status = pjsua_conf_add_port(m_lib->pool, &s_levelRampPort, &m_levelRampSlot);
+    }
+    if (status != PJ_SUCCESS) {
+        char buf[50];
+        pj_strerror(status,buf,sizeof (buf));
+        m_lib->m_Log->writeLog(1,(QString("addLevelRampPort: level changes are not ramped: ") + buf));
+        s_levelRampRouter = nullptr;
+        m_levelRampSlot = PJSUA_INVALID_ID;
+        return false;
+    }
+    return true;
+}
+
+pj_status_t AudioRouter::levelRampPutFrame(pjmedia_port *port, pjmedia_frame *frame)
+{
+    Q_UNUSED(port);
+    Q_UNUSED(frame);                                    // a frame without audio, nothing is connected to the ramp port
+    if (s_levelRampMutex.tryLock()) {                   // never wait in the media thread, the ramps continue with the next frame
+        if (s_levelRampRouter && !s_levelRampRouter->m_levelRamps.isEmpty())
+            s_levelRampRouter->levelRampStep();
+        s_levelRampMutex.unlock();
+    }
+    return PJ_SUCCESS;
+}
+
+void AudioRouter::levelRampStep()
+{
+    pjsua_data* intData = pjsua_get_var();
+    auto it = m_levelRamps.begin();
+    while(it != m_levelRamps.end()){
+        s_levelRamp &ramp = it.value();
+        ramp.current += (ramp.target - ramp.current) / qMax(1, ramp.steps);
+        ramp.steps--;
+        if(ramp.steps <= 0)
+            ramp.current = ramp.target;
+        pj_status_t status = pjmedia_conf_adjust_conn_level(intData->mconf, ramp.srcSlot, ramp.destSlot, ramp.current);
+        if(status != PJ_SUCCESS || ramp.current == ramp.target)
+            it = m_levelRamps.erase(it);
+        else
+            ++it;
+    }
+}
+
+QList<s_audioRoutes> AudioRouter::routesOfSlot(int slot) const
+{
+    QList<s_audioRoutes> routes;
+    for(const int sink : m_routesFromSlot.value(slot)){
+        routes.append(m_audioRoutes.value(routeKey(slot, sink)));
+    }
+    for(const int src : m_routesToSlot.value(slot)){
+        if(src == slot)                                     // a loopback route is already in the list
+            continue;
+        routes.append(m_audioRoutes.value(routeKey(src, slot)));
+    }
+    return routes;
 }
 
 void AudioRouter::removeAllRoutesFromSlot(int slot)
 {
     pj_status_t status;
     bool save = false;
-    QMutableListIterator<s_audioRoutes> i(m_audioRoutes);
-    while(i.hasNext()){
-        s_audioRoutes& route = i.next();
-        if(route.srcSlot == slot || route.destSlot == slot){
-            status = pjsua_conf_disconnect(route.srcSlot, route.destSlot);
-            if (status != PJ_SUCCESS){
-                char buf[50];
-                pj_strerror	(status,buf,sizeof (buf) );
-                m_lib->m_Log->writeLog(2,(QString("RemoveAllRoutesFromSlot: disconnect slot failed from slot: ") + QString::number(route.srcSlot) + " : " + buf));
-            }
-            route.persistant ? (save = true) : false;
-            i.remove();
+    for(auto& route : routesOfSlot(slot)){
+        status = pjsua_conf_disconnect(route.srcSlot, route.destSlot);
+        if (status != PJ_SUCCESS){
+            char buf[50];
+            pj_strerror	(status,buf,sizeof (buf) );
+            m_lib->m_Log->writeLog(2,(QString("RemoveAllRoutesFromSlot: disconnect slot failed from slot: ") + QString::number(route.srcSlot) + " : " + buf));
         }
+        route.persistant ? (save = true) : false;
+        eraseRoute(route.srcSlot, route.destSlot);
     }
     if(save)
         m_lib->m_Settings->saveAudioRoutes();
@@ -1082,14 +1379,12 @@ void AudioRouter::removeAllRoutesFromSlot(int slot)
 
 void AudioRouter::removeAllRoutesFromAccount(const s_account account)
 {
-    int slot;
-    for (unsigned int i = 0; i< m_lib->epCfg.medConfig.channelCount; i++){
-        slot = m_srcAudioSlotMap.key(QString("Acc:" + account.uid + "-Ch:" + QString::number(i+1)), -1);
-        if(slot != -1){
-            removeAllRoutesFromSlot(slot);
-        }else{
-            m_lib->m_Log->writeLog(2,(QString("Slot for Account ") + account.name + " Ch: " + QString::number(i+1) + " not found! No Routes could be removed!"));
-        }
+    const QList<int> portSlots = getSlotsByUID(account.uid);
+    if(portSlots.isEmpty()){
+        m_lib->m_Log->writeLog(2,(QString("Slots for Account ") + account.name + " not found! No Routes could be removed!"));
+    }
+    for(const int slot : portSlots){
+        removeAllRoutesFromSlot(slot);
     }
 }
 
@@ -1097,11 +1392,11 @@ void AudioRouter::changeConfportsrcName(const QString portName, const QString cu
 {
     if(customName.isEmpty()){
         m_customSourceLabels[portName].clear();
-        conferenceBridgeChanged();
+        updateConfPorts({m_confPortSlots.value(portName, PJSUA_INVALID_ID)});
         return;
     }
     m_customSourceLabels[portName] = customName;
-    conferenceBridgeChanged();
+    updateConfPorts({m_confPortSlots.value(portName, PJSUA_INVALID_ID)});
     m_lib->m_Settings->saveCustomSourceNames();
 }
 
@@ -1109,11 +1404,11 @@ void AudioRouter::changeConfportdstName(const QString portName, const QString cu
 {
     if(customName.isEmpty()){
         m_customDestLabels[portName].clear();
-        conferenceBridgeChanged();
+        updateConfPorts({m_confPortSlots.value(portName, PJSUA_INVALID_ID)});
         return;
     }
     m_customDestLabels[portName] = customName;
-    conferenceBridgeChanged();
+    updateConfPorts({m_confPortSlots.value(portName, PJSUA_INVALID_ID)});
     m_lib->m_Settings->saveCustomDestinationNames();
 }
 
@@ -1140,6 +1435,136 @@ void AudioRouter::removeAllCustomNamesWithUID(const QString uid)
 }
 
 
+void AudioRouter::updateClockDrift()
+{
+    for(auto& device : m_AudioDevices){
+        if(device.adapter != nullptr){
+            device.captureDriftPpm = device.adapter->captureDriftPpm();
+            device.playbackDriftPpm = device.adapter->playbackDriftPpm();
+        }
+        else{
+            device.captureDriftPpm = 0;
+            device.playbackDriftPpm = 0;
+        }
+    }
+}
+
+void AudioRouter::retireAdapter(s_IODevices &device)
+{
+    retireAdapter(device.adapter);
+    device.adapter = nullptr;
+}
+
+void AudioRouter::retireAdapter(MultichannelAdapter *adapter)
+{
+    if(adapter == nullptr)
+        return;
+    m_retiredAdapters.append(qMakePair(QDateTime::currentMSecsSinceEpoch(), adapter));
+    QTimer::singleShot(ADAPTER_RETIRE_MS, this, &AudioRouter::purgeRetiredAdapters);
+}
+
+void AudioRouter::discardSoundDevice(pjmedia_snd_port *soundport, MultichannelAdapter *adapter, const QList<int> &portSlots)
+{
+    for(const int slot : portSlots){
+        pjsua_conf_remove_port(slot);
+        unregisterConfPort(slot);
+    }
+    pjmedia_snd_port_destroy(soundport);
+    retireAdapter(adapter);                             // the bridge may still call the removed channel ports for a moment
+}
+
+void AudioRouter::purgeRetiredAdapters()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while(!m_retiredAdapters.isEmpty() && now - m_retiredAdapters.first().first >= ADAPTER_RETIRE_MS){
+        delete m_retiredAdapters.takeFirst().second;
+    }
+}
+
+bool AudioRouter::resolveSoundDeviceNames(s_IODevices &device)
+{
+    s_soundCard card, current;
+    bool plugged = true;
+    if(device.typeSpecificSettings.contains("recordCard")){
+        card.fromJSON(device.typeSpecificSettings["recordCard"].toObject());
+        current = SoundDeviceMonitor::cardOfStored(card);
+        if(card.isValid() && current.isValid())
+            device.inputname = SoundDeviceMonitor::deviceNameOnCard(device.inputname, current);
+        else if(card.isValid())
+            plugged = false;
+    }
+    if(device.typeSpecificSettings.contains("playbackCard")){
+        card.fromJSON(device.typeSpecificSettings["playbackCard"].toObject());
+        current = SoundDeviceMonitor::cardOfStored(card);
+        if(card.isValid() && current.isValid())
+            device.outputame = SoundDeviceMonitor::deviceNameOnCard(device.outputame, current);
+        else if(card.isValid())
+            plugged = false;
+    }
+    return plugged;
+}
+
+void AudioRouter::restoreOfflineRoutes(const QString &uid)
+{
+    const QString portPrefix = "AD:" + uid + "-";
+    QMutableListIterator<s_audioRoutes> i(m_offlineRoutes);
+    while(i.hasNext()){
+        s_audioRoutes& route = i.next();
+        if(!route.srcDevName.startsWith(portPrefix) && !route.destDevName.startsWith(portPrefix))
+            continue;
+        route.srcSlot = getSrcSlotByName(route.srcDevName);
+        route.destSlot = getDestSlotByName(route.destDevName);
+        if(route.srcSlot == PJSUA_INVALID_ID || route.destSlot == PJSUA_INVALID_ID)    // the other end is still offline
+            continue;
+        int check = connectConfPort(route.srcSlot, route.destSlot, route.level, route.persistant);
+        if(check == PJ_SUCCESS){
+            m_lib->m_Log->writeLog(3,QString("restoreOfflineRoutes: added AudioRoute from: ") + route.srcDevName + " to " + route.destDevName);
+            i.remove();
+        }
+    }
+}
+
+void AudioRouter::soundCardsChanged(QStringList added, QStringList removed)
+{
+    QStringList lost, found;
+    pjmedia_aud_dev_refresh();
+    for(const auto& device : qAsConst(m_AudioDevices)){
+        if(device.devicetype != SoundDevice || device.RecDevID == -1 || device.PBDevID == -1)
+            continue;
+        QString recordCard = s_soundCard().fromJSON(device.typeSpecificSettings["recordCard"].toObject())->identity();
+        QString playbackCard = s_soundCard().fromJSON(device.typeSpecificSettings["playbackCard"].toObject())->identity();
+        if(removed.contains(recordCard) || removed.contains(playbackCard)
+                || getSoundDevID(device.inputname) == -1 || getSoundDevID(device.outputame) == -1)   // devices without a card identity are matched by name
+            lost.append(device.uid);
+    }
+    for(const auto& uid : lost){
+        const s_IODevices* device = getADeviceByUID(uid);
+        m_lib->m_Log->writeLog(3,QString("soundCardsChanged: sound device: ") + device->inputname + " lost!");
+        setAudioDeviceToOffline(device->inputname, device->outputame, uid);
+    }
+
+    for(auto& device : m_AudioDevices){
+        if(device.devicetype != SoundDevice)
+            continue;
+        if(device.RecDevID > -1 && device.PBDevID > -1){                // the device ids of pjmedia change with every refresh
+            device.RecDevID = getSoundDevID(device.inputname);
+            device.PBDevID = getSoundDevID(device.outputame);
+        }
+        else if(!added.isEmpty()){
+            if(resolveSoundDeviceNames(device)                          // another card in the port of ours may have the same names
+                    && getSoundDevID(device.inputname) > -1 && getSoundDevID(device.outputame) > -1)
+                found.append(device.uid);
+        }
+    }
+    for(const auto& uid : found){
+        const s_IODevices* device = getADeviceByUID(uid);
+        m_lib->m_Log->writeLog(3,QString("soundCardsChanged: offline sound device: ") + device->inputname + " is now avaliable ");
+        addAudioDevice(getSoundDevID(device->inputname), getSoundDevID(device->outputame), uid);
+        restoreOfflineRoutes(uid);
+    }
+    m_sounddevCount = pjmedia_snd_get_dev_count();
+}
+
 void AudioRouter::SoundDeviceInspector()
 {
     pjmedia_aud_dev_refresh() ;
@@ -1161,19 +1586,7 @@ void AudioRouter::SoundDeviceInspector()
                         int pbDevId = getSoundDevID(audiodev.outputame);
                         m_lib->m_Log->writeLog(3,QString("SoundDeviceInspector: offline sound device: ") + audiodev.inputname + " is now avaliable ");
                         addAudioDevice(recDevId,pbDevId,audiodev.uid);
-                        const QMap<int, QString> srcAudioSlotMap = getSrcAudioSlotMap();
-                        const QMap<int, QString> destAudioSlotMap = getDestAudioSlotMap();
-                        QMutableListIterator<s_audioRoutes> i(m_offlineRoutes);
-                        while(i.hasNext()){
-                            s_audioRoutes& route = i.next();
-                            route.srcSlot = srcAudioSlotMap.key(route.srcDevName, -1);
-                            route.destSlot = destAudioSlotMap.key(route.destDevName, -1);
-                            int check = m_lib->m_AudioRouter->connectConfPort(route.srcSlot, route.destSlot, route.level, route.persistant);
-                            if(check == PJ_SUCCESS){
-                                m_lib->m_Log->writeLog(3,QString("SoundDeviceInspector: added AudioRoute from: ") + route.srcDevName + " to " + route.destDevName);
-                                i.remove();
-                            }
-                        }
+                        restoreOfflineRoutes(audiodev.uid);
                     }
                 }
             }
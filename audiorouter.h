@@ -21,10 +21,16 @@
 
 #include <QObject>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include "types.h"
 #include <QTimer>
 
 class AWAHSipLib;
+class SoundDeviceMonitor;
+
+#define LEVELRAMP_STEPS 8                   // crosspoint level changes are spread over this many audio frames to avoid zipper noise
+#define ADAPTER_RETIRE_MS 1000              // delay before a removed sound device adapter is deleted, see m_retiredAdapters
 
 class AudioRouter : public QObject
 {
@@ -35,9 +41,17 @@ public:
 
     /**
     * @brief get the active audio routes
-    * @return the audioRoutes struct
+    * @return the audioRoutes struct in the order the routes were connected
+    */
+    QList <s_audioRoutes> getAudioRoutes() const;
+
+    /**
+    * @brief get a single active audio route
+    * @param src_slot ID if the source slot
+    * @param sink_slot ID of the sink_slot
+    * @return a pointer to the route or nullptr if the two slots are not connected
     */
-    QList <s_audioRoutes> getAudioRoutes() { return m_audioRoutes; };
+    s_audioRoutes* getAudioRoute(int src_slot, int sink_slot);
 
     /**
     * @brief get the offline audio routes
@@ -100,8 +114,17 @@ public:
     * @param inputName  the Name of the Input device
     * @param outputName the name of the output devie
     * @param uid the uid of the device
+    * @param typeSpecificSettings the saved settings of the device, e.g. the identity of its sound cards
+    */
+    void setAudioDeviceToOffline(QString inputName, QString outputName, QString uid, const QJsonObject &typeSpecificSettings = QJsonObject());
+
+    /**
+    * @brief update the device names of a sound device if its sound cards are plugged with another card index or id,
+    *        e.g. when two equal USB interfaces were plugged in the other order
+    * @param device the device, its typeSpecificSettings contain the identity of the cards
+    * @return false if a card of the device is not plugged, another card may have its old names then
     */
-    void setAudioDeviceToOffline(QString inputName, QString outputName, QString uid);
+    bool resolveSoundDeviceNames(s_IODevices &device);
 
     /**
     * @brief remove a an audio device from the conference bridge.
@@ -163,6 +186,17 @@ public:
     */
     void changeConfPortLevel(int src_slot, int sink_slot, int level);
 
+    /**
+    * @brief Apply a list of connect, disconnect and level changes to the conference bridge in one pass
+    * @details the whole batch is validated first, if an operation refers to an unknown slot or route nothing is changed.
+    *          If an operation fails in the bridge it is skipped and the batch goes on: the operations before and after it
+    *          stay applied, there is no rollback. A connect whose level can't be set is undone (or keeps the level of the
+    *          route it replaced). The routes are saved once and audioRoutesChanged and audioRoutesDiff are emitted once for the whole batch
+    * @param ops the operations in the order they are applied
+    * @return PJ_SUCCESS, PJ_EINVAL if the batch was rejected or the error code of the last failed operation
+    */
+    int applyRouteBatch(const QList<s_audioRouteOp> &ops);
+
     /**
     * @brief Add a sine wave generator
     * @param frequ Frequency in Hz
@@ -202,9 +236,51 @@ public:
     */
     QList<s_IODevices>* getAudioDevices() { return &m_AudioDevices; };
 
+    /**
+    * @brief copy the current clock drift estimates of the sound device adapters to the device list
+    */
+    void updateClockDrift();
+
+    /**
+    * @brief Update the sources and destinations of all cached conference ports and emit the changes
+    */
     void conferenceBridgeChanged();
+
+    /**
+    * @brief Update only the sources and destinations of a device or an account and emit the changes
+    * @param uid the uid of the device or account that was added, modified or removed
+    */
+    void conferenceBridgeChanged(const QString &uid);
     void removeAllRoutesFromAccount(const s_account account);
 
+    /**
+    * @brief get the owner, channel and direction of a conference port
+    * @param slot the slot of the port
+    * @return a pointer to the port info or nullptr if the port was not added by the router
+    */
+    const s_confPortInfo* getConfPortInfo(int slot) const;
+
+    /**
+    * @brief get all conference ports of a device or an account
+    * @param uid the uid of the device or account
+    * @return the slots in ascending order
+    */
+    QList<int> getSlotsByUID(const QString &uid) const;
+
+    /**
+    * @brief get the slot of a source by its port name
+    * @param pjName the name of the port in the conference bridge e.g. "AD:<uid>-Ch:3"
+    * @return the slot or PJSUA_INVALID_ID if there is no such source
+    */
+    int getSrcSlotByName(const QString &pjName) const;
+
+    /**
+    * @brief get the slot of a destination by its port name
+    * @param pjName the name of the port in the conference bridge e.g. "AD:<uid>-Ch:3"
+    * @return the slot or PJSUA_INVALID_ID if there is no such destination
+    */
+    int getDestSlotByName(const QString &pjName) const;
+
     QMap<int, QString> getSrcAudioSlotMap() const { return m_srcAudioSlotMap; };
     QMap<int, QString> getDestAudioSlotMap() const { return m_destAudioSlotMap; };
     QMap<QString, QString> getCustomSourceLabels() const { return m_customSourceLabels; };
@@ -232,18 +308,33 @@ signals:
     */
     void confportLevelChanged(s_audioRoutes changedRoute);
 
+    /**
+    * @brief Signal with the routes touched by a batch of crosspoint changes
+    * @param changedRoutes routes that were connected or got a new level
+    * @param removedRoutes routes that were disconnected
+    */
+    void audioRoutesDiff(const QList<s_audioRoutes>& changedRoutes, const QList<s_audioRoutes>& removedRoutes);
+
     /**
     * @brief Signal if audio route Table from the conference-bridge changed
     * @param portList all Sources and Sinks as Struct
     */
     void audioRoutesTableChanged(const s_audioPortList& portList);
 
+    /**
+    * @brief Signal with the sources and destinations that changed in the conference-bridge
+    * @param changedPorts ports that were added or relabeled
+    * @param removedPorts ports that are gone
+    */
+    void audioPortsChanged(const s_audioPortList& changedPorts, const s_audioPortList& removedPorts);
+
 private:
     AWAHSipLib* m_lib;
     QMap<int, QString> m_srcAudioSlotMap;
     QMap<int, QString> m_destAudioSlotMap;
     s_audioPortList m_confPortList;
-    QTimer *m_SoundDeviceInspectorTimer;
+    QTimer *m_SoundDeviceInspectorTimer;                // only used if the sound device monitor can't watch the system
+    SoundDeviceMonitor *m_SoundDeviceMonitor;
     uint8_t m_sounddevCount = 0;
     pjmedia_master_port *themaster = nullptr;
 
@@ -254,9 +345,33 @@ private:
     QList<s_IODevices> m_AudioDevices;
 
     /**
-    * @brief All routes from the conference bridge are added to this list
+    * @brief All routes from the conference bridge are indexed by (srcSlot,destSlot), see routeKey()
+    * @details m_routeOrder keeps the keys in the order the routes were connected, a route that is connected again
+    * keeps its place
+    */
+    QHash<quint64, s_audioRoutes> m_audioRoutes;
+    QMap<quint64, quint64> m_routeOrder;                // insertion sequence -> route key
+    QHash<quint64, quint64> m_routeSequence;            // route key -> insertion sequence
+    quint64 m_nextRouteSequence = 0;
+
+    /**
+    * @brief adjacency lists of the route index
+    * @details m_routesFromSlot maps a source slot to all connected sink slots,
+    * m_routesToSlot maps a sink slot to all connected source slots
+    */
+    QHash<int, QSet<int>> m_routesFromSlot;
+    QHash<int, QSet<int>> m_routesToSlot;
+
+    static quint64 routeKey(int src_slot, int sink_slot) { return (quint64(quint32(src_slot)) << 32) | quint32(sink_slot); };
+    void insertRoute(const s_audioRoutes &route);
+    bool eraseRoute(int src_slot, int sink_slot);
+
+    /**
+    * @brief get all routes where the slot is either source or sink
+    * @param slot the conference bridge slot
+    * @return list of the affected routes
     */
-    QList<s_audioRoutes> m_audioRoutes;
+    QList<s_audioRoutes> routesOfSlot(int slot) const;
 
     /**
     * @brief offline routes are stored here
@@ -268,10 +383,43 @@ private:
     void removeAllRoutesFromSlot(int slot);
 
     /**
-    * @brief List all active conference ports
-    * @return Struct with names and Slot IDs for Sources and Destinations
+    * @brief Registry of the conference ports added by the router, filled when the ports are created
+    * @details the published sources and destinations are kept per slot and only the slots of the
+    * device or account that changed are updated, see conferenceBridgeChanged(uid)
+    */
+    QMap<int, s_confPortInfo> m_confPorts;
+    QHash<QString, int> m_confPortSlots;                // pjName -> slot
+    QHash<QString, QSet<int>> m_confPortsByUid;
+    QMap<int, s_audioPort> m_srcPorts;
+    QMap<int, s_audioPort> m_destPorts;
+
+    /**
+    * @brief Register a port added to the conference bridge with its owner
+    * @param slot the slot of the new port
+    * @param pjName the name of the port in the conference bridge
+    * @param owner the kind of device or account the port belongs to
+    * @param uid the uid of the device or account
+    * @param channel the channel starting at 1 or 0 if the owner has only one port
+    * @param direction ConfPortSource and/or ConfPortDestination
+    */
+    void registerConfPort(int slot, const pj_str_t &pjName, ConfPortOwner owner, const QString &uid, uint channel, int direction);
+
+    /**
+    * @brief Remove a port from the registry after it is removed from the conference bridge
+    * @param slot the removed slot
+    */
+    void unregisterConfPort(int slot);
+
+    static int soundDevPortDirection(uint channel, uint inChannelCount, uint outChannelCount);
+
+    /**
+    * @brief Rebuild the published source and destination of the given slots and emit the changes
+    * @param portSlots the slots to update
     */
-    s_audioPortList listConfPorts();
+    void updateConfPorts(const QList<int> &portSlots);
+    void updateConfPort(int slot, s_audioPortList &changedPorts, s_audioPortList &removedPorts);
+    void pruneConfPortIndex(const QString &uid);
+    void publishConfPort(const s_audioPort &port, bool present, QMap<int, s_audioPort> &ports, QMap<int, QString> &slotMap, QList<s_audioPort> &changedPorts, QList<s_audioPort> &removedPorts);
 
     /**
     * @brief Custom lables for souces are mapped
@@ -281,6 +429,55 @@ private:
     QMap<QString,QString> m_customSourceLabels;
     QMap<QString,QString> m_customDestLabels;
 
+    /**
+    * @brief running crosspoint level ramps indexed by routeKey()
+    * @details a level change of a connected route is applied in LEVELRAMP_STEPS steps, one per audio frame,
+    * instead of one jump. A new level during a ramp continues from the level reached so far.
+    * The steps are taken by the media thread: the ramp port is a bridge port without connections, the bridge
+    * calls its put_frame once per audio frame. The ramps are guarded by a mutex the media thread only tries to lock
+    */
+    struct s_levelRamp{
+        int srcSlot;
+        int destSlot;
+        int current;                        // pjsua level adjust currently set in the bridge
+        int target;
+        int steps;                          // steps left
+    };
+    QHash<quint64, s_levelRamp> m_levelRamps;
+    int m_levelRampSlot = PJSUA_INVALID_ID;
+    pj_status_t rampConnLevel(int src_slot, int sink_slot, int fromAdjust, int toAdjust);
+    bool addLevelRampPort();
+    static pj_status_t levelRampPutFrame(pjmedia_port *port, pjmedia_frame *frame);
+
+    /**
+    * @brief apply the next step of every running level ramp, called by the media thread with the ramp mutex locked
+    */
+    void levelRampStep();
+
+    /**
+    * @brief adapters of removed sound devices with the time they were retired
+    * @details the conference bridge removes ports asynchronously and may still call into the channel ports
+    * for a short time, so an adapter is only deleted ADAPTER_RETIRE_MS after its device was closed.
+    * Adapters still in use at shutdown are left to the bridge, it calls them until the library is destroyed
+    */
+    QList<QPair<qint64, MultichannelAdapter*>> m_retiredAdapters;
+    void retireAdapter(s_IODevices &device);
+    void retireAdapter(MultichannelAdapter *adapter);
+
+    /**
+    * @brief undo a sound device that could not be added completely
+    * @param soundport the opened sound port, it is destroyed
+    * @param adapter the adapter of the device, it is retired
+    * @param portSlots the channel ports already added to the conference bridge, they are removed and unregistered
+    */
+    void discardSoundDevice(pjmedia_snd_port *soundport, MultichannelAdapter *adapter, const QList<int> &portSlots);
+
+    /**
+    * @brief connect the saved routes of a sound device that is online again
+    * @param uid the uid of the device, only routes from or to its ports are restored
+    */
+    void restoreOfflineRoutes(const QString &uid);
+
 private slots:
     /**
     * @brief SoundDeviceInspector checks the avaliable sound devices, if there is a change in the system
@@ -288,6 +485,15 @@ private slots:
     * @brief with this sound devices are hot pluggable
     */
     void SoundDeviceInspector();
+
+    /**
+    * @brief sets the sound devices on removed cards offline and opens the offline devices on added cards again
+    * @param added identities of the new cards
+    * @param removed identities of the cards that are gone
+    */
+    void soundCardsChanged(QStringList added, QStringList removed);
+
+    void purgeRetiredAdapters();
 };
 
 #endif // AUDIOROUTER_H
@@ -17,6 +17,7 @@
  */
 
 #include "awahsiplib.h"
+#include "audiokernels.h"
 #include "pjsua-lib/pjsua_internal.h"
 
 AWAHSipLib *AWAHSipLib::AWAHSipLibInstance = NULL;
@@ -45,25 +46,37 @@ AWAHSipLib::AWAHSipLib(QObject *parent) : QObject(parent)
     m_pjEp = PJEndpoint::instance();
     m_pjEp->setAwahLibrary(this);
 
-    try{
-        m_pjEp->libCreate();
+    AWAHSipLibInstance = this;          // the GPIO devices created during the startup use instance()
 
+    // the startup as a dependency graph, see StartupOrchestrator. pjsua and the managers are not thread safe,
+    // so only the config journal is read concurrently while pjsua is initialized.
+    m_Startup = new StartupOrchestrator(this, this);
+    m_Startup->addStage("libCreate", {}, [this]() {
+        m_pjEp->libCreate();
+    });
+    m_Startup->addStage("loadSettings", {"libCreate"}, [this]() {
         // read config from config file:
         m_Settings->loadSettings();
         epCfg.uaConfig.userAgent = "AWAHSip";
         epCfg.uaConfig.natTypeInSdp = 0;
 //        epCfg.medConfig.rxDropPct = RX_DROP_PACKAGE;
 //        epCfg.medConfig.txDropPct = TX_DROP_PACKAGE;
-
         m_Log = new Log(this, this);
+    });
+    m_Startup->addStage("openConfigJournal", {"loadSettings"}, [this]() {
+        m_Settings->openConfigStore();
+    }, true);
+    m_Startup->addStage("libInit", {"loadSettings"}, [this]() {
         m_pjEp->libInit(epCfg);
         //m_pjEp->audDevManager().setNullDev();                  // set a nulldevice as masterdevice
-
+    });
+    m_Startup->addStage("transportCreate", {"libInit"}, [this]() {
         if(TransportProtocol=="TCP")
             m_pjEp->transportCreate(PJSIP_TRANSPORT_TCP, tCfg);
         else
             m_pjEp->transportCreate(PJSIP_TRANSPORT_UDP, tCfg);
-
+    });
+    m_Startup->addStage("libStart", {"transportCreate"}, [this]() {
         // Start the library (worker threads etc)
         m_pjEp->libStart();
 
@@ -76,17 +89,34 @@ AWAHSipLib::AWAHSipLib(QObject *parent) : QObject(parent)
 
         /* Create pool for multiple Sound Device handling */
         pool = pjsua_pool_create("awahsip", 512, 512);
+    });
+    m_Startup->addStage("loadCustomNames", {"libStart", "openConfigJournal"}, [this]() {
         m_Settings->loadCustomDestinationNames();
         m_Settings->loadCustomSourceNames();
+    });
+    m_Startup->addStage("loadIODevConfig", {"loadCustomNames"}, [this]() {
         m_Settings->loadIODevConfig();
+    });
+    m_Startup->addStage("loadAccConfig", {"loadCustomNames"}, [this]() {
         m_Settings->loadAccConfig();
+    });
+    m_Startup->addStage("loadAudioRoutes", {"loadIODevConfig", "loadAccConfig"}, [this]() {
         m_Settings->loadAudioRoutes();
+    });
+    m_Startup->addStage("startCallInspector", {"loadAccConfig"}, [this]() {
         m_Accounts->startCallInspector();
-        m_Settings->loadGpioDevConfig();
+    });
+    m_Startup->addStage("loadGpioDevConfig", {"loadAccConfig", "loadAudioRoutes"}, [this]() {
+        m_Settings->loadGpioDevConfig();                // also loads the GPIO routes
+    });
+    m_Startup->addStage("listCodecs", {"libStart"}, [this]() {
         m_Codecs->listCodecs();
+    });
+    m_Startup->addStage("loadBuddies", {"loadAccConfig", "listCodecs"}, [this]() {
         m_Settings->loadBuddies();
         m_Buddies->StartBuddyChecker();
-
+    });
+    m_Startup->addStage("defaultCodecParam", {"listCodecs"}, [this]() {
         //******************************************* set default opus parameters *******************
          s_codec defaultCodec;
          defaultCodec.encodingName = "opus/48000/2";
@@ -102,11 +132,8 @@ AWAHSipLib::AWAHSipLib(QObject *parent) : QObject(parent)
          defaultCodec.codecParameters = codecParam;
          m_Codecs->setCodecParam(defaultCodec);
        // ***********************************************************************************************
-
-    }
-    catch (Error &err){
-        m_Log->writeLog(1,QString("AWAHsip: starting lib failed: ") + err.info().c_str());
-    }
+    });
+    bool startupOk = m_Startup->run();
 
     m_Websocket = new Websocket(m_websocketPort, this, this);
 
@@ -119,7 +146,9 @@ AWAHSipLib::AWAHSipLib(QObject *parent) : QObject(parent)
     connect(m_Log, &Log::logMessage, this, &AWAHSipLib::logMessage);
     connect(m_AudioRouter, &AudioRouter::audioRoutesChanged, this, &AWAHSipLib::audioRoutesChanged);
     connect(m_AudioRouter, &AudioRouter::confportLevelChanged, this, &AWAHSipLib::confportLevelChanged);
+    connect(m_AudioRouter, &AudioRouter::audioRoutesDiff, this, &AWAHSipLib::audioRoutesDiff);
     connect(m_AudioRouter, &AudioRouter::audioRoutesTableChanged, this, &AWAHSipLib::audioRoutesTableChanged);
+    connect(m_AudioRouter, &AudioRouter::audioPortsChanged, this, &AWAHSipLib::audioPortsChanged);
     connect(m_Accounts, &Accounts::AccountsChanged, this, &AWAHSipLib::AccountsChanged);
     connect(m_Accounts, &Accounts::callInfo, this, &AWAHSipLib::callInfo);
     connect(m_AudioRouter, &AudioRouter::AudioDevicesChanged, this, &AWAHSipLib::AudioDevicesChanged);
@@ -141,7 +170,9 @@ AWAHSipLib::AWAHSipLib(QObject *parent) : QObject(parent)
     connect(this, &AWAHSipLib::logMessage, m_Websocket, &Websocket::logMessage);
     connect(this, &AWAHSipLib::audioRoutesChanged, m_Websocket, &Websocket::audioRoutesChanged);
     connect(this, &AWAHSipLib::confportLevelChanged, m_Websocket, &Websocket::confportLevelChanged);
+    connect(this, &AWAHSipLib::audioRoutesDiff, m_Websocket, &Websocket::audioRoutesDiff);
     connect(this, &AWAHSipLib::audioRoutesTableChanged, m_Websocket, &Websocket::audioRoutesTableChanged);
+    connect(this, &AWAHSipLib::audioPortsChanged, m_Websocket, &Websocket::audioPortsChanged);
     connect(this, &AWAHSipLib::AccountsChanged, m_Websocket, &Websocket::AccountsChanged);
     connect(this, &AWAHSipLib::callInfo, m_Websocket, &Websocket::callInfo);
     connect(this, &AWAHSipLib::gpioRoutesChanged, m_Websocket, &Websocket::gpioRoutesChanged);
@@ -150,14 +181,19 @@ AWAHSipLib::AWAHSipLib(QObject *parent) : QObject(parent)
     connect(this, &AWAHSipLib::gpioStateChanged, m_Websocket, &Websocket::gpioStatesChanged);
     connect(this, &AWAHSipLib::IoDevicesChanged, m_Websocket, &Websocket::ioDevicesChanged);
 
+    // queued so the application can connect after instance() returned
+    QMetaObject::invokeMethod(this, [this, startupOk]() { emit startupFinished(startupOk); }, Qt::QueuedConnection);
+
 }
 
 AWAHSipLib::~AWAHSipLib()
 {
     pjsua_call_hangup_all();
     m_Log->writeLog(3,"**** shuting down AWAHsip lib  ****");
+    m_Settings->flush();                // write pending config changes while all managers exist
     delete m_AudioRouter;               // remove all sound devices before destroying the endpoint.
     m_pjEp->libDestroy();
+    m_Settings->stopPersistence(AccountsSection | BuddiesSection | GpioDevSection | GpioRoutesSection);      // call history of the calls hung up above
     m_Log->writeLog(3,"**** shuting down AWAHsip lib ... done ****");
 
     delete m_Accounts;
@@ -167,6 +203,8 @@ AWAHSipLib::~AWAHSipLib()
     delete m_Log;
     delete m_MessageManager;
     delete m_Settings;
+    if(AWAHSipLibInstance == this)
+        AWAHSipLibInstance = NULL;
 }
 
 void AWAHSipLib::prepareLib()
@@ -182,6 +220,7 @@ void AWAHSipLib::prepareLib()
 QList<s_IODevices> &AWAHSipLib::getIoDevices()
 {
     m_IoDevices.clear();
+    m_AudioRouter->updateClockDrift();
     m_IoDevices.append(getAudioDevices());
     m_IoDevices.append(getGpioDevices());
     return m_IoDevices;
@@ -205,6 +244,8 @@ QJsonObject AWAHSipLib::getVersions()
     versions["AWAH-Sip_Lib"] = AWAHSIP_VERSION;
     versions["build"] = BUILD_NO;
     versions["PJSIP"] = QString::fromStdString(m_pjEp->libVersion().full);
+    versions["startupMs"] = m_Startup->elapsedMs();
+    versions["audioKernels"] = AudioKernels::instructionSet();
     return versions;
 }
 
@@ -53,6 +53,7 @@ extern "C" {
 #include "log.h"
 #include "messagemanager.h"
 #include "settings.h"
+#include "startuporchestrator.h"
 #include "websocket.h"
 
 #include <QJsonDocument>
@@ -104,6 +105,7 @@ public:
         { return m_AudioRouter->connectConfPort(src_slot, sink_slot, level, persistant); };
     int disconnectConfPort(int src_slot, int sink_slot) const { return m_AudioRouter->disconnectConfPort(src_slot, sink_slot); };
     void changeConfPortLevel(int src_slot, int sink_slot, int level) const { return m_AudioRouter->changeConfPortLevel(src_slot, sink_slot, level); };
+    int applyRouteBatch(const QList<s_audioRouteOp> &ops) const { return m_AudioRouter->applyRouteBatch(ops); };
     void addToneGen(int freq) const { return m_AudioRouter->addToneGen(freq); };
     QList<s_IODevices>& getAudioDevices() const { return *m_AudioRouter->getAudioDevices(); };
     int getSoundDevID(QString DeviceName) const { return m_AudioRouter->getSoundDevID(DeviceName); };
@@ -138,7 +140,8 @@ public:
 
 
     // Public API - Log
-    QStringList readNewestLog() const { return m_Log->readNewestLog();};
+    QStringList readNewestLog(const s_logQuery &query = s_logQuery()) const { return m_Log->readNewestLog(query);};
+    QList<s_logRecord> queryEvents(const s_logRecordQuery &query, bool &ok) const { return m_Log->queryEvents(query, ok);};
 
     // Public API - MessageManager
     void sendDtmf(int callId, int AccID, QString num) const { return m_MessageManager->sendDtmf(callId, AccID, num); };
@@ -155,6 +158,12 @@ public:
     */
      QJsonObject getVersions();
 
+    /**
+    * @brief get the startup trace: the time of every startup stage and of the steps within them (e.g. opening a sound device)
+    * @return JSON object with totalMs, stages and spans, all times in ms since the library was constructed
+    */
+     QJsonObject getStartupTrace() const { return m_Startup->trace(); };
+
 public slots:
     void slotSendMessage(int callId, int AccID, QString type, QByteArray message);
     void slotIoDevicesChanged(QList<s_IODevices>& IoDev);
@@ -228,12 +237,26 @@ signals:
     */
     void confportLevelChanged(s_audioRoutes changedRoute);
 
+    /**
+    * @brief Signal with the routes touched by a batch of crosspoint changes
+    * @param changedRoutes routes that were connected or got a new level
+    * @param removedRoutes routes that were disconnected
+    */
+    void audioRoutesDiff(const QList<s_audioRoutes>& changedRoutes, const QList<s_audioRoutes>& removedRoutes);
+
     /**
     * @brief Signal if audio route Table from the conference-bridge changed
     * @param portList with all sources and sinks as struct
     */
     void audioRoutesTableChanged(const s_audioPortList& portList);
 
+    /**
+    * @brief Signal with the sources and destinations that changed in the conference-bridge
+    * @param changedPorts ports that were added or relabeled
+    * @param removedPorts ports that are gone
+    */
+    void audioPortsChanged(const s_audioPortList& changedPorts, const s_audioPortList& removedPorts);
+
     /**
     * @brief Signal Accounts Changed (e.g. an account is added or deleated)
     * @param Accounts a QList with all the accounts
@@ -284,6 +307,12 @@ signals:
     */
     void gpioStateChanged(const QMap<QString, bool> changedGpios);
 
+    /**
+    * @brief Signal when the startup of the library is finished, emitted once from the event loop
+    * @param ok false if a startup stage failed, the log has the details
+    */
+    void startupFinished(bool ok);
+
 private:
     explicit AWAHSipLib(QObject *parent = nullptr);
 
@@ -301,9 +330,10 @@ private:
     Buddies* m_Buddies;
     Codecs* m_Codecs;
     GpioDeviceManager* m_GpioDeviceManager;
-    Log* m_Log;
+    Log* m_Log = nullptr;
     MessageManager* m_MessageManager;
     Settings* m_Settings;
+    StartupOrchestrator* m_Startup = nullptr;
     Websocket* m_Websocket;
 
     friend class Accounts;
@@ -317,11 +347,13 @@ private:
     friend class Log;
     friend class MessageManager;
     friend class Settings;
+    friend class StartupOrchestrator;
     friend class PJEndpoint;
     friend class PJAccount;
     friend class PJBuddy;
     friend class PJCall;
     friend class Websocket;
+    friend class TestStartup;
 };
 
 #endif // AWAHSIPLIB_H
@@ -8,42 +8,56 @@ QT       += websockets
 
 SOURCES += \
     $$PWD/accounts.cpp \
+    $$PWD/audiokernels.cpp \
     $$PWD/audiorouter.cpp \
     $$PWD/awahsiplib.cpp \
     $$PWD/buddies.cpp \
     $$PWD/codecs.cpp \
+    $$PWD/configstore.cpp \
     $$PWD/gpiodevice.cpp \
     $$PWD/gpiodevicemanager.cpp \
     $$PWD/gpiorouter.cpp \
     $$PWD/libgpiod_device.cpp \
     $$PWD/log.cpp \
+    $$PWD/logfilewriter.cpp \
+    $$PWD/logstore.cpp \
     $$PWD/messagemanager.cpp \
+    $$PWD/multichanneladapter.cpp \
     $$PWD/pjaccount.cpp \
     $$PWD/pjbuddy.cpp \
     $$PWD/pjcall.cpp \
     $$PWD/pjendpoint.cpp \
     $$PWD/pjlogwriter.cpp \
     $$PWD/settings.cpp \
+    $$PWD/sounddevicemonitor.cpp \
+    $$PWD/startuporchestrator.cpp \
     $$PWD/websocket.cpp
 
 HEADERS += \
     $$PWD/accounts.h \
+    $$PWD/audiokernels.h \
     $$PWD/audiorouter.h \
     $$PWD/awahsiplib.h \
     $$PWD/buddies.h \
     $$PWD/codecs.h \
+    $$PWD/configstore.h \
     $$PWD/gpiodevice.h \
     $$PWD/gpiodevicemanager.h \
     $$PWD/gpiorouter.h \
     $$PWD/libgpiod_device.h \
     $$PWD/log.h \
+    $$PWD/logfilewriter.h \
+    $$PWD/logstore.h \
     $$PWD/messagemanager.h \
+    $$PWD/multichanneladapter.h \
     $$PWD/pjaccount.h \
     $$PWD/pjbuddy.h \
     $$PWD/pjcall.h \
     $$PWD/pjendpoint.h \
     $$PWD/pjlogwriter.h \
     $$PWD/settings.h \
+    $$PWD/sounddevicemonitor.h \
+    $$PWD/startuporchestrator.h \
     $$PWD/types.h \
     $$PWD/websocket.h
 
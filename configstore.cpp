@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "configstore.h"
+#include <QDataStream>
+#include <QSaveFile>
+#include <QDebug>
+#include <algorithm>
+
+ConfigStore::ConfigStore(const QString &fileName) : m_file(fileName)
+{
+}
+
+ConfigStore::~ConfigStore()
+{
+    m_file.close();
+}
+
+bool ConfigStore::open()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.exists())
+        return false;
+    if (!m_file.open(QIODevice::ReadWrite))
+        return false;
+
+    // every journal entry is: quint32 size, quint16 checksum, payload
+    QDataStream in(&m_file);
+    qint64 validSize = 0;
+    while (!in.atEnd()) {
+        quint32 size;
+        quint16 checksum;
+        in >> size >> checksum;
+        if (in.status() != QDataStream::Ok || size > m_file.size())
+            break;
+        QByteArray payload = m_file.read(size);
+        if (payload.size() != int(size) || qChecksum(payload.constData(), uint(payload.size())) != checksum)
+            break;                                  // torn write at the end of the journal
+        QDataStream entry(payload);
+        quint8 op;
+        QString section, key;
+        quint64 order;
+        QByteArray value;
+        entry >> op >> section >> key >> order >> value;
+        if (entry.status() != QDataStream::Ok)
+            break;
+        QHash<QString, s_record> &records = m_sections[section];
+        auto existing = records.find(key);
+        if (existing != records.end()) {
+            m_liveSize -= existing->value.size() + key.size() * 2 + section.size() * 2;
+            records.erase(existing);
+        }
+        if (op == PutRecord) {
+            s_record record;
+            record.order = order;
+            record.value = value;
+            records.insert(key, record);
+            m_liveSize += value.size() + key.size() * 2 + section.size() * 2;
+            m_nextOrder = qMax(m_nextOrder, order + 1);
+        }
+        validSize = m_file.pos();
+    }
+    if (validSize != m_file.size()) {
+        qWarning() << "ConfigStore: discarding" << m_file.size() - validSize << "bytes of an incomplete journal entry";
+        m_file.resize(validSize);
+    }
+    m_file.seek(validSize);
+    if (m_file.size() > CONFIGSTORE_COMPACTSIZE && m_file.size() > CONFIGSTORE_COMPACTRATIO * m_liveSize)
+        compactLocked();
+    return true;
+}
+
+bool ConfigStore::create()
+{
+    QMutexLocker locker(&m_mutex);
+    m_sections.clear();
+    m_nextOrder = 0;
+    m_liveSize = 0;
+    return m_file.open(QIODevice::ReadWrite | QIODevice::Truncate);
+}
+
+QList<ConfigRecord> ConfigStore::section(const QString &section) const
+{
+    QMutexLocker locker(&m_mutex);
+    QList<QPair<quint64, ConfigRecord>> ordered;
+    const QHash<QString, s_record> records = m_sections.value(section);
+    for (auto it = records.constBegin(); it != records.constEnd(); ++it) {
+        ordered.append(qMakePair(it->order, qMakePair(it.key(), it->value)));
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const QPair<quint64, ConfigRecord> &a, const QPair<quint64, ConfigRecord> &b) {
+        return a.first < b.first;
+    });
+    QList<ConfigRecord> ret;
+    for (auto & record : ordered) {
+        ret.append(record.second);
+    }
+    return ret;
+}
+
+void ConfigStore::setSection(const QString &section, const QList<ConfigRecord> &records)
+{
+    QMutexLocker locker(&m_mutex);
+    QByteArray journal;
+    QHash<QString, s_record> &current = m_sections[section];
+    QSet<QString> keys;
+    for (auto & record : records) {
+        if (keys.contains(record.first))
+            continue;                               // the first record of a key wins
+        keys.insert(record.first);
+        auto existing = current.find(record.first);
+        if (existing == current.end()) {
+            s_record newRecord;
+            newRecord.order = m_nextOrder++;
+            newRecord.value = record.second;
+            current.insert(record.first, newRecord);
+            m_liveSize += record.second.size() + record.first.size() * 2 + section.size() * 2;
+            appendEntry(journal, PutRecord, section, record.first, newRecord.order, record.second);
+        } else if (existing->value != record.second) {
+            m_liveSize += record.second.size() - existing->value.size();
+            existing->value = record.second;
+            appendEntry(journal, PutRecord, section, record.first, existing->order, record.second);
+        }
+    }
+    for (auto it = current.begin(); it != current.end();) {
+        if (!keys.contains(it.key())) {
+            m_liveSize -= it->value.size() + it.key().size() * 2 + section.size() * 2;
+            appendEntry(journal, RemoveRecord, section, it.key(), it->order, QByteArray());
+            it = current.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (journal.isEmpty())
+        return;
+    writeJournal(journal);
+    if (m_file.size() > CONFIGSTORE_COMPACTSIZE && m_file.size() > CONFIGSTORE_COMPACTRATIO * m_liveSize)
+        compactLocked();
+}
+
+bool ConfigStore::appendEntry(QByteArray &journal, quint8 op, const QString &section, const QString &key, quint64 order, const QByteArray &value)
+{
+    QByteArray payload;
+    QDataStream entry(&payload, QIODevice::WriteOnly);
+    entry << op << section << key << order << value;
+    QDataStream out(&journal, QIODevice::WriteOnly | QIODevice::Append);
+    out << quint32(payload.size()) << qChecksum(payload.constData(), uint(payload.size()));
+    journal.append(payload);
+    return entry.status() == QDataStream::Ok;
+}
+
+void ConfigStore::writeJournal(const QByteArray &journal)
+{
+    if (!m_file.isOpen())
+        return;
+    if (m_file.write(journal) != journal.size())
+        qWarning() << "ConfigStore: could not write to" << m_file.fileName();
+    m_file.flush();
+}
+
+bool ConfigStore::compact()
+{
+    QMutexLocker locker(&m_mutex);
+    return compactLocked();
+}
+
+bool ConfigStore::compactLocked()
+{
+    QByteArray journal;
+    for (auto sectionIt = m_sections.constBegin(); sectionIt != m_sections.constEnd(); ++sectionIt) {
+        for (auto it = sectionIt->constBegin(); it != sectionIt->constEnd(); ++it) {
+            appendEntry(journal, PutRecord, sectionIt.key(), it.key(), it->order, it->value);
+        }
+    }
+    QSaveFile compacted(m_file.fileName());                 // the old journal stays until the new one is complete
+    if (!compacted.open(QIODevice::WriteOnly) || compacted.write(journal) != journal.size() || !compacted.commit()) {
+        qWarning() << "ConfigStore: compaction of" << m_file.fileName() << "failed";
+        return false;
+    }
+    m_file.close();
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Append))
+        return false;
+    return true;
+}
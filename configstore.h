@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef CONFIGSTORE_H
+#define CONFIGSTORE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QFile>
+#include <QSet>
+#include <QMutex>
+
+#define CONFIGSTORE_COMPACTSIZE 256 * 1024          // journal size in bytes before it is compacted
+#define CONFIGSTORE_COMPACTRATIO 4                  // compact when the journal is this many times larger than the live records
+
+typedef QPair<QString, QByteArray> ConfigRecord;    // key and serialized value
+
+/**
+ * @brief Append only journal of the config lists (accounts, routes, devices...)
+ * @details every config section is a list of records with a key. setSection() compares the new list with the
+ * current one and only appends the records that changed, so changing one route writes one small record
+ * instead of the whole config. The journal is replayed on open and rewritten with the live records only
+ * when it grows larger than CONFIGSTORE_COMPACTSIZE and CONFIGSTORE_COMPACTRATIO times the live records.
+ * All functions are thread safe, the settings write the journal from their persistence thread.
+ */
+class ConfigStore
+{
+public:
+    explicit ConfigStore(const QString &fileName);
+    ~ConfigStore();
+
+    /**
+     * @brief open the journal and replay it
+     * @return false if there is no journal yet
+     */
+    bool open();
+
+    /**
+     * @brief create an empty journal, used for the import of the old config
+     */
+    bool create();
+
+    /**
+     * @brief the records of a section in the order they were added
+     */
+    QList<ConfigRecord> section(const QString &section) const;
+
+    /**
+     * @brief replace the records of a section, only the changes are written to the journal
+     * @param section the section name
+     * @param records the new records, new keys are added in this order
+     */
+    void setSection(const QString &section, const QList<ConfigRecord> &records);
+
+    /**
+     * @brief rewrite the journal with the live records only
+     */
+    bool compact();
+
+    QString fileName() const { return m_file.fileName(); };
+
+private:
+    enum journalOp{
+        PutRecord = 1,
+        RemoveRecord = 2
+    };
+    struct s_record{
+        quint64 order = 0;
+        QByteArray value;
+    };
+
+    bool compactLocked();
+    bool appendEntry(QByteArray &journal, quint8 op, const QString &section, const QString &key, quint64 order, const QByteArray &value);
+    void writeJournal(const QByteArray &journal);
+
+    QFile m_file;
+    mutable QMutex m_mutex;
+    QHash<QString, QHash<QString, s_record>> m_sections;
+    quint64 m_nextOrder = 0;
+    qint64 m_liveSize = 0;                          // bytes of the live records as they would be written
+};
+
+#endif // CONFIGSTORE_H
@@ -320,10 +320,9 @@ void AudioCrosspointDev::audioRoutesTableChanged(const s_audioPortList& portList
 
 int AudioCrosspointDev::getSlots()
 {
-    const QMap<int, QString> srcAudioSlotMap = AWAHSipLib::instance()->m_AudioRouter->getSrcAudioSlotMap();
-    const QMap<int, QString> destAudioSlotMap = AWAHSipLib::instance()->m_AudioRouter->getDestAudioSlotMap();
-    m_route.srcSlot = srcAudioSlotMap.key(m_route.srcDevName, -1);
-    m_route.destSlot = destAudioSlotMap.key(m_route.destDevName, -1);
+    const AudioRouter* audioRouter = AWAHSipLib::instance()->m_AudioRouter;
+    m_route.srcSlot = audioRouter->getSrcSlotByName(m_route.srcDevName);
+    m_route.destSlot = audioRouter->getDestSlotByName(m_route.destDevName);
     if (m_route.srcSlot == -1 || m_route.destSlot == -1) {
         AWAHSipLib::instance()->m_Log->writeLog(1, QString("AudioCrosspointDev::getSlots(): Can not get Slots for AudioCrosspointGioDev %1. Route will not be set!").arg(m_deviceInfo.inputname));
         return -1;
@@ -29,112 +29,169 @@ Log::Log(QObject *parent, AWAHSipLib *parentLib) : QObject(parent), m_lib(parent
     m_pjLogWriter = new PJLogWriter(this);
     m_lib->epCfg.logConfig.writer = m_pjLogWriter;
     logFolderName = m_lib->m_Settings->getLogPath();
-    initLogging();
-}
-
-
-bool Log::initLogging()
-{
-    // Create folder for logfiles if not exists
-    if(!QDir(logFolderName).exists()){
-        QDir().mkdir(logFolderName);
-    }
-
-    deleteOldLogs(); //delete old log files
-    initLogFileName(); //create the logfile name
-
-    QFile outFile(logFileName);
-    if(outFile.open(QIODevice::WriteOnly | QIODevice::Append)){
-        return true;
-    }
-    else{
-        return false;
+    m_fileWriter = new LogFileWriter(logFolderName, this);
+    if (m_lib->m_Settings->getEventLogEnabled()) {
+        m_store = new LogStore(QDir(logFolderName).filePath("events"));
+        if (m_store->open()) {
+            m_nextCallSeq = m_store->maxCallSeq() + 1;                  // the segments of earlier runs are kept, don't reuse their sequences
+            m_fileWriter->setStore(m_store);
+        } else {
+            delete m_store;
+            m_store = nullptr;
+        }
     }
+    m_fileWriter->start(QThread::LowPriority);
+    if (m_lib->m_Settings->getEventLogEnabled() && !m_store)
+        writeLog(1, "Log: could not open the event log in " + QDir(logFolderName).filePath("events"));
 }
 
-void Log::initLogFileName()
+Log::~Log()
 {
-    logFileName = QString(logFolderName + "/Log_%1__%2.txt")
-                .arg(QDate::currentDate().toString("yyyy_MM_dd"))
-                    .arg(QTime::currentTime().toString("hh_mm"));
+    m_fileWriter->stop();           // writes the remaining entries
+    delete m_store;
 }
 
-
-void Log::deleteOldLogs()
-{
-    QDir dir;
-    dir.setFilter(QDir::Files | QDir::Hidden | QDir::NoSymLinks);
-    dir.setSorting(QDir::Time | QDir::Reversed);
-    dir.setPath(logFolderName);
-
-    QFileInfoList list = dir.entryInfoList();
-    if (list.size() <= LOGFILES){
-        return; //no files to delete
-    }
-    else{
-      for (int i = 0; i < (list.size() - LOGFILES +1); i++){
-        QString path = list.at(i).absoluteFilePath();
-        QFile file(path);
-        file.remove();
-        }
-    }
-}
-
-void Log::writePJSUALog(const QString& msg){
-    //check file size and if needed create new log!
+void Log::writePJSUALog(const QString& msg, unsigned int loglevel){
     emit logMessage(msg.simplified());
-    QFile outFileCheck(logFileName);
-    int size = outFileCheck.size();
-
-    if (size > LOGSIZE) {   //check current log size
-      deleteOldLogs();
-      initLogFileName();
-    }
-    QFile outFile(logFileName);
-    outFile.open(QIODevice::WriteOnly | QIODevice::Append);
-    QTextStream ts(&outFile);
-    ts << QDate::currentDate().toString("yyyy_MM_dd") << " " << msg;
+    s_logEntry entry;
+    entry.timestamp = QDateTime::currentMSecsSinceEpoch();
+    entry.level = loglevel;
+    entry.pjsua = true;
+    entry.msg = msg;
+    m_fileWriter->enqueue(entry);
 #ifdef QT_DEBUG
     qDebug() << msg;
 #endif
 }
 
+bool Log::isEnabled(unsigned int loglevel) const{
+    return loglevel <= m_lib->epCfg.logConfig.consoleLevel;
+}
+
 void Log::writeLog(unsigned int loglevel, const QString& msg){
     if (loglevel <= m_lib->epCfg.logConfig.consoleLevel){
         emit logMessage(msg);
-        QFile outFileCheck(logFileName);
-        int size = outFileCheck.size();
+        s_logEntry entry;
+        entry.timestamp = QDateTime::currentMSecsSinceEpoch();
+        entry.level = loglevel;
+        entry.msg = msg;
+        m_fileWriter->enqueue(entry);
+    }
+#ifdef QT_DEBUG
+    qDebug() << "AWAHsip: " << msg;
+#endif
+}
 
-        if (size > LOGSIZE){ //check current log size
-            deleteOldLogs();
-            initLogFileName();
-        }
-        QFile outFile(logFileName);
-        outFile.open(QIODevice::WriteOnly | QIODevice::Append);
-        QTextStream ts(&outFile);
-        ts << QDate::currentDate().toString("yyyy_MM_dd") << " " << QTime::currentTime().toString("hh:mm:ss") << "               AWAHsip: " << msg << Qt::endl;
+void Log::writeCallLog(unsigned int loglevel, int accId, int callId, const QString& msg){
+    if (loglevel <= m_lib->epCfg.logConfig.consoleLevel){
+        emit logMessage(msg);
+        s_logEntry entry;
+        entry.timestamp = QDateTime::currentMSecsSinceEpoch();
+        entry.level = loglevel;
+        entry.accId = accId;
+        entry.callId = callId;
+        m_callSeqMutex.lock();
+        entry.callSeq = m_callSeqs.value(callId, -1);
+        m_callSeqMutex.unlock();
+        entry.msg = msg;
+        m_fileWriter->enqueue(entry);
     }
 #ifdef QT_DEBUG
     qDebug() << "AWAHsip: " << msg;
 #endif
 }
 
-QStringList Log::readNewestLog(){
-    QFile inputFile(logFileName);
-    QStringList list;
-    inputFile.open(QIODevice::ReadOnly);
-        if (!inputFile.isOpen()) {
-            list.append("error reading logfile!");
-            return list;
+qint64 Log::beginCall(int callId){
+    QMutexLocker locker(&m_callSeqMutex);
+    m_callSeqs[callId] = m_nextCallSeq;
+    return m_nextCallSeq++;
+}
+
+qint64 Log::callSeq(int callId) const{
+    QMutexLocker locker(&m_callSeqMutex);
+    return m_callSeqs.value(callId, -1);
+}
+
+QList<s_logRecord> Log::queryEvents(const s_logRecordQuery &query, bool &ok) const{
+    ok = m_store != nullptr;
+    if (!m_store)
+        return QList<s_logRecord>();
+    return m_store->query(query);
+}
+
+static bool logLineMatches(const s_logQuery &query, qint64 timestamp, const QString &line) {
+    if (query.to && timestamp > query.to)
+        return false;
+    if (query.from && timestamp < query.from)
+        return false;
+    return query.contains.isEmpty() || line.contains(query.contains, Qt::CaseInsensitive);
+}
+
+QStringList Log::readNewestLog(const s_logQuery &query){
+    QStringList lines;
+    s_logQuery remaining = query;
+    const QVector<s_logEntry> entries = m_fileWriter->newestEntries();
+    for (int i = entries.size() - 1; i >= 0 && remaining.count > 0; i--) {
+        const s_logEntry &entry = entries.at(i);
+        if (remaining.from && entry.timestamp < remaining.from)
+            return lines;                               // entries are in time order, nothing older can match
+        if (remaining.maxLevel >= 0 && (entry.pjsua || entry.level > uint(remaining.maxLevel)))
+            continue;
+        QString line = LogFileWriter::formatLine(entry);
+        if (!logLineMatches(remaining, entry.timestamp, line))
+            continue;
+        if (remaining.offset > 0) {
+            remaining.offset--;
+            continue;
+        }
+        lines.prepend(line);
+        remaining.count--;
+    }
+    if (remaining.count > 0 && remaining.maxLevel < 0) {    // the ring is cold or too short, continue in the file
+        if (entries.isEmpty())
+            readLogTail(m_fileWriter->fileName(), -1, remaining, lines);
+        else
+            readLogTail(entries.first().fileName, entries.first().fileOffset, remaining, lines);
+    }
+    return lines;
+}
+
+void Log::readLogTail(const QString &fileName, qint64 end, s_logQuery &query, QStringList &lines){
+    QFile inputFile(fileName);
+    if (fileName.isEmpty() || !inputFile.open(QIODevice::ReadOnly)) {
+        lines.prepend("error reading logfile!");
+        return;
+    }
+    qint64 pos = (end < 0 || end > inputFile.size()) ? inputFile.size() : end;
+    QByteArray rest;                                    // incomplete first line of the last chunk
+    while (pos > 0 && query.count > 0) {
+        qint64 chunkSize = qMin(qint64(LOGTAILCHUNK), pos);
+        pos -= chunkSize;
+        inputFile.seek(pos);
+        QByteArray data = inputFile.read(chunkSize) + rest;
+        QList<QByteArray> chunkLines = data.split('\n');
+        rest = pos > 0 ? chunkLines.takeFirst() : QByteArray();
+        for (int i = chunkLines.size() - 1; i >= 0 && query.count > 0; i--) {
+            if (chunkLines.at(i).isEmpty())
+                continue;
+            QString line = QString::fromUtf8(chunkLines.at(i));
+            qint64 timestamp = 0;
+            if (query.from || query.to) {               // lines start with "yyyy_MM_dd hh:mm:ss"
+                QDateTime time = QDateTime::fromString(line.left(19), "yyyy_MM_dd hh:mm:ss");
+                if (!time.isValid())
+                    continue;
+                timestamp = time.toMSecsSinceEpoch();
+                if (query.from && timestamp < query.from)
+                    return;
+            }
+            if (!logLineMatches(query, timestamp, line))
+                continue;
+            if (query.offset > 0) {
+                query.offset--;
+                continue;
+            }
+            lines.prepend(line);
+            query.count--;
         }
-    QTextStream stream(&inputFile);
-    QString line = stream.readLine();
-    while (!line.isNull()) {
-        /* process information */
-        line = stream.readLine() ;
-        list.append(line);
     }
-    QStringList ret;
-    ret = list.mid(list.count()-501, -1);        // restrict the log to the newest 500 entrys for
-    return ret;
 }
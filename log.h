@@ -23,11 +23,35 @@
 #include <QDebug>
 #include <QDate>
 #include <QTime>
+#include <QHash>
+#include <QMutex>
 #include "qdir.h"
 #include "pjlogwriter.h"
+#include "logfilewriter.h"
+#include "logstore.h"
 
 #define LOGSIZE (1024 * 1024) * 2 //log size in bytes (1024 * 1024 = 1MB)  2MB
 #define LOGFILES 50
+#define LOGTAILCHUNK 64 * 1024      // bytes read at once when the log file is read backwards
+
+/**
+ * log a message only if the level is enabled, the message is not formatted otherwise
+ * e.g. AWAHLOG(m_lib->m_Log, 4, QString("Call %1").arg(callId));
+ */
+#define AWAHLOG(log, loglevel, msg) do { if ((log)->isEnabled(loglevel)) (log)->writeLog(loglevel, msg); } while (0)
+#define AWAHCALLLOG(log, loglevel, accId, callId, msg) do { if ((log)->isEnabled(loglevel)) (log)->writeCallLog(loglevel, accId, callId, msg); } while (0)
+
+/**
+ * @brief Filter and paging for readNewestLog
+ */
+struct s_logQuery{
+    int offset = 0;                 // skip the newest matching entries
+    int count = 500;
+    int maxLevel = -1;              // only entries up to this level, -1 for all. Older entries read from the file have no level and are skipped
+    qint64 from = 0;                // ms since epoch, 0 for no limit
+    qint64 to = 0;
+    QString contains;
+};
 
 
 class AWAHSipLib;
@@ -37,9 +61,50 @@ class Log : public QObject
     Q_OBJECT
 public:
     explicit Log(QObject *parent, AWAHSipLib *parentLib);
-    void writePJSUALog(const QString& msg);
+    ~Log();
+    void writePJSUALog(const QString& msg, unsigned int loglevel = 0);
     void writeLog(unsigned int loglevel, const QString& msg);
-    QStringList readNewestLog();
+
+    /**
+     * @brief check the log level before a message is formatted, use the AWAHLOG macro
+     * @return true if messages of this level are logged
+     */
+    bool isEnabled(unsigned int loglevel) const;
+
+    /**
+     * @brief write a log message that belongs to a call, the event log stores the ids for queryEvents
+     */
+    void writeCallLog(unsigned int loglevel, int accId, int callId, const QString& msg);
+
+    /**
+     * @brief start a new call sequence for a call id, the following call logs of this id are tagged with it
+     * @param callId the pjsua call id, it is reused by pjsua after the call
+     * @return the call sequence
+     */
+    qint64 beginCall(int callId);
+
+    /**
+     * @brief the call sequence of the current or last call of a call id
+     * @param callId the pjsua call id
+     * @return the call sequence, -1 if the id had no call yet
+     */
+    qint64 callSeq(int callId) const;
+
+    /**
+     * @brief query the structured event log
+     * @param query the filter
+     * @param ok false if the event log is disabled
+     * @return the newest matching records, newest first
+     */
+    QList<s_logRecord> queryEvents(const s_logRecordQuery &query, bool &ok) const;
+
+    /**
+     * @brief read the newest log entries
+     * @details the entries come from the in memory ring of the writer, older entries are read backwards from the log file
+     * @param query filter and paging
+     * @return the matching lines, oldest first
+     */
+    QStringList readNewestLog(const s_logQuery &query = s_logQuery());
     QString logFolderName = QDir::currentPath();
 
 signals:
@@ -48,16 +113,20 @@ signals:
 private:
     AWAHSipLib *m_lib;
     PJLogWriter *m_pjLogWriter;
-
-    bool initLogging();
-    void initLogFileName();
+    LogFileWriter *m_fileWriter;
+    LogStore *m_store = nullptr;
+    QHash<int, qint64> m_callSeqs;      // current call sequence of a call id
+    qint64 m_nextCallSeq = 0;
+    mutable QMutex m_callSeqMutex;
 
     /**
-    * @brief deletes old log files, only the last ones are kept
-    */
-    void deleteOldLogs();
-
-    QString logFileName;
+     * @brief read lines backwards from a log file
+     * @param fileName the log file
+     * @param end the position to read backwards from, -1 for the end of the file
+     * @param query filter, count and offset are updated with the lines found
+     * @param lines the matching lines are prepended
+     */
+    void readLogTail(const QString &fileName, qint64 end, s_logQuery &query, QStringList &lines);
 };
 
 #endif // LOG_H
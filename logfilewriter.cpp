@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "logfilewriter.h"
+#include "log.h"
+#include "logstore.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDebug>
+
+LogFileWriter::LogFileWriter(const QString &logFolderName, QObject *parent)
+    : QThread(parent), m_queue(LOGQUEUESIZE), m_logFolderName(logFolderName)
+{
+    for (int i = 0; i < m_queue.size(); i++) {
+        m_queue[i].sequence.storeRelaxed(quint64(i));
+    }
+}
+
+LogFileWriter::~LogFileWriter()
+{
+    stop();
+}
+
+bool LogFileWriter::enqueue(s_logEntry entry)
+{
+    // bounded multi producer queue, a cell is free when its sequence equals the position
+    const quint64 mask = LOGQUEUESIZE - 1;
+    quint64 pos = m_enqueuePos.loadRelaxed();
+    s_cell *cell;
+    forever {
+        cell = &m_queue[int(pos & mask)];
+        qint64 diff = qint64(cell->sequence.loadAcquire()) - qint64(pos);
+        if (diff == 0) {
+            if (m_enqueuePos.testAndSetRelaxed(pos, pos + 1, pos))
+                break;
+        } else if (diff < 0) {                          // queue is full
+            m_dropped.fetchAndAddRelaxed(1);
+            return false;
+        } else {
+            pos = m_enqueuePos.loadRelaxed();
+        }
+    }
+    cell->entry = std::move(entry);
+    cell->sequence.storeRelease(pos + 1);
+    if (m_sleeping.loadAcquire()) {
+        QMutexLocker locker(&m_wakeMutex);
+        m_wake.wakeOne();
+    }
+    return true;
+}
+
+bool LogFileWriter::dequeue(s_logEntry &entry)
+{
+    s_cell &cell = m_queue[int(m_dequeuePos & (LOGQUEUESIZE - 1))];
+    if (cell.sequence.loadAcquire() != m_dequeuePos + 1)
+        return false;
+    entry = std::move(cell.entry);
+    cell.entry = s_logEntry();
+    cell.sequence.storeRelease(m_dequeuePos + LOGQUEUESIZE);
+    m_dequeuePos++;
+    return true;
+}
+
+void LogFileWriter::stop()
+{
+    if (!isRunning())
+        return;
+    m_running.storeRelease(0);
+    {
+        QMutexLocker locker(&m_wakeMutex);
+        m_wake.wakeOne();
+    }
+    wait();
+}
+
+void LogFileWriter::setStore(LogStore *store)
+{
+    m_store = store;
+}
+
+QString LogFileWriter::fileName() const
+{
+    QMutexLocker locker(&m_fileNameMutex);
+    return m_fileName;
+}
+
+QVector<s_logEntry> LogFileWriter::newestEntries() const
+{
+    QMutexLocker locker(&m_ringMutex);
+    QVector<s_logEntry> entries;
+    entries.reserve(m_ringCount);
+    for (int i = 0; i < m_ringCount; i++) {
+        entries.append(m_ring.at((m_ringHead + i) % LOGRINGSIZE));
+    }
+    return entries;
+}
+
+void LogFileWriter::run()
+{
+    openLogFile();
+    QByteArray batch;
+    QVector<s_logEntry> written;
+    s_logEntry entry;
+    forever {
+        if (m_fileSize > LOGSIZE)
+            openLogFile();
+        while (dequeue(entry)) {
+            appendToBatch(entry, batch, written);
+        }
+        quint32 dropped = m_dropped.fetchAndStoreRelaxed(0);
+        if (dropped) {
+            s_logEntry note;
+            note.timestamp = QDateTime::currentMSecsSinceEpoch();
+            note.level = 1;
+            note.msg = QString("Log: %1 log messages dropped, the queue was full").arg(dropped);
+            appendToBatch(note, batch, written);
+        }
+        if (!batch.isEmpty()) {
+            m_file.write(batch);
+            m_file.flush();
+            m_fileSize += batch.size();
+            batch.clear();
+            appendToRing(written);
+            written.clear();
+        }
+        if (!m_running.loadAcquire()) {
+            if (!dequeue(entry))                        // everything is written
+                break;
+            appendToBatch(entry, batch, written);
+            continue;
+        }
+        QMutexLocker locker(&m_wakeMutex);
+        m_sleeping.storeRelease(1);
+        if (m_running.loadAcquire() && m_queue[int(m_dequeuePos & (LOGQUEUESIZE - 1))].sequence.loadAcquire() != m_dequeuePos + 1)
+            m_wake.wait(&m_wakeMutex, LOGFLUSHINTERVAL);
+        m_sleeping.storeRelease(0);
+    }
+    m_file.close();
+}
+
+void LogFileWriter::appendToBatch(s_logEntry &entry, QByteArray &batch, QVector<s_logEntry> &written)
+{
+    entry.fileName = m_file.fileName();
+    entry.fileOffset = m_fileSize + batch.size();
+    batch.append((formatLine(entry) + "\n").toUtf8());
+    if (m_store)
+        m_store->append(entry);
+    written.append(entry);
+}
+
+void LogFileWriter::appendToRing(const QVector<s_logEntry> &written)
+{
+    QMutexLocker locker(&m_ringMutex);
+    if (m_ring.isEmpty())
+        m_ring.resize(LOGRINGSIZE);
+    for (const auto & entry : written) {
+        if (m_ringCount < LOGRINGSIZE) {
+            m_ring[(m_ringHead + m_ringCount) % LOGRINGSIZE] = entry;
+            m_ringCount++;
+        } else {                                        // overwrite the oldest entry
+            m_ring[m_ringHead] = entry;
+            m_ringHead = (m_ringHead + 1) % LOGRINGSIZE;
+        }
+    }
+}
+
+void LogFileWriter::openLogFile()
+{
+    if (m_file.isOpen())
+        m_file.close();
+    if (!QDir(m_logFolderName).exists()) {
+        QDir().mkdir(m_logFolderName);
+    }
+    deleteOldLogs();
+    QString fileName = QString(m_logFolderName + "/Log_%1__%2.txt")
+                .arg(QDate::currentDate().toString("yyyy_MM_dd"))
+                    .arg(QTime::currentTime().toString("hh_mm"));
+    {
+        QMutexLocker locker(&m_fileNameMutex);
+        m_fileName = fileName;
+    }
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "LogFileWriter: could not open log file" << fileName;
+    }
+    m_fileSize = m_file.size();
+}
+
+void LogFileWriter::deleteOldLogs()
+{
+    QDir dir;
+    dir.setFilter(QDir::Files | QDir::Hidden | QDir::NoSymLinks);
+    dir.setSorting(QDir::Time | QDir::Reversed);
+    dir.setPath(m_logFolderName);
+
+    QFileInfoList list = dir.entryInfoList();
+    if (list.size() <= LOGFILES){
+        return; //no files to delete
+    }
+    for (int i = 0; i < (list.size() - LOGFILES +1); i++){
+        QFile::remove(list.at(i).absoluteFilePath());
+    }
+}
+
+QString LogFileWriter::formatLine(const s_logEntry &entry)
+{
+    QDateTime time = QDateTime::fromMSecsSinceEpoch(entry.timestamp);
+    if (entry.pjsua) {                                  // pjsua messages have their own time and line end
+        QString msg = entry.msg;
+        if (msg.endsWith('\n'))
+            msg.chop(1);
+        return time.toString("yyyy_MM_dd") + " " + msg;
+    }
+    return time.toString("yyyy_MM_dd hh:mm:ss") + "               AWAHsip: " + entry.msg;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LOGFILEWRITER_H
+#define LOGFILEWRITER_H
+
+#include <QThread>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+#include <QVector>
+
+class LogStore;
+
+#define LOGQUEUESIZE 4096           // entries in the queue between the logging threads and the writer thread, must be a power of 2
+#define LOGFLUSHINTERVAL 200        // ms the writer thread sleeps when the queue is empty
+#define LOGRINGSIZE 5000            // newest entries kept in memory for readNewestLog
+
+/**
+ * @brief A log entry as it is queued for the writer thread
+ */
+struct s_logEntry{
+    qint64 timestamp = 0;           // ms since epoch
+    unsigned int level = 0;
+    bool pjsua = false;             // the entry comes from the pjsua log writer
+    int accId = -1;
+    int callId = -1;
+    qint64 callSeq = -1;            // the call sequence of Log::beginCall, pjsua reuses the call ids
+    QString msg;
+    QString fileName;               // set by the writer thread, the file and position the entry is written to
+    qint64 fileOffset = -1;
+};
+
+/**
+ * @brief Writes the log files in its own thread
+ * @details any thread can queue entries with enqueue(), it never blocks and never touches the file.
+ * The writer thread keeps the log file open, writes the queued entries in batches
+ * and starts a new file when the size, tracked in memory, exceeds LOGSIZE
+ */
+class LogFileWriter : public QThread
+{
+    Q_OBJECT
+public:
+    explicit LogFileWriter(const QString &logFolderName, QObject *parent = nullptr);
+    ~LogFileWriter() override;
+
+    /**
+     * @brief queue an entry for the log file, safe to call from any thread
+     * @param entry the log entry
+     * @return false if the queue is full and the entry was dropped
+     */
+    bool enqueue(s_logEntry entry);
+
+    /**
+     * @brief write all queued entries and stop the writer thread
+     */
+    void stop();
+
+    QString fileName() const;
+
+    /**
+     * @brief also write all entries to a structured log store, must be set before the thread is started
+     */
+    void setStore(LogStore *store);
+
+    /**
+     * @brief the newest written entries, oldest first
+     * @details older entries can be read backwards from the fileName and fileOffset of the first entry
+     */
+    QVector<s_logEntry> newestEntries() const;
+
+    /**
+     * @brief format an entry as it is written to the log file, without line end
+     */
+    static QString formatLine(const s_logEntry &entry);
+
+private:
+    void run() override;
+    bool dequeue(s_logEntry &entry);
+    void openLogFile();
+    void deleteOldLogs();
+    void appendToBatch(s_logEntry &entry, QByteArray &batch, QVector<s_logEntry> &written);
+    void appendToRing(const QVector<s_logEntry> &written);
+
+    struct s_cell{
+        QAtomicInteger<quint64> sequence;
+        s_logEntry entry;
+    };
+    QVector<s_cell> m_queue;
+    QAtomicInteger<quint64> m_enqueuePos = 0;
+    quint64 m_dequeuePos = 0;                   // only used by the writer thread
+    QAtomicInteger<quint32> m_dropped = 0;
+    QAtomicInteger<int> m_running = 1;
+    QAtomicInteger<int> m_sleeping = 0;
+    QMutex m_wakeMutex;
+    QWaitCondition m_wake;
+
+    QString m_logFolderName;
+    QString m_fileName;
+    mutable QMutex m_fileNameMutex;
+    QFile m_file;
+    qint64 m_fileSize = 0;
+    LogStore *m_store = nullptr;
+
+    QVector<s_logEntry> m_ring;
+    int m_ringHead = 0;                         // index of the oldest entry
+    int m_ringCount = 0;
+    mutable QMutex m_ringMutex;
+};
+
+#endif // LOGFILEWRITER_H
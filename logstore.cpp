@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "logstore.h"
+#include "logfilewriter.h"
+#include <QDir>
+#include <QFile>
+#include <QDateTime>
+#include <QDebug>
+#include <cstring>
+
+#define LOGSTORE_MAGIC 0x534c5741                   // "AWLS"
+#define LOGSTORE_VERSION 2
+#define LOGSTORE_TIMESLACK 1000                     // ms, records of different threads are not strictly ordered by time
+
+namespace {
+
+struct s_segmentHeader{
+    quint32 magic;
+    quint32 version;
+    quint32 used;                                   // bytes used including this header
+    quint32 records;
+};
+
+struct s_recordHeader{
+    qint64 timestamp;
+    qint64 callSeq;
+    quint32 size;                                   // size of the record including this header, aligned to 8 bytes
+    qint32 accId;
+    qint32 callId;
+    quint32 msgSize;                                // utf8 bytes, the subsystem follows the message
+    quint16 level;
+    quint16 subsystemSize;
+};
+
+}
+
+LogStore::LogStore(const QString &folderName) : m_folderName(folderName)
+{
+}
+
+LogStore::~LogStore()
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto & segment : m_segments) {
+        closeSegment(segment);
+    }
+}
+
+bool LogStore::open()
+{
+    QMutexLocker locker(&m_mutex);
+    QDir dir(m_folderName);
+    if (!dir.exists() && !QDir().mkpath(m_folderName))
+        return false;
+    QStringList segmentFiles = dir.entryList(QStringList() << "Events_*.seg", QDir::Files, QDir::Name);
+    while (segmentFiles.size() >= LOGSTORE_SEGMENTS) {
+        QFile::remove(dir.filePath(segmentFiles.takeFirst()));
+    }
+    for (auto & segmentFile : segmentFiles) {
+        openSegment(dir.filePath(segmentFile), false);
+    }
+    return openSegment(dir.filePath(QString("Events_%1.seg").arg(QDateTime::currentDateTime().toString("yyyy_MM_dd__hh_mm_ss_zzz"))), true);
+}
+
+bool LogStore::openSegment(const QString &fileName, bool create)
+{
+    s_segment segment;
+    segment.file = new QFile(fileName);
+    if (!segment.file->open(QIODevice::ReadWrite) || (create && !segment.file->resize(LOGSTORE_SEGMENTSIZE))
+            || segment.file->size() != LOGSTORE_SEGMENTSIZE) {
+        qWarning() << "LogStore: could not open segment" << fileName;
+        delete segment.file;
+        return false;
+    }
+    segment.data = segment.file->map(0, LOGSTORE_SEGMENTSIZE);
+    if (!segment.data) {
+        qWarning() << "LogStore: could not map segment" << fileName;
+        delete segment.file;
+        return false;
+    }
+    s_segmentHeader header;
+    if (create) {
+        header.magic = LOGSTORE_MAGIC;
+        header.version = LOGSTORE_VERSION;
+        header.used = sizeof(s_segmentHeader);
+        header.records = 0;
+        memcpy(segment.data, &header, sizeof(header));
+    } else {
+        memcpy(&header, segment.data, sizeof(header));
+        if (header.magic != LOGSTORE_MAGIC || header.version != LOGSTORE_VERSION || header.used > LOGSTORE_SEGMENTSIZE) {
+            qWarning() << "LogStore: invalid segment" << fileName;
+            closeSegment(segment);
+            return false;
+        }
+    }
+    segment.used = header.used;
+    scanSegment(segment);
+    m_segments.append(segment);
+    return true;
+}
+
+void LogStore::closeSegment(s_segment &segment)
+{
+    if (segment.file) {
+        if (segment.data)
+            segment.file->unmap(segment.data);
+        segment.file->close();
+        delete segment.file;
+    }
+    segment.file = nullptr;
+    segment.data = nullptr;
+}
+
+void LogStore::scanSegment(s_segment &segment)
+{
+    quint32 offset = sizeof(s_segmentHeader);
+    s_recordHeader record;
+    while (offset + sizeof(s_recordHeader) <= segment.used) {
+        memcpy(&record, segment.data + offset, sizeof(record));
+        if (record.size < sizeof(s_recordHeader) || offset + record.size > segment.used)
+            break;
+        if (segment.records == 0)
+            segment.firstTimestamp = record.timestamp;
+        if (segment.records % LOGSTORE_INDEXINTERVAL == 0)
+            segment.index.append({record.timestamp, offset});
+        segment.lastTimestamp = qMax(segment.lastTimestamp, record.timestamp);
+        m_maxCallSeq = qMax(m_maxCallSeq, record.callSeq);
+        segment.records++;
+        offset += record.size;
+    }
+    segment.used = offset;
+}
+
+QString LogStore::subsystemOf(const s_logEntry &entry)
+{
+    if (entry.pjsua)
+        return QStringLiteral("pjsua");
+    int end = entry.msg.indexOf(':');                   // messages start with "Class::function():" or "function:"
+    if (end <= 0 || end > 64)
+        return QString();
+    return entry.msg.left(end).trimmed();
+}
+
+void LogStore::append(const s_logEntry &entry)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_segments.isEmpty())
+        return;
+    const QByteArray msg = entry.msg.trimmed().toUtf8();
+    const QByteArray subsystem = subsystemOf(entry).toUtf8().left(0xffff);
+    s_recordHeader record;
+    record.timestamp = entry.timestamp;
+    record.accId = entry.accId;
+    record.callId = entry.callId;
+    record.callSeq = entry.callSeq;
+    record.level = quint16(entry.level);
+    record.subsystemSize = quint16(subsystem.size());
+    record.msgSize = quint32(qMin(msg.size(), LOGSTORE_SEGMENTSIZE / 2));
+    record.size = (sizeof(s_recordHeader) + record.msgSize + record.subsystemSize + 7) & ~7u;
+
+    if (m_segments.last().used + record.size > LOGSTORE_SEGMENTSIZE) {          // start a new segment
+        QDir dir(m_folderName);
+        while (m_segments.size() >= LOGSTORE_SEGMENTS) {
+            s_segment oldest = m_segments.takeFirst();
+            QString fileName = oldest.file->fileName();
+            closeSegment(oldest);
+            QFile::remove(fileName);
+        }
+        if (!openSegment(dir.filePath(QString("Events_%1.seg").arg(QDateTime::currentDateTime().toString("yyyy_MM_dd__hh_mm_ss_zzz"))), true))
+            return;
+    }
+    s_segment &segment = m_segments.last();
+    uchar *pos = segment.data + segment.used;
+    memcpy(pos, &record, sizeof(record));
+    memcpy(pos + sizeof(record), msg.constData(), record.msgSize);
+    memcpy(pos + sizeof(record) + record.msgSize, subsystem.constData(), record.subsystemSize);
+
+    if (segment.records == 0)
+        segment.firstTimestamp = record.timestamp;
+    if (segment.records % LOGSTORE_INDEXINTERVAL == 0)
+        segment.index.append({record.timestamp, segment.used});
+    segment.lastTimestamp = qMax(segment.lastTimestamp, record.timestamp);
+    m_maxCallSeq = qMax(m_maxCallSeq, record.callSeq);
+    segment.records++;
+    segment.used += record.size;
+
+    s_segmentHeader header;
+    memcpy(&header, segment.data, sizeof(header));
+    header.used = segment.used;
+    header.records = segment.records;
+    memcpy(segment.data, &header, sizeof(header));
+}
+
+qint64 LogStore::maxCallSeq() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxCallSeq;
+}
+
+QList<s_logRecord> LogStore::query(const s_logRecordQuery &query) const
+{
+    QMutexLocker locker(&m_mutex);
+    QList<s_logRecord> records;
+    const int limit = qBound(1, query.limit, LOGSTORE_QUERYLIMIT);
+    for (int i = m_segments.size() - 1; i >= 0 && records.size() < limit; i--) {       // newest segment first
+        const s_segment &segment = m_segments.at(i);
+        if (segment.records == 0)
+            continue;
+        if (query.from && segment.lastTimestamp < query.from - LOGSTORE_TIMESLACK)
+            break;
+        if (query.to && segment.firstTimestamp > query.to + LOGSTORE_TIMESLACK)
+            continue;
+
+        quint32 offset = sizeof(s_segmentHeader);
+        if (query.from) {                                   // last index entry before the requested time
+            for (const auto & indexEntry : segment.index) {
+                if (indexEntry.timestamp >= query.from - LOGSTORE_TIMESLACK)
+                    break;
+                offset = indexEntry.offset;
+            }
+        }
+        QList<s_logRecord> segmentRecords;                  // the newest matches of this segment, oldest first
+        const int wanted = limit - records.size();
+        s_recordHeader header;
+        while (offset + sizeof(s_recordHeader) <= segment.used) {
+            const uchar *pos = segment.data + offset;
+            memcpy(&header, pos, sizeof(header));
+            if (header.size < sizeof(s_recordHeader))
+                break;
+            offset += header.size;
+            if (query.to && header.timestamp > query.to + LOGSTORE_TIMESLACK)
+                break;
+            if ((query.from && header.timestamp < query.from) || (query.to && header.timestamp > query.to)
+                    || (query.maxLevel >= 0 && header.level > query.maxLevel)
+                    || (query.accId >= 0 && header.accId != query.accId)
+                    || (query.callId >= 0 && header.callId != query.callId)
+                    || (query.callSeq >= 0 && header.callSeq != query.callSeq))
+                continue;
+            s_logRecord record;
+            record.subsystem = QString::fromUtf8(reinterpret_cast<const char *>(pos) + sizeof(header) + header.msgSize, header.subsystemSize);
+            if (!query.subsystem.isEmpty() && record.subsystem != query.subsystem)
+                continue;
+            record.msg = QString::fromUtf8(reinterpret_cast<const char *>(pos) + sizeof(header), int(header.msgSize));
+            if (!query.contains.isEmpty() && !record.msg.contains(query.contains, Qt::CaseInsensitive))
+                continue;
+            record.timestamp = header.timestamp;
+            record.level = header.level;
+            record.accId = header.accId;
+            record.callId = header.callId;
+            record.callSeq = header.callSeq;
+            segmentRecords.append(record);
+            if (segmentRecords.size() > wanted)
+                segmentRecords.removeFirst();
+        }
+        for (int j = segmentRecords.size() - 1; j >= 0; j--) {
+            records.append(segmentRecords.at(j));
+        }
+    }
+    return records;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+#include <QString>
+#include <QVector>
+#include <QList>
+#include <QMutex>
+#include <QJsonObject>
+
+class QFile;
+struct s_logEntry;
+
+#define LOGSTORE_SEGMENTSIZE (1024 * 1024) * 4     // size of a segment file in bytes, 4MB
+#define LOGSTORE_SEGMENTS 32                        // segments kept, older ones are deleted
+#define LOGSTORE_INDEXINTERVAL 64                   // records between two entries of the time index
+#define LOGSTORE_QUERYLIMIT 5000                    // max records returned by a query
+
+/**
+ * @brief A record of the structured event log
+ */
+struct s_logRecord{
+    qint64 timestamp = 0;                           // ms since epoch
+    unsigned int level = 0;
+    QString subsystem;
+    int accId = -1;
+    int callId = -1;
+    qint64 callSeq = -1;                            // unique for every call, the call ids of pjsua are reused
+    QString msg;
+    QJsonObject toJSON() const {
+        QJsonObject recordObj;
+        recordObj["timestamp"] = QJsonValue(timestamp);
+        recordObj["level"] = (int)level;
+        recordObj["subsystem"] = subsystem;
+        recordObj["accId"] = accId;
+        recordObj["callId"] = callId;
+        recordObj["callSeq"] = QJsonValue(callSeq);
+        recordObj["msg"] = msg;
+        return recordObj;
+    };
+};
+
+/**
+ * @brief Filter for LogStore::query, -1 and empty strings match everything
+ */
+struct s_logRecordQuery{
+    qint64 from = 0;                                // ms since epoch, 0 for no limit
+    qint64 to = 0;
+    int maxLevel = -1;
+    int accId = -1;
+    int callId = -1;
+    qint64 callSeq = -1;
+    QString subsystem;
+    QString contains;
+    int limit = 1000;
+};
+
+/**
+ * @brief Structured event log in segment files
+ * @details records with a fixed schema are appended to memory mapped segment files of LOGSTORE_SEGMENTSIZE.
+ * Every LOGSTORE_INDEXINTERVAL records the time and position is added to a sparse index, so queries
+ * only scan the records of the requested time range and compare the fixed fields before decoding any text.
+ * The files are in native byte order and the index is rebuilt when the segments are opened.
+ * append is called by the log writer thread, query from any thread.
+ */
+class LogStore
+{
+public:
+    explicit LogStore(const QString &folderName);
+    ~LogStore();
+
+    bool open();
+    void append(const s_logEntry &entry);
+
+    /**
+     * @brief query the records
+     * @param query the filter
+     * @return the newest matching records up to the limit, newest first
+     */
+    QList<s_logRecord> query(const s_logRecordQuery &query) const;
+
+    /**
+     * @brief the highest call sequence in the segments, the call sequences of a new run continue after it
+     * @return the call sequence, -1 if no record has one
+     */
+    qint64 maxCallSeq() const;
+
+private:
+    struct s_indexEntry{
+        qint64 timestamp;
+        quint32 offset;
+    };
+    struct s_segment{
+        QFile *file = nullptr;
+        uchar *data = nullptr;
+        quint32 used = 0;
+        qint64 firstTimestamp = 0;
+        qint64 lastTimestamp = 0;
+        quint32 records = 0;
+        QVector<s_indexEntry> index;
+    };
+
+    bool openSegment(const QString &fileName, bool create);
+    void closeSegment(s_segment &segment);
+    void scanSegment(s_segment &segment);
+    static QString subsystemOf(const s_logEntry &entry);
+
+    QString m_folderName;
+    QList<s_segment> m_segments;                    // oldest first, the last one is written
+    qint64 m_maxCallSeq = -1;
+    mutable QMutex m_mutex;
+};
+
+#endif // LOGSTORE_H
@@ -30,12 +30,10 @@ void MessageManager::sendDtmf(int callId, int AccID, QString num)
 {
     s_account* account = m_lib->m_Accounts->getAccountByID(AccID);
     PJCall *m_call = Q_NULLPTR;
-
-    for (int pos = 0; pos<account->CallList.size(); pos++){       // Check if callId is valid
-            if (account->CallList.at(pos).callId == callId){
-                m_call = account->CallList.at(pos).callptr;
-            }
-        }
+    s_Call* call = m_lib->m_Accounts->getCallByID(callId, AccID);     // Check if callId is valid
+    if (call != nullptr){
+        m_call = call->callptr;
+    }
     if(m_call != Q_NULLPTR){
         try{
             m_call->dialDtmf(num.toStdString());
@@ -53,11 +51,9 @@ void MessageManager::slotSendMessage(int callId, int AccID, QString type, QByteA
 {
     s_account* account = m_lib->m_Accounts->getAccountByID(AccID);
     PJCall *m_call = Q_NULLPTR;
-
-    for (int pos = 0; pos<account->CallList.size(); pos++){       // Check if callId is valid
-        if (account->CallList.at(pos).callId == callId){
-            m_call = account->CallList.at(pos).callptr;
-        }
+    s_Call* call = m_lib->m_Accounts->getCallByID(callId, AccID);     // Check if callId is valid
+    if (call != nullptr){
+        m_call = call->callptr;
     }
     if(m_call != Q_NULLPTR){
         try{
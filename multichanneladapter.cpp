@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "multichanneladapter.h"
+#include "audiokernels.h"
+
+#include <math.h>
+#include <string.h>
+
+#define MCADAPTER_SIGNATURE PJMEDIA_SIGNATURE('A', 'W', 'M', 'C')
+#define MCADAPTER_DRIFT_SMOOTHING 0.02      // low pass of the fill level error, per device frame
+#define MCADAPTER_DRIFT_P 1.4e-3            // proportional gain of the drift control, ratio per frame of fill error
+#define MCADAPTER_DRIFT_I 1e-6              // integral gain, settles to a few ppm within about two minutes at 20 ms ptime
+#define MCADAPTER_MAX_STEP 0.01             // limit of the resampling ratio while the control catches up
+
+static inline float interpolate(const float *s, float t)
+{
+    // 4 point cubic hermite (catmull-rom) between s[0] and s[1]
+    float c1 = 0.5f * (s[1] - s[-1]);
+    float c2 = s[-1] - 2.5f * s[0] + 2.0f * s[1] - 0.5f * s[2];
+    float c3 = 0.5f * (s[2] - s[-1]) + 1.5f * (s[0] - s[1]);
+    return ((c3 * t + c2) * t + c1) * t + s[0];
+}
+
+static inline qint16 toSample(float value)
+{
+    if (value >= 32767.0f)
+        return 32767;
+    if (value <= -32768.0f)
+        return -32768;
+    return qint16(lrintf(value));
+}
+
+static quint32 nextPowerOf2(quint32 value)
+{
+    quint32 result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+MultichannelAdapter::MultichannelAdapter(unsigned clockRate, unsigned channelCount, unsigned samplesPerChannel) :
+    m_channelCount(channelCount), m_samplesPerChannel(samplesPerChannel),
+    m_ringSize(nextPowerOf2(MCADAPTER_FRAMES * samplesPerChannel)),
+    m_framePeriodUs(samplesPerChannel * 1000000.0 / clockRate), m_channelPorts(channelCount),
+    m_capture(channelCount * m_ringSize), m_captureFrame(channelCount * samplesPerChannel), m_captureBuffers(channelCount),
+    m_captureHistory(channelCount * 3), m_captureInput(samplesPerChannel + 3),
+    m_playback(channelCount * m_ringSize), m_playbackFrame(channelCount * samplesPerChannel), m_playbackBuffers(channelCount)
+{
+    pj_str_t name = pj_str(const_cast<char*>("awahmc"));
+    pj_bzero(&m_devicePort, sizeof(m_devicePort));
+    pjmedia_port_info_init(&m_devicePort.info, &name, MCADAPTER_SIGNATURE, clockRate, channelCount, 16, samplesPerChannel * channelCount);
+    m_devicePort.port_data.pdata = this;
+    m_devicePort.put_frame = &MultichannelAdapter::devicePutFrame;
+    m_devicePort.get_frame = &MultichannelAdapter::deviceGetFrame;
+
+    for (unsigned ch = 0; ch < channelCount; ch++) {
+        pjmedia_port &port = m_channelPorts[ch];
+        pj_bzero(&port, sizeof(port));
+        pjmedia_port_info_init(&port.info, &name, MCADAPTER_SIGNATURE, clockRate, 1, 16, samplesPerChannel);
+        port.port_data.pdata = this;
+        port.port_data.ldata = ch;
+        port.put_frame = &MultichannelAdapter::channelPutFrame;
+        port.get_frame = &MultichannelAdapter::channelGetFrame;
+        m_captureBuffers[ch] = m_captureFrame.data() + ch * samplesPerChannel;
+        m_playbackBuffers[ch] = m_playbackFrame.data() + ch * samplesPerChannel;
+    }
+    m_captureTaps.reserve(samplesPerChannel + samplesPerChannel / 32 + 4);
+    m_playbackTaps.resize(samplesPerChannel);
+    m_clock.start();
+}
+
+MultichannelAdapter::~MultichannelAdapter()
+{
+}
+
+bool MultichannelAdapter::bridgePosition(quint32 &position, double &progress) const
+{
+    quint64 clock = m_bridgeClock.loadAcquire();
+    if (clock == 0)
+        return false;
+    position = quint32(clock);
+    quint32 elapsedUs = quint32(nowUs()) - quint32(clock >> 32);
+    progress = qMin(1.0, elapsedUs / m_framePeriodUs);
+    return true;
+}
+
+void MultichannelAdapter::updateDriftControl(s_driftControl &control, double fill)
+{
+    double error = fill / m_samplesPerChannel - MCADAPTER_TARGET_FRAMES;
+    control.error += MCADAPTER_DRIFT_SMOOTHING * (error - control.error);
+    control.integral = qBound(-MCADAPTER_MAX_DRIFT, control.integral + MCADAPTER_DRIFT_I * control.error, MCADAPTER_MAX_DRIFT);
+    control.step = qBound(1.0 - MCADAPTER_MAX_STEP, 1.0 + control.integral + MCADAPTER_DRIFT_P * control.error, 1.0 + MCADAPTER_MAX_STEP);
+}
+
+pj_status_t MultichannelAdapter::devicePutFrame(pjmedia_port *port, pjmedia_frame *frame)
+{
+    MultichannelAdapter *adapter = static_cast<MultichannelAdapter*>(port->port_data.pdata);
+    s_driftControl &control = adapter->m_captureControl;
+    unsigned samples = adapter->m_samplesPerChannel;
+    quint32 mask = adapter->m_ringSize - 1;
+    quint32 position;
+    double progress;
+    if (!adapter->bridgePosition(position, progress))                   // nobody reads yet
+        return PJ_SUCCESS;
+
+    if (frame->type == PJMEDIA_FRAME_TYPE_AUDIO && frame->size >= samples * adapter->m_channelCount * sizeof(qint16)) {
+        AudioKernels::deinterleave(adapter->m_captureBuffers.data(), static_cast<const qint16*>(frame->buf), adapter->m_channelCount, samples);
+    }
+    else {
+        memset(adapter->m_captureFrame.data(), 0, adapter->m_captureFrame.size() * sizeof(qint16));
+    }
+
+    quint32 write = adapter->m_captureWrite.loadRelaxed();              // only this thread writes it
+    qint32 ahead = qint32(write - position);
+    if (!control.synced || ahead < 0 || ahead > qint32(adapter->m_ringSize - 2 * samples)) {
+        // start (again) at the target fill level. The bridge may be reading the frames up to there, so they are not
+        // touched: the bridge reads them as silence. It is published before the new write position
+        write = position + MCADAPTER_TARGET_FRAMES * samples;
+        adapter->m_captureStart.storeRelease(write);
+        control.phase = -2.0;
+        control.error = 0;
+        control.synced = true;
+    }
+    else if (qint32(write - adapter->m_captureStart.loadRelaxed()) > qint32(2 * adapter->m_ringSize)) {
+        // keep the resync position behind anything the bridge reads when the positions wrap around
+        adapter->m_captureStart.storeRelaxed(write - 2 * adapter->m_ringSize);
+    }
+
+    // the interpolation needs one input sample before and two after the output position, the input of a channel is
+    // its history (index -3..-1) followed by the frame (0..samples-1), so outputs are taken from -2 up to samples-2
+    adapter->m_captureTaps.clear();
+    double phase = control.phase;
+    while (phase < samples - 2.0) {
+        qint32 index = qint32(floor(phase));
+        adapter->m_captureTaps.append({index + 3, float(phase - index)});
+        phase += control.step;
+    }
+    control.phase = phase - samples;
+
+    float *input = adapter->m_captureInput.data();
+    for (unsigned ch = 0; ch < adapter->m_channelCount; ch++) {
+        float *history = adapter->m_captureHistory.data() + ch * 3;
+        const qint16 *in = adapter->m_captureBuffers[ch];
+        input[0] = history[0];
+        input[1] = history[1];
+        input[2] = history[2];
+        for (unsigned i = 0; i < samples; i++)
+            input[i + 3] = in[i];
+        history[0] = input[samples];
+        history[1] = input[samples + 1];
+        history[2] = input[samples + 2];
+
+        qint16 *ring = adapter->captureRing(ch);
+        quint32 out = write;
+        for (const s_tap &tap : adapter->m_captureTaps) {
+            ring[out & mask] = toSample(interpolate(input + tap.index, tap.fraction));
+            out++;
+        }
+    }
+    write += adapter->m_captureTaps.size();
+    adapter->m_captureWrite.storeRelease(write);
+
+    // the device is faster if it writes more than the bridge reads: step > 1 and a positive integral
+    adapter->updateDriftControl(control, qint32(write - position) - progress * samples);
+    control.drift.storeRelaxed(qRound(control.integral * 1e7));
+    return PJ_SUCCESS;
+}
+
+pj_status_t MultichannelAdapter::deviceGetFrame(pjmedia_port *port, pjmedia_frame *frame)
+{
+    MultichannelAdapter *adapter = static_cast<MultichannelAdapter*>(port->port_data.pdata);
+    s_driftControl &control = adapter->m_playbackControl;
+    unsigned samples = adapter->m_samplesPerChannel;
+    quint32 mask = adapter->m_ringSize - 1;
+    quint32 position;
+    double progress;
+    frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    frame->size = samples * adapter->m_channelCount * sizeof(qint16);
+    if (!adapter->bridgePosition(position, progress)) {                 // nobody writes yet
+        memset(frame->buf, 0, frame->size);
+        return PJ_SUCCESS;
+    }
+
+    // everything up to the bridge position was written by the bridge
+    quint32 read = adapter->m_playbackRead;
+    qint32 available = qint32(position - read);
+    if (!control.synced || available < qint32(samples + samples / 64 + 4) || available > qint32(adapter->m_ringSize - 2 * samples)) {
+        read = position - MCADAPTER_TARGET_FRAMES * samples;
+        available = qint32(position - read);
+        control.phase = 1.0;
+        control.error = 0;
+        control.synced = true;
+    }
+    adapter->updateDriftControl(control, available + progress * samples);
+
+    // outputs are taken from input index 1 on, so index - 1 is still in the ring
+    double phase = control.phase;
+    for (unsigned i = 0; i < samples; i++) {
+        qint32 index = qint32(floor(phase));
+        adapter->m_playbackTaps[i] = {index, float(phase - index)};
+        phase += control.step;
+    }
+    qint32 consumed = qint32(floor(phase)) - 1;
+    control.phase = phase - consumed;
+
+    for (unsigned ch = 0; ch < adapter->m_channelCount; ch++) {
+        const qint16 *ring = adapter->playbackRing(ch);
+        qint16 *out = adapter->m_playbackBuffers[ch];
+        for (unsigned i = 0; i < samples; i++) {
+            const s_tap &tap = adapter->m_playbackTaps[i];
+            quint32 at = read + tap.index;
+            float s[4] = {float(ring[(at - 1) & mask]), float(ring[at & mask]), float(ring[(at + 1) & mask]), float(ring[(at + 2) & mask])};
+            out[i] = toSample(interpolate(s + 1, tap.fraction));
+        }
+    }
+    AudioKernels::interleave(static_cast<qint16*>(frame->buf), adapter->m_playbackBuffers.data(), adapter->m_channelCount, samples);
+    adapter->m_playbackRead = read + consumed;
+
+    // the device is faster if it reads more than the bridge writes: step < 1 and a negative integral
+    control.drift.storeRelaxed(qRound(-control.integral * 1e7));
+    return PJ_SUCCESS;
+}
+
+pj_status_t MultichannelAdapter::channelGetFrame(pjmedia_port *port, pjmedia_frame *frame)
+{
+    MultichannelAdapter *adapter = static_cast<MultichannelAdapter*>(port->port_data.pdata);
+    unsigned ch = port->port_data.ldata;
+    unsigned samples = adapter->m_samplesPerChannel;
+    quint32 position = quint32(adapter->m_bridgeClock.loadRelaxed());  // only this thread writes it
+    quint32 write = adapter->m_captureWrite.loadAcquire();
+    qint32 available = qint32(write - position);
+    frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    frame->size = samples * sizeof(qint16);
+    if (available < qint32(samples) || available > qint32(adapter->m_ringSize)) {      // device not started or out of sync
+        memset(frame->buf, 0, frame->size);
+        return PJ_SUCCESS;
+    }
+    qint32 silent = qint32(adapter->m_captureStart.loadAcquire() - position);     // samples before a resync position
+    if (silent >= qint32(samples) && silent <= qint32(adapter->m_ringSize)) {
+        memset(frame->buf, 0, frame->size);
+        return PJ_SUCCESS;
+    }
+    if (silent < 0 || silent > qint32(adapter->m_ringSize))
+        silent = 0;
+    memset(frame->buf, 0, silent * sizeof(qint16));
+    const qint16 *ring = adapter->captureRing(ch);
+    quint32 start = position + silent;
+    quint32 offset = start & (adapter->m_ringSize - 1);
+    quint32 count = samples - silent;
+    quint32 first = qMin(count, adapter->m_ringSize - offset);
+    qint16 *out = static_cast<qint16*>(frame->buf) + silent;
+    memcpy(out, ring + offset, first * sizeof(qint16));
+    memcpy(out + first, ring, (count - first) * sizeof(qint16));
+    return PJ_SUCCESS;
+}
+
+pj_status_t MultichannelAdapter::channelPutFrame(pjmedia_port *port, pjmedia_frame *frame)
+{
+    MultichannelAdapter *adapter = static_cast<MultichannelAdapter*>(port->port_data.pdata);
+    unsigned ch = port->port_data.ldata;
+    unsigned samples = adapter->m_samplesPerChannel;
+    // the bridge puts a frame to every port on every tick (a frame of type NONE if nothing is connected) after it got
+    // the frames of all ports, with the bridge timestamp. So the timestamp is the same for all channels of a tick
+    // and is the position the channels write to. The next tick reads and writes one frame later
+    quint32 position = frame->timestamp.u32.lo;
+    qint16 *ring = adapter->playbackRing(ch);
+    quint32 offset = position & (adapter->m_ringSize - 1);
+    quint32 first = qMin(quint32(samples), adapter->m_ringSize - offset);
+    if (frame->type == PJMEDIA_FRAME_TYPE_AUDIO && frame->size >= samples * sizeof(qint16)) {
+        memcpy(ring + offset, frame->buf, first * sizeof(qint16));
+        memcpy(ring, static_cast<const qint16*>(frame->buf) + first, (samples - first) * sizeof(qint16));
+    }
+    else {
+        memset(ring + offset, 0, first * sizeof(qint16));
+        memset(ring, 0, (samples - first) * sizeof(qint16));
+    }
+    // the next position is published after the last channel of the tick, the device thread reads the playback
+    // rings up to it. A tick that misses channels is published with the first channel of the next tick
+    if (position != adapter->m_tickPosition) {
+        if (adapter->m_tickPuts > 0 && adapter->m_tickPuts < adapter->m_channelCount)
+            adapter->m_bridgeClock.storeRelease((quint64(quint32(adapter->nowUs())) << 32) | position);
+        adapter->m_tickPosition = position;
+        adapter->m_tickPuts = 0;
+    }
+    if (++adapter->m_tickPuts == adapter->m_channelCount) {
+        quint64 tickUs = quint32(adapter->nowUs());
+        adapter->m_bridgeClock.storeRelease((tickUs << 32) | (position + samples));
+    }
+    return PJ_SUCCESS;
+}
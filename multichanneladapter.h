@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTICHANNELADAPTER_H
+#define MULTICHANNELADAPTER_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QVector>
+
+extern "C" {
+#include <pjmedia.h>
+}
+
+#define MCADAPTER_FRAMES 8                  // ring buffer length per channel and direction in frames, rounded up to a power of 2 samples
+#define MCADAPTER_TARGET_FRAMES 3           // fill level the drift control keeps between the sound device and the bridge
+#define MCADAPTER_MAX_DRIFT 0.002           // largest clock drift the resampler compensates (2000 ppm)
+
+/**
+ * @brief Connects a multichannel sound device to the conference bridge, one bridge port per channel
+ * @details replaces the pjmedia splitcomb with one reverse channel per channel. The device port is connected
+ * to the sound port, the channel ports are added to the bridge. Every adapter is a clock domain of its own:
+ * the sound device runs on its own crystal, the bridge on the clock of the master port.
+ *
+ * A captured frame is de-interleaved once, resampled to the bridge clock and written to per channel ring buffers
+ * the bridge reads at its own position. For playback the bridge writes its frames to per channel ring buffers at
+ * the bridge timestamp, the device callback resamples them to the device clock and interleaves them once.
+ * The resampling ratio follows the fill level of the ring buffers (a PI control, the bridge position is
+ * interpolated between bridge ticks to see drift far below one frame). The integral part is the estimated
+ * drift of the device against the bridge, reported by captureDriftPpm() and playbackDriftPpm().
+ *
+ * The sound device threads and the bridge clock thread share no locks: every ring has one writer and one
+ * reader, positions are published with release/acquire. A direction that runs out of range is resynchronized,
+ * a channel without data plays and captures silence.
+ * The adapter must live until the channel ports are removed from the bridge and the sound port is destroyed.
+ */
+class MultichannelAdapter
+{
+public:
+    /**
+     * @param clockRate the clock rate of the device and the bridge
+     * @param channelCount number of channels of the device
+     * @param samplesPerChannel samples per frame of one channel
+     */
+    MultichannelAdapter(unsigned clockRate, unsigned channelCount, unsigned samplesPerChannel);
+    virtual ~MultichannelAdapter();
+
+    /**
+     * @brief the port to connect to the sound port, it has all channels interleaved
+     */
+    pjmedia_port* devicePort() { return &m_devicePort; };
+
+    /**
+     * @brief the port of one channel to add to the conference bridge
+     * @param channel 0 based channel number
+     */
+    pjmedia_port* channelPort(unsigned channel) { return &m_channelPorts[channel]; };
+
+    unsigned channelCount() const { return m_channelCount; };
+
+    /**
+     * @brief estimated drift of the capture clock against the bridge clock in ppm, positive if the device is faster
+     */
+    double captureDriftPpm() const { return m_captureControl.drift.loadRelaxed() / 10.0; };
+
+    /**
+     * @brief estimated drift of the playback clock against the bridge clock in ppm, positive if the device is faster
+     */
+    double playbackDriftPpm() const { return m_playbackControl.drift.loadRelaxed() / 10.0; };
+
+protected:
+    /**
+     * @brief the monotonic time of the bridge ticks in us, the drift test replaces it with a simulated clock
+     */
+    virtual qint64 nowUs() const { return m_clock.nsecsElapsed() / 1000; };
+
+private:
+    static pj_status_t devicePutFrame(pjmedia_port *port, pjmedia_frame *frame);
+    static pj_status_t deviceGetFrame(pjmedia_port *port, pjmedia_frame *frame);
+    static pj_status_t channelPutFrame(pjmedia_port *port, pjmedia_frame *frame);
+    static pj_status_t channelGetFrame(pjmedia_port *port, pjmedia_frame *frame);
+
+    /**
+     * @brief state of the drift control and the resampler of one direction, only used by that device thread
+     */
+    struct s_driftControl{
+        bool synced = false;
+        double phase = 0;                   // position of the next output sample in the input
+        double step = 1.0;                  // input samples per output sample
+        double error = 0;                   // smoothed fill level error in frames
+        double integral = 0;                // = estimated clock ratio - 1
+        QAtomicInt drift = 0;               // integral in 0.1 ppm, published for the main thread
+    };
+
+    /**
+     * @brief one output sample of the resampler: interpolated between input index and index + 1
+     */
+    struct s_tap{
+        qint32 index;
+        float fraction;
+    };
+
+    /**
+     * @brief the bridge position in samples and how far (0..1 frames) the bridge went since its last tick
+     * @return false if the bridge didn't tick yet
+     */
+    bool bridgePosition(quint32 &position, double &progress) const;
+    void updateDriftControl(s_driftControl &control, double fill);
+
+    qint16* captureRing(unsigned channel) { return m_capture.data() + channel * m_ringSize; };
+    qint16* playbackRing(unsigned channel) { return m_playback.data() + channel * m_ringSize; };
+
+    unsigned m_channelCount;
+    unsigned m_samplesPerChannel;
+    quint32 m_ringSize;                     // samples per channel, power of 2
+    double m_framePeriodUs;
+    pjmedia_port m_devicePort;
+    QVector<pjmedia_port> m_channelPorts;
+    QElapsedTimer m_clock;
+
+    // bridge clock: position of the frame the bridge handles next (low 32 bit) and the time of that tick in us (high 32 bit)
+    // it is published after the last channel of a tick is written
+    QAtomicInteger<quint64> m_bridgeClock;
+    quint32 m_tickPosition = 0;                         // bridge timestamp of the current tick, only used by the bridge
+    unsigned m_tickPuts = 0;                            // channels written in the current tick
+
+    // capture: written by the device thread for all channels at once, read by the bridge per channel at the bridge position
+    QVector<qint16> m_capture;
+    QAtomicInteger<quint32> m_captureWrite;
+    QAtomicInteger<quint32> m_captureStart;             // set on a resync, the bridge reads silence before this position
+    s_driftControl m_captureControl;
+    QVector<qint16> m_captureFrame;                     // de-interleaved device frame
+    QVector<qint16*> m_captureBuffers;
+    QVector<float> m_captureHistory;                    // last 3 input samples per channel for the interpolation
+    QVector<float> m_captureInput;
+    QVector<s_tap> m_captureTaps;
+
+    // playback: written by the bridge per channel at the bridge timestamp, read by the device thread for all channels at once
+    QVector<qint16> m_playback;
+    quint32 m_playbackRead = 0;                         // only used by the device thread
+    s_driftControl m_playbackControl;
+    QVector<qint16> m_playbackFrame;                    // resampled channels before interleaving
+    QVector<qint16*> m_playbackBuffers;
+    QVector<s_tap> m_playbackTaps;
+};
+
+#endif // MULTICHANNELADAPTER_H
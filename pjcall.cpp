@@ -39,24 +39,24 @@ void PJCall::on_media_finished(pjmedia_port *media_port, void *user_data)
     s_account* callAcc = AWAHSipLib::instance()->m_Accounts->getAccountByID(ci.accId);
 
     if(ownObj == nullptr) {
-        AWAHSipLib::instance()->m_Log->writeLog(1, (QString("PJCall::on_media_finished(): Got Invalid CallID: %1 PJ::Call Object lookup not succesfull!").arg(call->callId)));
+        AWAHLOG(AWAHSipLib::instance()->m_Log, 1, (QString("PJCall::on_media_finished(): Got Invalid CallID: %1 PJ::Call Object lookup not succesfull!").arg(call->callId)));
         return;
     }
 
     if(call->callId < 0 && call->callId > (int)AWAHSipLib::instance()->epCfg.uaConfig.maxCalls) {
-        AWAHSipLib::instance()->m_Log->writeLog(1, (QString("PJCall::on_media_finished(): Got Invalid CallID: %1").arg(call->callId)));
+        AWAHLOG(AWAHSipLib::instance()->m_Log, 1, (QString("PJCall::on_media_finished(): Got Invalid CallID: %1").arg(call->callId)));
         return;
     }
 
     try {
         PJSUA2_CHECK_EXPR( pjsua_conf_disconnect(pjsua_player_get_conf_port(call->player_id),pjsua_call_get_conf_port(call->callId)) );
     }  catch (Error &err) {
-        AWAHSipLib::instance()->m_Log->writeLog(1, (QString("PJCall::on_media_finished(): disconnect call from player failed ") + err.info().c_str()));
+        AWAHLOG(AWAHSipLib::instance()->m_Log, 1, (QString("PJCall::on_media_finished(): disconnect call from player failed ") + err.info().c_str()));
     }
 
     if(call->rec_id != INVALID_ID  ){
         PJSUA2_CHECK_EXPR (pjsua_conf_connect(pjsua_call_get_conf_port(call->callId), pjsua_recorder_get_conf_port(call->rec_id)) );
-        AWAHSipLib::instance()->m_Log->writeLog(3, (QString("PJCall::on_media_finished(): Announcement for CallID: %1 finished connecting call to recorder").arg(call->callId)));
+        AWAHLOG(AWAHSipLib::instance()->m_Log, 3, (QString("PJCall::on_media_finished(): Announcement for CallID: %1 finished connecting call to recorder").arg(call->callId)));
         if(!callAcc->FileRecordRXonly){
             PJSUA2_CHECK_EXPR (pjsua_conf_connect(call->splitterSlot, pjsua_recorder_get_conf_port(call->rec_id)) );
         }
@@ -69,29 +69,23 @@ void PJCall::onCallState(OnCallStateParam &prm)
     Q_UNUSED(prm);
     CallInfo ci = getInfo();
     s_account* callAcc = parent->getAccountByID(ci.accId);
-    s_Call*  CalllistEntry = nullptr;
-    int callid = getId();
-    for(auto& call : callAcc->CallList){
-        if(call.callId == callid){
-            CalllistEntry = &call;
-            break;
-        }
-    }
+    s_Call*  CalllistEntry = parent->getCallByID(getId(), ci.accId);
     if(CalllistEntry == nullptr) {
-        m_lib->m_Log->writeLog(1, QString("onCallState: Call %1 not found in CallList of Account %2: %3: Creating a new entry")
-                               .arg(QString::fromStdString(ci.remoteUri), QString::number(callAcc->AccID), callAcc->name));
         s_Call newCall(callAcc->splitterSlot);                              // callist entry is created here if not already done in onSDP callback
         newCall.callptr = this;
         newCall.callId = getId();
         newCall.codec = callAcc->SelectedCodec;
         newCall.CallStatusCode =  getInfo().state;
         newCall.CallStatusText = QString::fromStdString(getInfo().stateText);
-        callAcc->CallList.append(newCall);
-        CalllistEntry = &newCall;
+        CalllistEntry = parent->addCall(callAcc, newCall);
+        AWAHCALLLOG(m_lib->m_Log, 1, ci.accId, ci.id, QString("onCallState: Call %1 not found in CallList of Account %2: %3: Created a new entry")
+                               .arg(QString::fromStdString(ci.remoteUri), QString::number(callAcc->AccID), callAcc->name));
         emit m_lib->AccountsChanged(m_lib->m_Accounts->getAccounts());
     }
 
     parent->OncallStateChanged(ci.accId, ci.role, ci.id, ci.remOfferer, ci.connectDuration.sec,ci.state, ci.lastStatusCode, QString::fromStdString(ci.lastReason),QString::fromStdString(ci.remoteUri));
+    AWAHCALLLOG(m_lib->m_Log, 4, ci.accId, ci.id, QString("onCallState: Call %1 with %2 is %3, last status %4 %5")
+                               .arg(QString::number(ci.id), QString::fromStdString(ci.remoteUri), QString::fromStdString(ci.stateText), QString::number(ci.lastStatusCode), QString::fromStdString(ci.lastReason)));
 
     if(ci.state == PJSIP_INV_STATE_DISCONNECTED)
     {  
@@ -114,31 +108,23 @@ void PJCall::onCallState(OnCallStateParam &prm)
                     }
                     PJSUA2_CHECK_EXPR( pjsua_recorder_destroy(CalllistEntry->rec_id) );
                     CalllistEntry->rec_id = PJSUA_INVALID_ID;
-                    m_lib->m_Log->writeLog(3,QString("onCallState: closing recorder for call with id: %1 from %2 of Account %3").arg(QString::number(ci.id), QString::fromStdString(ci.remoteUri), callAcc->name));
+                    AWAHCALLLOG(m_lib->m_Log, 3, ci.accId, ci.id, QString("onCallState: closing recorder for call with id: %1 from %2 of Account %3").arg(QString::number(ci.id), QString::fromStdString(ci.remoteUri), callAcc->name));
                 }
             }  catch (Error &err) {
-                m_lib->m_Log->writeLog(1,QString("onCallState: Disconnect Error: ") + QString().fromStdString(err.info(true)));
+                AWAHCALLLOG(m_lib->m_Log, 1, ci.accId, ci.id, QString("onCallState: Disconnect Error: ") + QString().fromStdString(err.info(true)));
             }
         }
 
         m_lib->m_Accounts->addCallToHistory(callAcc->AccID,QString::fromStdString(ci.remoteUri),ci.connectDuration.sec,CalllistEntry->codec,!ci.remOfferer);
 
-        callAcc = parent->getAccountByID(ci.accId);         // as callHistory is stored in QList of callAccount, most likly this Pointer changed.
-        QMutableListIterator<s_Call> i(callAcc->CallList);
-        while(i.hasNext()){
-            s_Call &callentry = i.next();
-            if(callentry.callId == ci.id){                  //check if its a valid callid and remove it from the list
-                i.remove();
-                break;
-            }
-        }
+        parent->removeCall(ci.id);
 
         if(callAcc->CallList.count()==0){
             if(callAcc->gpioDev != nullptr){
                 callAcc->gpioDev->setConnected(false);
             }
         }
-        m_lib->m_Log->writeLog(3,QString("onCallState: deleting call with id: %1 from %2 of Account %3").arg(QString::number(ci.id), QString::fromStdString(ci.remoteUri), callAcc->name));
+        AWAHCALLLOG(m_lib->m_Log, 3, ci.accId, ci.id, QString("onCallState: deleting call with id: %1 from %2 of Account %3").arg(QString::number(ci.id), QString::fromStdString(ci.remoteUri), callAcc->name));
         emit m_lib->m_Accounts->AccountsChanged(m_lib->m_Accounts->getAccounts());
         delete this;
     }
@@ -150,20 +136,14 @@ void PJCall::onCallMediaState(OnCallMediaStateParam &prm)
     Q_UNUSED(prm);
     CallInfo ci = getInfo();
     s_account* callAcc = parent->getAccountByID(ci.accId);
-    s_Call*  Callopts = nullptr;
-    for(auto& call : callAcc->CallList){
-        if(call.callId == getId()){
-            Callopts = &call;
-            break;
-        }
-    }
+    s_Call*  Callopts = parent->getCallByID(getId(), ci.accId);
     if(Callopts == nullptr) {
-        m_lib->m_Log->writeLog(1, QString("onCallMediaState: Call %1 not found in CallList of Account %2:%3")
+        AWAHCALLLOG(m_lib->m_Log, 1, ci.accId, ci.id, QString("onCallMediaState: Call %1 not found in CallList of Account %2:%3")
                                .arg(QString::fromStdString(ci.remoteUri), QString::number(callAcc->AccID), callAcc->name));
         return;
     }
 
-    m_lib->m_Log->writeLog(3,QString("onCallMediaState: Call %1:%2 of Account %3:%4 has media: %5")
+    AWAHCALLLOG(m_lib->m_Log, 3, ci.accId, ci.id, QString("onCallMediaState: Call %1:%2 of Account %3:%4 has media: %5")
                            .arg(QString::number(Callopts->callId), QString::fromStdString(ci.remoteUri), QString::number(callAcc->AccID), callAcc->name, hasMedia() ? "true" : "false" ));
 
     if(!hasMedia()) return;
@@ -181,12 +161,12 @@ void PJCall::onCallMediaState(OnCallMediaStateParam &prm)
                 pj_status_t status = PJ_ENOTFOUND;
 
                 // create player for playback media
-                m_lib->m_Log->writeLog(3,QString("onCallMediaState: creating announcement player for callId %1").arg(Callopts->callId));
+                AWAHCALLLOG(m_lib->m_Log, 3, ci.accId, ci.id, QString("onCallMediaState: creating announcement player for callId %1").arg(Callopts->callId));
                 status = pjsua_player_create(pj_cstr(&name,callAcc->FilePlayPath.toStdString().c_str()), PJMEDIA_FILE_NO_LOOP, &Callopts->player_id);
                 if (status != PJ_SUCCESS) {
                     char buf[50];
                     pj_strerror	(status,buf,sizeof (buf) );
-                    m_lib->m_Log->writeLog(1,QString("onCallMediaState: Error creating announcement player: ") + buf);
+                    AWAHCALLLOG(m_lib->m_Log, 1, ci.accId, ci.id, QString("onCallMediaState: Error creating announcement player: ") + buf);
                 } else {
                     pjsua_data* intData = pjsua_get_var();
                     const pjsua_conf_port_id slot = pjsua_player_get_conf_port(Callopts->player_id);
@@ -197,7 +177,7 @@ void PJCall::onCallMediaState(OnCallMediaStateParam &prm)
                     if (status != PJ_SUCCESS){
                         char buf[50];
                         pj_strerror	(status,buf,sizeof (buf) );
-                        m_lib->m_Log->writeLog(1,QString("onCallMediaState: Error getting announcement player port: ") + buf);
+                        AWAHCALLLOG(m_lib->m_Log, 1, ci.accId, ci.id, QString("onCallMediaState: Error getting announcement player port: ") + buf);
                         return;
                     }
                     // register media finished callback
@@ -205,18 +185,18 @@ void PJCall::onCallMediaState(OnCallMediaStateParam &prm)
                     if (status != PJ_SUCCESS){
                         char buf[50];
                         pj_strerror	(status,buf,sizeof (buf) );
-                        m_lib->m_Log->writeLog(1,QString("onCallMediaState: Error adding sound-playback callback ") + buf);
+                        AWAHCALLLOG(m_lib->m_Log, 1, ci.accId, ci.id, QString("onCallMediaState: Error adding sound-playback callback ") + buf);
                         return;
                     }
                 }
             } else {
-                m_lib->m_Log->writeLog(2,QString("onCallMediaState: announcement player for callId %1 already exists!").arg(Callopts->callId));
+                AWAHCALLLOG(m_lib->m_Log, 2, ci.accId, ci.id, QString("onCallMediaState: announcement player for callId %1 already exists!").arg(Callopts->callId));
             }
         }
 
         if(!callAcc->FileRecordPath.isEmpty()){            // if a filerecorder is configured create a recorder
             if(Callopts->rec_id == PJSUA_INVALID_ID) {
-                m_lib->m_Log->writeLog(3,QString("onCallMediaState: creating a call recorder for callId %1").arg(Callopts->callId));
+                AWAHCALLLOG(m_lib->m_Log, 3, ci.accId, ci.id, QString("onCallMediaState: creating a call recorder for callId %1").arg(Callopts->callId));
                 pj_status_t status = PJ_ENOTFOUND;
                 pj_str_t rec_file;
                 QDateTime local(QDateTime::currentDateTime());
@@ -246,7 +226,7 @@ void PJCall::onCallMediaState(OnCallMediaStateParam &prm)
                 if (status != PJ_SUCCESS){
                     char buf[50];
                     pj_strerror	(status,buf,sizeof (buf) );
-                    m_lib->m_Log->writeLog(1,QString("onCallMediaState: Error creating call recorder: ") + buf);
+                    AWAHCALLLOG(m_lib->m_Log, 1, ci.accId, ci.id, QString("onCallMediaState: Error creating call recorder: ") + buf);
                     return;
                 }
                 // connect active call to call recorder immediatley if there is no fileplayer configured
@@ -257,7 +237,7 @@ void PJCall::onCallMediaState(OnCallMediaStateParam &prm)
                     }
                 }
             } else {
-                m_lib->m_Log->writeLog(2,QString("onCallMediaState: call recorder for callId %1 already exists").arg(Callopts->callId));
+                AWAHCALLLOG(m_lib->m_Log, 2, ci.accId, ci.id, QString("onCallMediaState: call recorder for callId %1 already exists").arg(Callopts->callId));
             }
 
         }
@@ -265,7 +245,7 @@ void PJCall::onCallMediaState(OnCallMediaStateParam &prm)
         PJSUA2_CHECK_EXPR( pjsua_conf_connect((callAcc->splitterSlot),Callopts->callConfPort) );
 
     } catch(Error& err) {
-        m_lib->m_Log->writeLog(1,QString("onCallMediaState: media error ") +  err.info().c_str());
+        AWAHCALLLOG(m_lib->m_Log, 1, ci.accId, ci.id, QString("onCallMediaState: media error ") +  err.info().c_str());
         return;
     }
 }
@@ -341,20 +321,16 @@ void PJCall::onStreamCreated(OnStreamCreatedParam &prm)
     if(callAcc->fixedJitterBuffer){
         pjmedia_stream_jbuf_set_fixed((pjmedia_stream *) prm.stream, callAcc->fixedJitterBufferValue);
     }
-    for(auto& thecall : callAcc->CallList){
-        if(thecall.callId == getId()){
-            if(true){
-                thecall.codec = remoteCodec;
-            }
-            break;
-        }
+    s_Call* thecall = parent->getCallByID(getId(), ci.accId);
+    if(thecall != nullptr){
+        thecall->codec = remoteCodec;
     }
     m_lib->m_Codecs->listCodecs();                                                          // call is established, from now on accept all codecs according to the set priorities
 }
 
 void PJCall::onCallTransferRequest(OnCallTransferRequestParam &prm)
 {
-    m_lib->m_Log->writeLog(3,QString("onCallTransferRequest: transfering call to: ") +  prm.dstUri.c_str() + prm.statusCode);
+    AWAHLOG(m_lib->m_Log, 3,QString("onCallTransferRequest: transfering call to: ") +  prm.dstUri.c_str() + prm.statusCode);
     CallInfo ci = getInfo();
     parent->OncallStateChanged(ci.accId, ci.role, ci.id,ci.remOfferer, ci.connectDuration.sec,ci.state, ci.lastStatusCode, QString::fromStdString(ci.lastReason),QString::fromStdString(ci.remoteUri));
 }
@@ -362,13 +338,13 @@ void PJCall::onCallTransferRequest(OnCallTransferRequestParam &prm)
 
 void PJCall::onCallTransferStatus(OnCallTransferStatusParam &prm)
 {
-    m_lib->m_Log->writeLog(3,QString("onCallTransferStatus: ") + prm.reason.c_str());
+    AWAHLOG(m_lib->m_Log, 3,QString("onCallTransferStatus: ") + prm.reason.c_str());
     CallInfo ci = getInfo();
     parent->OncallStateChanged(ci.accId, ci.role, ci.id,ci.remOfferer, ci.connectDuration.sec,ci.state, ci.lastStatusCode, QString::fromStdString(ci.lastReason),QString::fromStdString(ci.remoteUri));
 
     if(prm.statusCode == PJSIP_SC_OK)
     {
-        m_lib->m_Log->writeLog(3,QString("onCallTransferStatus: deleting call with call id ") + QString::number(ci.id));
+        AWAHCALLLOG(m_lib->m_Log, 3, ci.accId, ci.id, QString("onCallTransferStatus: deleting call with call id ") + QString::number(ci.id));
         delete this;
     }
 }
@@ -376,7 +352,7 @@ void PJCall::onCallTransferStatus(OnCallTransferStatusParam &prm)
 
 void PJCall::onCallReplaceRequest(OnCallReplaceRequestParam &prm)
 {
-    m_lib->m_Log->writeLog(3,QString("onCallReplaceRequest: status code ") + QString::number(prm.statusCode));
+    AWAHLOG(m_lib->m_Log, 3,QString("onCallReplaceRequest: status code ") + QString::number(prm.statusCode));
 }
 
 
@@ -388,7 +364,7 @@ void PJCall::onCallSdpCreated(OnCallSdpCreatedParam &prm)
     QString sdpString;
     callAcc = parent->getAccountByID(ci.accId);
     if(callAcc == nullptr){
-        m_lib->m_Log->writeLog(2,QString("onSdpCreated: Error account not found!"));
+        AWAHLOG(m_lib->m_Log, 2,QString("onSdpCreated: Error account not found!"));
         return;
     }
 
@@ -401,15 +377,12 @@ void PJCall::onCallSdpCreated(OnCallSdpCreatedParam &prm)
         sdpString = QString::fromStdString(prm.remSdp.wholeSdp);
     }
 
-    s_Call*  call = nullptr;
-    for(auto& thecall : callAcc->CallList){
-        if(thecall.callId == getId()){
-            thecall.SDP = sdpString;
-            break;
-        }
+    s_Call*  call = parent->getCallByID(getId(), ci.accId);
+    if(call != nullptr){
+        call->SDP = sdpString;
     }
-    if(call == nullptr){
-        m_lib->m_Log->writeLog(1, QString("onCallSDP: Call %1 not found in CallList of Account %2:%3: Creating a new entry")
+    else{
+        AWAHLOG(m_lib->m_Log, 1, QString("onCallSDP: Call %1 not found in CallList of Account %2:%3: Creating a new entry")
                                .arg(QString::fromStdString(ci.remoteUri), QString::number(callAcc->AccID), callAcc->name));
         s_Call newCall(callAcc->splitterSlot);                                                                                      // callist entry is created here
         newCall.callptr = this;
@@ -417,7 +390,7 @@ void PJCall::onCallSdpCreated(OnCallSdpCreatedParam &prm)
         newCall.CallStatusCode =  getInfo().state;
         newCall.CallStatusText = QString::fromStdString(getInfo().stateText);
         newCall.SDP = sdpString;
-        callAcc->CallList.append(newCall);
+        parent->addCall(callAcc, newCall);
     }
     emit m_lib->AccountsChanged(m_lib->m_Accounts->getAccounts());
 }
@@ -440,11 +413,11 @@ void PJCall::onDtmfDigit(OnDtmfDigitParam &prm)
     s_account* callAcc = nullptr;
     callAcc = parent->getAccountByID(ci.accId);
     if(callAcc == nullptr){
-        m_lib->m_Log->writeLog(2,QString("onDtmfDigit: Error account not found!"));
+        AWAHLOG(m_lib->m_Log, 2,QString("onDtmfDigit: Error account not found!"));
         return;
     }
     if(callAcc->gpioDev != nullptr){
         callAcc->gpioDev->setFromDTMF(dtmfdigit);
     }
-    m_lib->m_Log->writeLog(4,QString("Account: ") + callAcc->name + " recieved DTMF digit: " + QString().fromStdString(prm.digit));
+    AWAHCALLLOG(m_lib->m_Log, 4, ci.accId, ci.id, QString("Account: ") + callAcc->name + " recieved DTMF digit: " + QString().fromStdString(prm.digit));
 }
@@ -28,5 +28,5 @@ PJLogWriter::PJLogWriter(Log *log) : m_Log(log)
 void PJLogWriter::write(const pj::LogEntry &entry)
 {
     QString msg = QString().fromStdString(entry.msg);
-    m_Log->writePJSUALog(msg);
+    m_Log->writePJSUALog(msg, uint(entry.level));
 }
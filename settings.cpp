@@ -25,20 +25,226 @@
 #include <QThread>
 #include <QSettings>
 #include <QDir>
+#include <QFileInfo>
+#include <QTimer>
 
 #define THIS_FILE		"settings.cpp"
 
+template <typename T>
+static ConfigRecord toConfigRecord(const QString &key, const T &item)
+{
+    QByteArray value;
+    QDataStream out(&value, QIODevice::WriteOnly);
+    out << item;
+    return qMakePair(key, value);
+}
+
+template <typename T>
+static QList<T> fromConfigRecords(const QList<ConfigRecord> &records)
+{
+    QList<T> items;
+    for (auto & record : records) {
+        T item;
+        QDataStream in(record.second);
+        in >> item;
+        if (in.status() == QDataStream::Ok)
+            items.append(item);
+    }
+    return items;
+}
+
+static QString routeKey(const QString &src, const QString &dest)
+{
+    return src + "\n" + dest;
+}
+
+static QList<ConfigRecord> deviceRecords(const QList<s_IODevices> &devices)
+{
+    QList<ConfigRecord> records;
+    for (int i = 0; i < devices.count(); i++) {
+        records.append(toConfigRecord(devices.at(i).uid.isEmpty() ? QString::number(i) : devices.at(i).uid, devices.at(i)));
+    }
+    return records;
+}
+
+static QList<ConfigRecord> labelRecords(const QMap<QString,QString> &labels)
+{
+    QList<ConfigRecord> records;
+    for (auto it = labels.constBegin(); it != labels.constEnd(); ++it) {
+        records.append(toConfigRecord(it.key(), it.value()));
+    }
+    return records;
+}
+
 Settings::Settings(AWAHSipLib *parentLib, QObject *parent) : QObject(parent), m_lib(parentLib)
 {
+    m_saveTimer.setSingleShot(true);
+    connect(&m_saveTimer, &QTimer::timeout, this, [this]() { writeSections(m_dirtySections); });
+    m_persistContext = new QObject;
+    m_persistContext->moveToThread(&m_persistThread);
+    connect(&m_persistThread, &QThread::finished, m_persistContext, &QObject::deleteLater);
+    m_persistThread.start(QThread::LowPriority);
+}
+
+Settings::~Settings()
+{
+    if (!m_persistenceStopped) {                                        // the managers are gone, pending changes can't be taken anymore
+        m_persistenceStopped = true;
+        m_persistThread.quit();
+        m_persistThread.wait();
+    }
+    delete m_configStore;
+}
+
+void Settings::scheduleSave(int section)
+{
+    if (m_persistenceStopped)
+        return;
+    m_dirtySections |= section;
+    if (!m_saveTimer.isActive())                                        // the first change starts the window, later ones are coalesced
+        m_saveTimer.start(m_saveDelay);
+}
+
+void Settings::writeSections(int sections)
+{
+    sections &= m_dirtySections;
+    m_dirtySections &= ~sections;
+    if (!sections)
+        return;
+    ConfigStore *store = configStore();
+    QList<QPair<QString, QList<ConfigRecord>>> changes;                 // the records are taken here, in the thread that owns the data
+    if (sections & IODevSection)
+        changes.append(qMakePair(QString("IODevConfig"), deviceRecords(*m_lib->m_AudioRouter->getAudioDevices())));
+    if (sections & GpioDevSection)
+        changes.append(qMakePair(QString("GpioDevConfig"), deviceRecords(m_lib->m_GpioDeviceManager->getGpioDevices())));
+    if (sections & GpioRoutesSection) {
+        QList<ConfigRecord> records;
+        for(auto& route : GpioRouter::instance()->getGpioRoutes()){
+            if(route.persistant)
+                records.append(toConfigRecord(routeKey(route.srcSlotId, route.destSlotId), route));
+        }
+        //records.append(offlineRoutes);                                // todo remember offlie GPIO routes
+        changes.append(qMakePair(QString("GpioRoutes"), records));
+    }
+    if (sections & BuddiesSection) {
+        QList<ConfigRecord> records;
+        for(auto& buddy : *m_lib->m_Buddies->getBuddies()){
+            records.append(toConfigRecord(buddy.uid, buddy));
+        }
+        changes.append(qMakePair(QString("Buddies"), records));
+    }
+    if (sections & AccountsSection) {
+        QList<ConfigRecord> records;
+        for(auto& account : *m_lib->m_Accounts->getAccounts()){
+            records.append(toConfigRecord(account.uid, account));
+        }
+        changes.append(qMakePair(QString("AccountConfig"), records));
+    }
+    if (sections & AudioRoutesSection)
+        changes.append(qMakePair(QString("AudioRoutes"), audioRouteRecords()));
+    if (sections & SourceNamesSection)
+        changes.append(qMakePair(QString("CustomSourceNames"), labelRecords(m_lib->m_AudioRouter->getCustomSourceLabels())));
+    if (sections & DestNamesSection)
+        changes.append(qMakePair(QString("CustomDestinationNames"), labelRecords(m_lib->m_AudioRouter->getCustomDestLables())));
+
+    QMetaObject::invokeMethod(m_persistContext, [store, changes]() {
+        for (auto & change : changes) {
+            store->setSection(change.first, change.second);
+        }
+    }, Qt::QueuedConnection);
+}
+
+void Settings::flush(int sections)
+{
+    if (m_persistenceStopped)
+        return;
+    if ((m_dirtySections & ~sections) == 0)
+        m_saveTimer.stop();
+    writeSections(sections);
+    if (m_persistThread.isRunning())
+        QMetaObject::invokeMethod(m_persistContext, []() {}, Qt::BlockingQueuedConnection);   // wait until everything is written
+}
+
+void Settings::stopPersistence(int sections)
+{
+    flush(sections);
+    m_persistenceStopped = true;
+    m_persistThread.quit();
+    m_persistThread.wait();
+}
+
+void Settings::openConfigStore()
+{
+    StartupSpan span(m_lib->m_Startup, "openConfigStore");
+    configStore();
+}
+
+ConfigStore* Settings::configStore()
+{
+    if (m_configStore)
+        return m_configStore;
+    QSettings settings("awah", "AWAHsipConfig");
+    QString journalName = QFileInfo(settings.fileName()).absoluteDir().filePath("AWAHsipConfig.journal");
+    m_configStore = new ConfigStore(journalName);
+    if (!m_configStore->open())
+        importConfigStore();
+    return m_configStore;
+}
+
+void Settings::importConfigStore()
+{
+    QSettings settings("awah", "AWAHsipConfig");
+    if (!m_configStore->create()) {
+        m_lib->m_Log->writeLog(1,QString("importConfigStore: could not create config journal ") + m_configStore->fileName());
+        return;
+    }
+    m_configStore->setSection("IODevConfig", deviceRecords(settings.value("IODevConfig").value<QList<s_IODevices>>()));
+    m_configStore->setSection("GpioDevConfig", deviceRecords(settings.value("GpioDevConfig").value<QList<s_IODevices>>()));
+
+    QList<ConfigRecord> records;
+    for (auto & route : settings.value("GpioRoutes").value<QList<s_gpioRoute>>()) {
+        records.append(toConfigRecord(routeKey(route.srcSlotId, route.destSlotId), route));
+    }
+    m_configStore->setSection("GpioRoutes", records);
+
+    records.clear();
+    for (auto & buddy : settings.value("Buddies").value<QList<s_buddy>>()) {
+        records.append(toConfigRecord(buddy.uid, buddy));
+    }
+    m_configStore->setSection("Buddies", records);
+
+    records.clear();
+    for (auto & account : settings.value("AccountConfig").value<QList<s_account>>()) {
+        records.append(toConfigRecord(account.uid, account));
+    }
+    m_configStore->setSection("AccountConfig", records);
+
+    records.clear();
+    for (auto & route : settings.value("AudioRoutes").value<QList<s_audioRoutes>>()) {
+        records.append(toConfigRecord(routeKey(route.srcDevName, route.destDevName), route));
+    }
+    m_configStore->setSection("AudioRoutes", records);
+
+    for (auto & group : {QString("CustomSourceNames"), QString("CustomDestinationNames")}) {
+        QMap<QString,QString> labels;
+        settings.beginGroup(group);
+        for (auto & key : settings.childKeys()) {
+            labels[key] = settings.value(key).toString();
+        }
+        settings.endGroup();
+        m_configStore->setSection(group, labelRecords(labels));
+    }
+    m_configStore->compact();
+    m_lib->m_Log->writeLog(3,QString("importConfigStore: config lists imported from ") + settings.fileName() + " to " + m_configStore->fileName());
 }
 
 void Settings::loadIODevConfig()
 {
+    StartupSpan span(m_lib->m_Startup, "loadIODevConfig");
     QList<s_IODevices> loadedDevices;
     int recordDevId, playbackDevId;
-    QSettings settings("awah", "AWAHsipConfig");
-    m_lib->m_Log->writeLog(3,QString("loadConfig: Settingsloaded from file:" + settings.fileName()));
-    loadedDevices = settings.value("IODevConfig").value<QList<s_IODevices>>();
+    m_lib->m_Log->writeLog(3,QString("loadConfig: Settingsloaded from file:" + configStore()->fileName()));
+    loadedDevices = fromConfigRecords<s_IODevices>(configStore()->section("IODevConfig"));
     QString MasterClockDev = getMasterClock();
 
     bool clockdevFound = false;
@@ -63,14 +269,17 @@ void Settings::loadIODevConfig()
     for( int i=0; i<loadedDevices.count(); ++i )                                                     // todo send an error message if sound device is not found!!
     {
         if(loadedDevices.at(i).devicetype == SoundDevice){
-            recordDevId = m_lib->m_AudioRouter->getSoundDevID(loadedDevices.at(i).inputname);
-            playbackDevId = m_lib->m_AudioRouter->getSoundDevID(loadedDevices.at(i).outputame);
+            recordDevId = playbackDevId = -1;
+            if(m_lib->m_AudioRouter->resolveSoundDeviceNames(loadedDevices[i])){                // the cards may have been plugged in another order
+                recordDevId = m_lib->m_AudioRouter->getSoundDevID(loadedDevices.at(i).inputname);
+                playbackDevId = m_lib->m_AudioRouter->getSoundDevID(loadedDevices.at(i).outputame);
+            }
             if (recordDevId != -1 && playbackDevId !=-1){
                 m_lib->m_AudioRouter->addAudioDevice(recordDevId,playbackDevId, loadedDevices.at(i).uid);
                 m_lib->m_Log->writeLog(3,QString("loadIODevConfig: added sound device from config file: ") + loadedDevices.at(i).inputname + " " + loadedDevices.at(i).outputame);
             }
             else{
-                m_lib->m_AudioRouter->setAudioDeviceToOffline(loadedDevices.at(i).inputname,loadedDevices.at(i).outputame, loadedDevices.at(i).uid);
+                m_lib->m_AudioRouter->setAudioDeviceToOffline(loadedDevices.at(i).inputname,loadedDevices.at(i).outputame, loadedDevices.at(i).uid, loadedDevices.at(i).typeSpecificSettings);
                 m_lib->m_Log->writeLog(1,QString("loadIODevConfig: Error loading sound Device: ") + loadedDevices.at(i).inputname + loadedDevices.at(i).outputame + " device not found");
             }
         }
@@ -95,21 +304,14 @@ void Settings::saveIODevConfig()
 {
     if (!m_IoDevicesLoaded)
         return;
-    QSettings settings("awah", "AWAHsipConfig");
-    settings.setValue("IODevConfig", QVariant::fromValue(*m_lib->m_AudioRouter->getAudioDevices()));
-    settings.sync();
+    scheduleSave(IODevSection);
 }
 
 void Settings::loadGpioDevConfig()
 {
-    QTimer::singleShot(1000, this, SLOT(loadIODevConfigLater()));                    // todo there must be a better way to do this
-}
-
-void Settings::loadIODevConfigLater()
-{
+    StartupSpan span(m_lib->m_Startup, "loadGpioDevConfig");
     QList<s_IODevices> loadedDevices;
-    QSettings settings("awah", "AWAHsipConfig");
-    loadedDevices = settings.value("GpioDevConfig").value<QList<s_IODevices>>();
+    loadedDevices = fromConfigRecords<s_IODevices>(configStore()->section("GpioDevConfig"));
     for(auto& device : loadedDevices){
         m_lib->m_GpioDeviceManager->createGeneric(device);
         m_lib->m_Log->writeLog(3,QString("loadGpioDevManager: added GPIO device from config file: ") + device.outputame);
@@ -122,17 +324,14 @@ void Settings::saveGpioDevConfig()
 {
     if (!m_GpioDevicesLoaded)
         return;
-    QSettings settings("awah", "AWAHsipConfig");
-    settings.setValue("GpioDevConfig", QVariant::fromValue(m_lib->m_GpioDeviceManager->getGpioDevices()));
-    settings.sync();
+    scheduleSave(GpioDevSection);
 }
 
 void Settings::loadGpioRoutes()
 {
+    StartupSpan span(m_lib->m_Startup, "loadGpioRoutes");
     QList<s_gpioRoute>  loadedRoutes;
-    QSettings settings("awah", "AWAHsipConfig");
-
-    loadedRoutes = settings.value("GpioRoutes").value<QList<s_gpioRoute>>();
+    loadedRoutes = fromConfigRecords<s_gpioRoute>(configStore()->section("GpioRoutes"));
     m_lib->m_Log->writeLog(3,QString("loadGpioRoutes: loaded routes: ") + QString::number(loadedRoutes.count()));
 
     for(auto& route : loadedRoutes ){
@@ -145,24 +344,14 @@ void Settings::saveGpioRoutes()
 {
     if(!m_GpioRoutesLoaded)
         return;
-    QList<s_gpioRoute> routesToSave;
-    const QList<s_gpioRoute> gpioRoutes = GpioRouter::instance()->getGpioRoutes();
-    for(auto& route : gpioRoutes){
-        if(route.persistant)
-            routesToSave.append(route);
-    }
-    //routesToSave.append(offlineRoutes);                                   // todo remember offlie GPIO routes
-    QSettings settings("awah", "AWAHsipConfig");
-    settings.setValue("GpioRoutes", QVariant::fromValue(routesToSave));
-    settings.sync();
+    scheduleSave(GpioRoutesSection);
 }
 
 void Settings::loadBuddies()
 {
+    StartupSpan span(m_lib->m_Startup, "loadBuddies");
     QList<s_buddy>  loadedBuddies;
-    QSettings settings("awah", "AWAHsipConfig");
-
-    loadedBuddies = settings.value("Buddies").value<QList<s_buddy>>();
+    loadedBuddies = fromConfigRecords<s_buddy>(configStore()->section("Buddies"));
     m_lib->m_Log->writeLog(3,QString("loadBuddies: loaded buddies: ") + QString::number(loadedBuddies.count()));
 
     for(auto& buddy : loadedBuddies ){
@@ -175,16 +364,14 @@ void Settings::saveBuddies()
 {
     if(!m_BuddiesLoaded)
         return;
-    QSettings settings("awah", "AWAHsipConfig");
-    settings.setValue("Buddies", QVariant::fromValue(*m_lib->m_Buddies->getBuddies()));
-    settings.sync();
+    scheduleSave(BuddiesSection);
 }
 
 void Settings::loadAccConfig()
 {
+    StartupSpan span(m_lib->m_Startup, "loadAccConfig");
     QList<s_account>  loadedAccounts;
-    QSettings settings("awah", "AWAHsipConfig");
-    loadedAccounts = settings.value("AccountConfig").value<QList<s_account>>();
+    loadedAccounts = fromConfigRecords<s_account>(configStore()->section("AccountConfig"));
 
     for(int i=0; i<loadedAccounts.count(); ++i ){
         m_lib->m_Accounts->createAccount(loadedAccounts.at(i).name,loadedAccounts.at(i).serverURI,loadedAccounts.at(i).user,loadedAccounts.at(i).password, loadedAccounts.at(i).FilePlayPath, loadedAccounts.at(i).FileRecordPath, loadedAccounts.at(i).FileRecordRXonly ,loadedAccounts.at(i).fixedJitterBuffer,loadedAccounts.at(i).fixedJitterBufferValue,loadedAccounts.at(i).autoconnectToBuddyUID, loadedAccounts.at(i).autoconnectEnable ,loadedAccounts.at(i).hasDTMFGPIO ,loadedAccounts.at(i).CallHistory, loadedAccounts.at(i).uid);
@@ -197,24 +384,20 @@ void Settings::saveAccConfig()
 {
     if(!m_AccountsLoaded)
         return;
-    QSettings settings("awah", "AWAHsipConfig");
-    settings.setValue("AccountConfig", QVariant::fromValue(*m_lib->m_Accounts->getAccounts()));
-    settings.sync();
+    scheduleSave(AccountsSection);
 }
 
 int Settings::loadAudioRoutes()
 {
+    StartupSpan span(m_lib->m_Startup, "loadAudioRoutes");
     int status = PJ_SUCCESS;
     QList<s_audioRoutes>  loadedRoutes;
-    const QMap<int, QString> srcAudioSlotMap = m_lib->m_AudioRouter->getSrcAudioSlotMap();
-    const QMap<int, QString> destAudioSlotMap = m_lib->m_AudioRouter->getDestAudioSlotMap();
-    QSettings settings("awah", "AWAHsipConfig");
     m_lib->m_AudioRouter->clearAllOfflineAudioRoutes();
-    loadedRoutes = settings.value("AudioRoutes").value<QList<s_audioRoutes>>();
+    loadedRoutes = fromConfigRecords<s_audioRoutes>(configStore()->section("AudioRoutes"));
     m_lib->m_Log->writeLog(3,QString("loadAudioRoutes: loaded routes: ") + QString::number(loadedRoutes.count()));
     for(auto& route : loadedRoutes ){
-        route.srcSlot = srcAudioSlotMap.key(route.srcDevName, -1);
-        route.destSlot = destAudioSlotMap.key(route.destDevName, -1);
+        route.srcSlot = m_lib->m_AudioRouter->getSrcSlotByName(route.srcDevName);
+        route.destSlot = m_lib->m_AudioRouter->getDestSlotByName(route.destDevName);
         if(route.srcSlot >= 0 && route.destSlot >= 0){
             if(route.level < -42){                                             // this check is done to catch old volumes witch where stored in factors not dB!!
                 route.level = -43;
@@ -241,98 +424,73 @@ int Settings::saveAudioRoutes()
 {
     if(!m_AudioRoutesLoaded)
         return PJ_SUCCESS;
-    QList<s_audioRoutes> routesToSave, audioRoutes = m_lib->m_AudioRouter->getAudioRoutes();
+    scheduleSave(AudioRoutesSection);
+    return PJ_SUCCESS;
+}
+
+QList<ConfigRecord> audioRouteRecords(const QList<s_audioRoutes> &audioRoutes, const QList<s_audioRoutes> &offlineRoutes)
+{
+    QList<ConfigRecord> records;
+    QSet<QString> onlineRoutes, savedRoutes;
     for(auto& route : audioRoutes){
-        if(route.persistant){
-            bool routeExists = false;
-            for(auto& savedRoute : routesToSave){                                                               // check if route already exists
-                if(route.destDevName == savedRoute.destDevName && route.srcDevName == savedRoute.srcDevName){
-                    routeExists = true;
-                    break;
-                }
-            }
-            if(!routeExists){
-                routesToSave.append(route);
-            }
+        const QString key = routeKey(route.srcDevName, route.destDevName);
+        onlineRoutes.insert(key);
+        if(route.persistant && !savedRoutes.contains(key)){                        // routes between the same devices are saved once
+            savedRoutes.insert(key);
+            records.append(toConfigRecord(key, route));
         }
     }
-    for(auto& offlineroute : m_lib->m_AudioRouter->getOfflineAudioRoutes()){
-        if(offlineroute.persistant){
-            for(auto& route : audioRoutes){
-                if(route.srcDevName == offlineroute.srcDevName && route.destDevName == offlineroute.destDevName){  // check if the offline route is alredy stored as online route
-                    break;
-                }
-                else{
-                    routesToSave.append(offlineroute);
-                }
-            }
+    for(auto& offlineroute : offlineRoutes){
+        const QString key = routeKey(offlineroute.srcDevName, offlineroute.destDevName);
+        if(offlineroute.persistant && !onlineRoutes.contains(key) && !savedRoutes.contains(key)){    // skip offline routes that are online again
+            savedRoutes.insert(key);
+            records.append(toConfigRecord(key, offlineroute));
         }
     }
-    QSettings settings("awah", "AWAHsipConfig");
-    settings.setValue("AudioRoutes", QVariant::fromValue(routesToSave));
-    settings.sync();
-    return PJ_SUCCESS;
+    return records;
+}
+
+QList<ConfigRecord> Settings::audioRouteRecords()
+{
+    return ::audioRouteRecords(m_lib->m_AudioRouter->getAudioRoutes(), m_lib->m_AudioRouter->getOfflineAudioRoutes());
 }
 
 void Settings::saveCustomSourceNames()
 {
-    QSettings settings("awah", "AWAHsipConfig");
-    settings.remove("CustomSourceNames");
-    settings.beginGroup("CustomSourceNames");
-    QMap<QString,QString> srcLables = m_lib->m_AudioRouter->getCustomSourceLabels();
-    QMap<QString, QString>::const_iterator i = srcLables.constBegin();
-    while (i != srcLables.constEnd()) {
-         settings.setValue(i.key(), i.value());
-         ++i;
-     }
-    settings.endGroup();
-    settings.sync();
+    scheduleSave(SourceNamesSection);
 }
 
 void Settings::loadCustomSourceNames()
 {
-    QSettings settings("awah", "AWAHsipConfig");
-    settings.beginGroup("CustomSourceNames");
+    StartupSpan span(m_lib->m_Startup, "loadCustomSourceNames");
     QMap<QString,QString> srcLables;
-    QStringList keys = settings.childKeys();
-    foreach (QString key, keys) {
-         srcLables[key] = settings.value(key).toString();
+    for (auto & record : configStore()->section("CustomSourceNames")) {
+        QDataStream in(record.second);
+        in >> srcLables[record.first];
     }
-    settings.endGroup();
     m_lib->m_Log->writeLog(3,QString("loadCustomSourceNames: custom source lables loaded"));
     m_lib->m_AudioRouter->setCustomSourceLables(srcLables);
 }
 
 void Settings::saveCustomDestinationNames()
 {
-    QSettings settings("awah", "AWAHsipConfig");
-    settings.remove("CustomDestinationNames");
-    settings.beginGroup("CustomDestinationNames");
-    QMap<QString,QString> dstLables = m_lib->m_AudioRouter->getCustomDestLables();
-    QMap<QString, QString>::const_iterator i = dstLables.constBegin();
-    while (i != dstLables.constEnd()) {
-         settings.setValue(i.key(), i.value());
-         ++i;
-     }
-    settings.endGroup();
-    settings.sync();
+    scheduleSave(DestNamesSection);
 }
 
 void Settings::loadCustomDestinationNames()
 {
-    QSettings settings("awah", "AWAHsipConfig");
-    settings.beginGroup("CustomDestinationNames");
+    StartupSpan span(m_lib->m_Startup, "loadCustomDestinationNames");
     QMap<QString,QString> dstLables;
-    QStringList keys = settings.childKeys();
-    foreach (QString key, keys) {
-         dstLables[key] = settings.value(key).toString();
+    for (auto & record : configStore()->section("CustomDestinationNames")) {
+        QDataStream in(record.second);
+        in >> dstLables[record.first];
     }
-    settings.endGroup();
     m_lib->m_AudioRouter->setCustomDestinationLables(dstLables);
 }
 
 void Settings::loadSettings()                                           // todo check if library is alredy running and restart if true
 {
+    StartupSpan span(m_lib->m_Startup, "loadSettings");
     AccountConfig aCfg;
     QSettings settings("awah", "AWAHsipConfig");
     QJsonObject item, GlobalSettings, AudioSettings, SIPSettings, enumitems;
@@ -524,6 +682,27 @@ void Settings::loadSettings()                                           // todo
     item["type"] = STRING;
     GlobalSettings["Log path:"] = item;
 
+    // ***** structured event log ****
+    item = QJsonObject();
+    item["value"] = settings.value("settings/log/EventLog", 0).toInt();
+    item["type"] = ENUM_INT;
+    item["min"] = 0;
+    item["max"] = 1;
+    enumitems = QJsonObject();
+    enumitems["enabled"] = 1;
+    enumitems["disabled"] = 0;
+    item["enumlist"] = enumitems;
+    GlobalSettings["Event log (needs restart)"] = item;
+
+    // ***** config save delay *****
+    item = QJsonObject();
+    m_saveDelay = settings.value("settings/ConfigSaveDelay", 500).toInt();
+    item["value"] = m_saveDelay;
+    item["type"] = INTEGER;
+    item["min"] = 0;
+    item["max"] = 10000;
+    GlobalSettings["Config save delay in ms"] = item;
+
     // ***** Buddy refresh interval *****
     item = QJsonObject();
     m_lib->m_Buddies->SetMaxPresenceRefreshTime(settings.value("settings/BuddyConfig/maxPresenceRefreshTime","30").toUInt());
@@ -761,6 +940,12 @@ QString Settings::getLogPath()
     return settings.value("settings/log/Path", QDir::current().filePath("logs/")).toString();
 }
 
+bool Settings::getEventLogEnabled()
+{
+    QSettings settings("awah", "AWAHsipConfig");
+    return settings.value("settings/log/EventLog", 0).toBool();
+}
+
 const QJsonObject *Settings::getSettings()
 {
     getMasterClock();                       // this appends the MasterClock field to the settings.
@@ -865,6 +1050,15 @@ void Settings::setSettings(QJsonObject editedSettings)
              settings.setValue("settings/log/Path",it.value().toString());
         }
 
+        if (it.key() == "Event log (needs restart)"){
+             settings.setValue("settings/log/EventLog",it.value().toInt());
+        }
+
+        if (it.key() == "Config save delay in ms"){
+             settings.setValue("settings/ConfigSaveDelay",it.value().toInt());
+             m_saveDelay = it.value().toInt();
+        }
+
         if (it.key() == "Account session timer expiration"){
             settings.setValue("settings/AcccountConfig/timersSesExpire", it.value().toInt());
         }
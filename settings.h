@@ -20,15 +20,43 @@
 #define SETTINGS_H
 
 #include <QObject>
+#include <QTimer>
+#include <QThread>
 #include "types.h"
+#include "configstore.h"
 
 class AWAHSipLib;
 
+/**
+ * @brief build the config records of the persistent audio routes
+ * @details routes between the same devices are saved once, offline routes are skipped if the route is online again
+ * @param audioRoutes the online routes, AudioRouter::getAudioRoutes()
+ * @param offlineRoutes AudioRouter::getOfflineAudioRoutes()
+ * @return the records of the AudioRoutes section
+ */
+QList<ConfigRecord> audioRouteRecords(const QList<s_audioRoutes> &audioRoutes, const QList<s_audioRoutes> &offlineRoutes);
+
+/**
+ * @brief config sections, the saves of each section are coalesced
+ */
+enum configSection{
+    IODevSection = 0x01,
+    GpioDevSection = 0x02,
+    GpioRoutesSection = 0x04,
+    BuddiesSection = 0x08,
+    AccountsSection = 0x10,
+    AudioRoutesSection = 0x20,
+    SourceNamesSection = 0x40,
+    DestNamesSection = 0x80,
+    AllSections = 0xff
+};
+
 class Settings : public QObject
 {
     Q_OBJECT
 public:
     explicit Settings(AWAHSipLib *parentLib, QObject *parent = nullptr);
+    ~Settings();
 
     /**
     * @brief Load IO device config (audio interfaces, tone generator, GPIO etc) from settings file
@@ -42,7 +70,8 @@ public:
     void saveIODevConfig();
 
     /**
-    * @brief load current GPIO device config from the settings file
+    * @brief load current GPIO device config from the settings file and the GPIO routes
+    * @details the startup runs it once the accounts and audio routes are loaded, the devices connect to them
     */
     void loadGpioDevConfig();
 
@@ -66,6 +95,12 @@ public:
     */
     void loadSettings();
 
+    /**
+    * @brief open the config journal (and import the old config on the first start)
+    * @details the startup runs it on a worker thread, it must be done before the first load* function is called
+    */
+    void openConfigStore();
+
     /**
     * @brief load current account config from settings file
     */
@@ -112,6 +147,12 @@ public:
     */
     QString getLogPath();
 
+    /**
+    * @brief check if the structured event log is enabled
+    * @return true if the log entries are also written to the event log
+    */
+    bool getEventLogEnabled();
+
     /**
     * @brief get all editable general settings
     * @return a QJsonObject with an Object for each setting category. Each setting in a category is a new
@@ -145,6 +186,18 @@ public:
     */
     QString getMasterClock();
 
+    /**
+    * @brief write the pending changes now and wait until they are in the config journal
+    * @param sections the sections to write, an OR of configSection
+    */
+    void flush(int sections = AllSections);
+
+    /**
+    * @brief write the pending changes of the sections and stop the persistence thread, later changes are not saved
+    * @details used on shutdown, only sections whose managers still exist may be passed
+    */
+    void stopPersistence(int sections = AllSections);
+
 public slots:
     /**
     * @brief save current GPIO device config to the settings file
@@ -171,6 +224,28 @@ private:
     */
     QJsonObject m_settings;
 
+    /**
+    * @brief journal of the config lists, opened on first use
+    * @details on the first start the lists are imported from the QSettings file
+    */
+    ConfigStore* configStore();
+    void importConfigStore();
+    ConfigStore *m_configStore = nullptr;
+
+    /**
+    * @brief mark a section as changed, the changes within the "Config save delay" are written together
+    * @details the records are taken on the main thread and written to the journal by the persistence thread
+    */
+    void scheduleSave(int section);
+    void writeSections(int sections);
+    QList<ConfigRecord> audioRouteRecords();
+    QTimer m_saveTimer;
+    int m_saveDelay = 500;                          // ms
+    int m_dirtySections = 0;
+    bool m_persistenceStopped = false;
+    QThread m_persistThread;
+    QObject *m_persistContext;
+
     bool m_AccountsLoaded = false;
     bool m_IoDevicesLoaded = false;
     bool m_AudioRoutesLoaded = false;
@@ -178,9 +253,6 @@ private:
     bool m_GpioRoutesLoaded = false;
     bool m_BuddiesLoaded = false;
 
-private slots:
-    void loadIODevConfigLater();
-
 };
 
 #endif // SETTINGS_H
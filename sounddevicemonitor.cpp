@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "sounddevicemonitor.h"
+#include "awahsiplib.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QRegularExpression>
+#include <QTimer>
+
+SoundDeviceMonitor::SoundDeviceMonitor(AWAHSipLib *parentLib, QObject *parent) : QObject(parent), m_lib(parentLib)
+{
+    m_watcher = new QFileSystemWatcher(this);
+    m_settleTimer = new QTimer(this);
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(SOUNDMONITOR_SETTLE_MS);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &SoundDeviceMonitor::devDirChanged);
+    connect(m_settleTimer, &QTimer::timeout, this, &SoundDeviceMonitor::rescan);
+    m_watching = QFileInfo(SOUNDMONITOR_DEV_DIR).isDir() && m_watcher->addPath(SOUNDMONITOR_DEV_DIR);
+    m_cards = scanCards();
+}
+
+s_soundCard SoundDeviceMonitor::cardOfDevice(const QString &deviceName)
+{
+    static const QRegularExpression cardId("CARD=([^,]+)");
+    static const QRegularExpression cardIndex("hw:(\\d+)");
+    const QMap<QString, s_soundCard> cards = scanCards();
+    QRegularExpressionMatch match = cardId.match(deviceName);
+    if(match.hasMatch()){
+        for(const auto& card : cards){
+            if(card.id == match.captured(1))
+                return card;
+        }
+        return s_soundCard();
+    }
+    match = cardIndex.match(deviceName);
+    if(match.hasMatch()){
+        for(const auto& card : cards){
+            if(card.index == match.captured(1).toInt())
+                return card;
+        }
+    }
+    return s_soundCard();
+}
+
+s_soundCard SoundDeviceMonitor::cardOfStored(const s_soundCard &stored)
+{
+    const QMap<QString, s_soundCard> cards = scanCards();
+    if(!stored.usbId.isEmpty() || stored.busPath.isEmpty())
+        return cards.value(stored.identity());
+    for(const auto& card : cards){
+        if(card.busPath == stored.busPath)
+            return card;
+    }
+    return s_soundCard();
+}
+
+QString SoundDeviceMonitor::deviceNameOnCard(const QString &deviceName, const s_soundCard &card)
+{
+    QString name = deviceName;
+    name.replace(QRegularExpression("CARD=[^,]+"), "CARD=" + card.id);
+    name.replace(QRegularExpression("hw:\\d+"), "hw:" + QString::number(card.index));
+    return name;
+}
+
+void SoundDeviceMonitor::devDirChanged()
+{
+    m_settleTimer->start();
+}
+
+void SoundDeviceMonitor::rescan()
+{
+    QMap<QString, s_soundCard> cards = scanCards();
+    QStringList added, removed;
+    for(const auto& identity : cards.keys()){
+        if(!m_cards.contains(identity))
+            added.append(identity);
+    }
+    for(const auto& identity : m_cards.keys()){
+        if(!cards.contains(identity))
+            removed.append(identity);
+    }
+    m_cards = cards;
+    if(added.isEmpty() && removed.isEmpty())
+        return;
+    for(const auto& identity : removed)
+        m_lib->m_Log->writeLog(3, "SoundDeviceMonitor: sound card removed: " + identity);
+    for(const auto& identity : added)
+        m_lib->m_Log->writeLog(3, "SoundDeviceMonitor: sound card added: " + m_cards[identity].id + " at " + identity);
+    emit cardsChanged(added, removed);
+}
+
+QString SoundDeviceMonitor::usbIdOfDevice(const QString &devicePath)
+{
+    // the card is an interface of the USB device, idVendor, idProduct and serial are in the device directory above it
+    QDir dir(devicePath);
+    for(int level = 0; level < 3; level++){
+        QFile vendor(dir.filePath("idVendor"));
+        if(vendor.open(QIODevice::ReadOnly)){
+            QString usbId = QString::fromLatin1(vendor.readAll()).trimmed();
+            QFile product(dir.filePath("idProduct"));
+            if(product.open(QIODevice::ReadOnly))
+                usbId += ":" + QString::fromLatin1(product.readAll()).trimmed();
+            QFile serial(dir.filePath("serial"));                  // not every device has one
+            if(serial.open(QIODevice::ReadOnly))
+                usbId += ":" + QString::fromLatin1(serial.readAll()).trimmed();
+            return usbId;
+        }
+        if(!dir.cdUp())
+            break;
+    }
+    return QString();
+}
+
+QMap<QString, s_soundCard> SoundDeviceMonitor::scanCards()
+{
+    QMap<QString, s_soundCard> cards;
+    static const QRegularExpression cardDir("^card(\\d+)$");
+    const QStringList entries = QDir("/proc/asound").entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for(const auto& entry : entries){
+        QRegularExpressionMatch match = cardDir.match(entry);
+        if(!match.hasMatch())
+            continue;
+        s_soundCard card;
+        card.index = match.captured(1).toInt();
+        QFile idFile("/proc/asound/" + entry + "/id");
+        if(idFile.open(QIODevice::ReadOnly))
+            card.id = QString::fromLatin1(idFile.readAll()).trimmed();
+        const QString devices = "/sys/devices/";
+        QString device = QFileInfo("/sys/class/sound/" + entry + "/device").canonicalFilePath();
+        if(device.startsWith(devices)){
+            card.busPath = device.mid(devices.length());
+            card.usbId = usbIdOfDevice(device);
+        }
+        cards[card.identity()] = card;
+    }
+    return cards;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SOUNDDEVICEMONITOR_H
+#define SOUNDDEVICEMONITOR_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QJsonObject>
+
+class AWAHSipLib;
+class QFileSystemWatcher;
+class QTimer;
+
+#define SOUNDMONITOR_DEV_DIR "/dev/snd"
+#define SOUNDMONITOR_SETTLE_MS 500          // a card creates and removes several device nodes, wait until it is done
+
+/**
+ * @brief A sound card as the kernel sees it
+ * @details the card index and id are given in plug order, two equal USB interfaces get a different id depending
+ * on which one was plugged first. The bus path (the sysfs device of the card) stays the same as long as the card
+ * is plugged into the same port, so it is the identity of a card if there is one. The USB vendor, product and serial
+ * are part of the identity, so another interface plugged into the same port is a different card.
+ */
+struct s_soundCard{
+    int index = -1;                         // the N of hw:N
+    QString id;                             // the CARD= of ALSA device names
+    QString busPath;                        // sysfs device path below /sys/devices, e.g. the USB port
+    QString usbId;                          // idVendor:idProduct:serial of a USB card, empty for other cards
+    bool isValid() const { return index >= 0; };
+    QString identity() const { return busPath.isEmpty() ? "id:" + id : usbId.isEmpty() ? busPath : busPath + "#" + usbId; };
+    QJsonObject toJSON() const {
+        return {{"index", index}, {"id", id}, {"busPath", busPath}, {"usbId", usbId}};
+    };
+    s_soundCard* fromJSON(const QJsonObject &soundCardJSON) {
+        index = soundCardJSON["index"].toInt(-1);
+        id = soundCardJSON["id"].toString();
+        busPath = soundCardJSON["busPath"].toString();
+        usbId = soundCardJSON["usbId"].toString();
+        return this;
+    };
+};
+
+/**
+ * @brief Watches the ALSA device nodes and reports sound cards that are plugged or unplugged
+ * @details /dev/snd is watched with inotify (QFileSystemWatcher), changes are collected for SOUNDMONITOR_SETTLE_MS
+ * and then the cards in /proc/asound and /sys/class/sound are compared with the last scan by their identity.
+ * On systems without /dev/snd isWatching() is false and the caller has to poll.
+ */
+class SoundDeviceMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SoundDeviceMonitor(AWAHSipLib *parentLib, QObject *parent = nullptr);
+
+    bool isWatching() const { return m_watching; };
+
+    /**
+     * @brief the card an audio device name of pjmedia belongs to
+     * @param deviceName e.g. "hw:CARD=Device,DEV=0", "sysdefault:CARD=Device" or "hw:1,0"
+     * @return an invalid card for devices not bound to a card (default, pulse, ...)
+     */
+    static s_soundCard cardOfDevice(const QString &deviceName);
+
+    /**
+     * @brief the card that is plugged now for a card stored in the settings
+     * @details cards stored without an usbId are matched by their bus path only
+     * @return an invalid card if there is none
+     */
+    static s_soundCard cardOfStored(const s_soundCard &stored);
+
+    /**
+     * @brief the name the same audio device has on a card that got a new index or id
+     */
+    static QString deviceNameOnCard(const QString &deviceName, const s_soundCard &card);
+
+signals:
+    /**
+     * @brief sound cards were plugged or unplugged
+     * @param added identities of the new cards
+     * @param removed identities of the cards that are gone
+     */
+    void cardsChanged(QStringList added, QStringList removed);
+
+private slots:
+    void devDirChanged();
+    void rescan();
+
+private:
+    static QMap<QString, s_soundCard> scanCards();
+    static QString usbIdOfDevice(const QString &devicePath);
+
+    AWAHSipLib* m_lib;
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_settleTimer;
+    QMap<QString, s_soundCard> m_cards;
+    bool m_watching = false;
+};
+
+#endif // SOUNDDEVICEMONITOR_H
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "startuporchestrator.h"
+#include "awahsiplib.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QPair>
+#include <QJsonArray>
+
+QJsonObject s_startupStage::toJSON() const
+{
+    static const char *stateNames[] = {"pending", "running", "done", "failed", "skipped"};
+    QJsonObject stageObj;
+    stageObj["name"] = name;
+    stageObj["state"] = stateNames[stageState];
+    stageObj["concurrent"] = concurrent;
+    stageObj["startMs"] = startNs / 1000000.0;
+    stageObj["durationMs"] = (endNs - startNs) / 1000000.0;
+    if (!error.isEmpty())
+        stageObj["error"] = error;
+    return stageObj;
+}
+
+QJsonObject s_startupSpan::toJSON() const
+{
+    QJsonObject spanObj;
+    spanObj["name"] = name;
+    spanObj["startMs"] = startNs / 1000000.0;
+    spanObj["durationMs"] = (endNs - startNs) / 1000000.0;
+    return spanObj;
+}
+
+StartupOrchestrator::StartupOrchestrator(AWAHSipLib *parentLib, QObject *parent) : QObject(parent), m_lib(parentLib)
+{
+    m_clock.start();
+}
+
+QJsonObject StartupOrchestrator::trace() const
+{
+    QJsonObject traceObj;
+    QJsonArray stagesArr, spansArr;
+    for (auto & stage : m_stages) {
+        stagesArr.append(stage.toJSON());
+    }
+    QMutexLocker locker(&m_spanMutex);
+    for (auto & span : m_spans) {
+        spansArr.append(span.toJSON());
+    }
+    traceObj["totalMs"] = m_elapsedNs / 1000000.0;
+    traceObj["running"] = isRunning();
+    traceObj["stages"] = stagesArr;
+    traceObj["spans"] = spansArr;
+    return traceObj;
+}
+
+void StartupOrchestrator::addSpan(const QString &name, qint64 startNs, qint64 endNs)
+{
+    QMutexLocker locker(&m_spanMutex);
+    if (!m_running.loadAcquire())
+        return;
+    s_startupSpan span;
+    span.name = name;
+    span.startNs = startNs;
+    span.endNs = endNs;
+    m_spans.append(span);
+}
+
+StartupSpan::StartupSpan(StartupOrchestrator *startup, const QString &name) : m_startup(startup)
+{
+    if (!m_startup || !m_startup->isRunning()) {
+        m_startup = nullptr;
+        return;
+    }
+    m_name = name;
+    m_startNs = m_startup->nsecsElapsed();
+}
+
+StartupSpan::~StartupSpan()
+{
+    if (m_startup)
+        m_startup->addSpan(m_name, m_startNs, m_startup->nsecsElapsed());
+}
+
+void StartupOrchestrator::addStage(const QString &name, const QStringList &dependencies, std::function<void ()> run, bool concurrent)
+{
+    s_startupStage stage;
+    stage.name = name;
+    stage.dependencies = dependencies;
+    stage.run = run;
+    stage.concurrent = concurrent;
+    m_stages.append(stage);
+}
+
+int StartupOrchestrator::indexOf(const QString &name) const
+{
+    for (int i = 0; i < m_stages.count(); i++) {
+        if (m_stages.at(i).name == name)
+            return i;
+    }
+    return -1;
+}
+
+bool StartupOrchestrator::runStage(s_startupStage &stage)
+{
+    try{
+        stage.run();
+    }
+    catch (Error &err){
+        stage.error = QString::fromStdString(err.info());
+    }
+    catch (std::exception &err){
+        stage.error = err.what();
+    }
+    return stage.error.isEmpty();
+}
+
+bool StartupOrchestrator::run()
+{
+    QMutex mutex;
+    QWaitCondition stageFinished;
+    QList<QPair<int, qint64>> finishedStages;        // concurrent stages that are finished, with their end time
+    int running = 0;
+    int remaining = m_stages.count();
+    bool ok = true;
+
+    m_running.storeRelease(1);
+    while (remaining > 0) {
+        bool progressed = false;
+        for (int i = 0; i < m_stages.count(); i++) {
+            s_startupStage &stage = m_stages[i];
+            if (stage.stageState != s_startupStage::Pending)
+                continue;
+            bool ready = true;
+            bool blocked = false;
+            for (auto & dependency : stage.dependencies) {
+                int dep = indexOf(dependency);
+                if (dep < 0 || m_stages.at(dep).stageState == s_startupStage::Failed || m_stages.at(dep).stageState == s_startupStage::Skipped)
+                    blocked = true;
+                else if (m_stages.at(dep).stageState != s_startupStage::Done)
+                    ready = false;
+            }
+            if (blocked) {
+                stage.stageState = s_startupStage::Skipped;
+                remaining--;
+                progressed = true;
+                ok = false;
+                continue;
+            }
+            if (!ready)
+                continue;
+
+            stage.stageState = s_startupStage::Running;
+            stage.startNs = m_clock.nsecsElapsed();
+            progressed = true;
+            if (stage.concurrent) {
+                // the worker only touches its own stage, the main thread doesn't read it until it is collected below
+                s_startupStage *workerStage = &stage;
+                running++;
+                QThreadPool::globalInstance()->start([this, workerStage, i, &mutex, &stageFinished, &finishedStages]() {
+                    runStage(*workerStage);
+                    QMutexLocker locker(&mutex);
+                    finishedStages.append(qMakePair(i, m_clock.nsecsElapsed()));
+                    stageFinished.wakeAll();
+                });
+            }
+            else {
+                bool stageOk = runStage(stage);
+                stage.endNs = m_clock.nsecsElapsed();
+                stage.stageState = stageOk ? s_startupStage::Done : s_startupStage::Failed;
+                ok &= stageOk;
+                remaining--;
+            }
+        }
+
+        QMutexLocker locker(&mutex);
+        if (!progressed && finishedStages.isEmpty()) {
+            if (!running)
+                break;                                      // dependency cycle, the remaining stages can never run
+            stageFinished.wait(&mutex);
+        }
+        for (auto & finishedStage : finishedStages) {
+            s_startupStage &stage = m_stages[finishedStage.first];
+            stage.endNs = finishedStage.second;
+            stage.stageState = stage.error.isEmpty() ? s_startupStage::Done : s_startupStage::Failed;
+            ok &= stage.error.isEmpty();
+            running--;
+            remaining--;
+        }
+        finishedStages.clear();
+    }
+    m_spanMutex.lock();
+    m_elapsedNs = m_clock.nsecsElapsed();
+    m_running.storeRelease(0);
+    m_spanMutex.unlock();
+
+    for (auto & stage : m_stages) {
+        if (stage.stageState == s_startupStage::Pending) {
+            stage.stageState = s_startupStage::Skipped;
+            ok = false;
+        }
+        if (!m_lib->m_Log)
+            continue;
+        switch (stage.stageState) {
+        case s_startupStage::Done:
+            AWAHLOG(m_lib->m_Log, 3, QString("Startup: %1 done in %2 ms%3").arg(stage.name).arg((stage.endNs - stage.startNs) / 1000000.0, 0, 'f', 1).arg(stage.concurrent ? " (concurrent)" : ""));
+            break;
+        case s_startupStage::Failed:
+            m_lib->m_Log->writeLog(1, QString("Startup: %1 failed: %2").arg(stage.name, stage.error));
+            break;
+        default:
+            m_lib->m_Log->writeLog(1, QString("Startup: %1 skipped, a stage it depends on failed").arg(stage.name));
+            break;
+        }
+    }
+    if (m_lib->m_Log)
+        m_lib->m_Log->writeLog(3, QString("Startup: finished in %1 ms").arg(m_elapsedNs / 1000000.0, 0, 'f', 1));
+    emit finished(ok);
+    return ok;
+}
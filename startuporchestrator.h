@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef STARTUPORCHESTRATOR_H
+#define STARTUPORCHESTRATOR_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QAtomicInteger>
+#include <functional>
+
+class AWAHSipLib;
+
+/**
+ * @brief A startup stage and its result
+ */
+struct s_startupStage{
+    enum state {Pending, Running, Done, Failed, Skipped};
+    QString name;
+    QStringList dependencies;
+    std::function<void()> run;
+    bool concurrent = false;        // the stage runs on a worker thread
+    state stageState = Pending;
+    qint64 startNs = 0;             // relative to the start of the startup
+    qint64 endNs = 0;
+    QString error;
+    QJsonObject toJSON() const;
+};
+
+/**
+ * @brief A timed step within a startup stage, e.g. opening one sound device
+ */
+struct s_startupSpan{
+    QString name;
+    qint64 startNs = 0;             // relative to the start of the startup
+    qint64 endNs = 0;
+    QJsonObject toJSON() const;
+};
+
+/**
+ * @brief Runs the startup of the library as a graph of stages
+ * @details every stage runs as soon as all stages it depends on are done. Concurrent stages run on the
+ * global thread pool while the main thread continues with the other ready stages. Only stages that
+ * don't use pjsua and don't touch the managers may be concurrent, pjsua and the conference bridge
+ * stay on the thread that created the library. A stage that throws fails, the stages depending
+ * on it are skipped. The time of every stage is logged when the startup is finished.
+ * All times are taken from one monotonic clock started with the orchestrator, StartupSpan adds
+ * the steps within the stages to the trace.
+ */
+class StartupOrchestrator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StartupOrchestrator(AWAHSipLib *parentLib, QObject *parent = nullptr);
+
+    /**
+     * @brief add a stage, stages must be added before run()
+     * @param name unique name of the stage
+     * @param dependencies names of the stages that must be done before this stage
+     * @param run the work of the stage
+     * @param concurrent true if the stage may run on a worker thread
+     */
+    void addStage(const QString &name, const QStringList &dependencies, std::function<void()> run, bool concurrent = false);
+
+    /**
+     * @brief run all stages and wait until they are finished
+     * @return true if all stages are done
+     */
+    bool run();
+
+    const QList<s_startupStage>& stages() const { return m_stages; };
+    qint64 elapsedMs() const { return m_elapsedNs / 1000000; };
+
+    /**
+     * @brief the stages and spans with their start time and duration
+     * @return JSON object with totalMs, stages and spans
+     */
+    QJsonObject trace() const;
+
+    /**
+     * @brief add a span to the trace, ignored once the startup is finished. Thread safe
+     */
+    void addSpan(const QString &name, qint64 startNs, qint64 endNs);
+    bool isRunning() const { return m_running.loadAcquire(); };
+    qint64 nsecsElapsed() const { return m_clock.nsecsElapsed(); };
+
+signals:
+    /**
+    * @brief Signal when all stages are finished
+    * @param ok true if all stages are done
+    */
+    void finished(bool ok);
+
+private:
+    int indexOf(const QString &name) const;
+    bool runStage(s_startupStage &stage);
+
+    AWAHSipLib* m_lib;
+    QList<s_startupStage> m_stages;
+    QElapsedTimer m_clock;
+    qint64 m_elapsedNs = 0;
+    QAtomicInteger<int> m_running = 0;              // read by StartupSpan on the worker threads
+    mutable QMutex m_spanMutex;
+    QList<s_startupSpan> m_spans;
+};
+
+/**
+ * @brief Adds the time from its construction to its destruction as span to the startup trace
+ * @details does nothing if there is no startup running, so it can stay in functions used after the startup
+ */
+class StartupSpan
+{
+public:
+    StartupSpan(StartupOrchestrator *startup, const QString &name);
+    ~StartupSpan();
+
+private:
+    StartupOrchestrator *m_startup;
+    QString m_name;
+    qint64 m_startNs = 0;
+};
+
+#endif // STARTUPORCHESTRATOR_H
@@ -0,0 +1,59 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <QCoreApplication>
+#include <QtTest>
+#include "tst_audiokernels.h"
+#include "tst_multichanneladapter.h"
+#include "tst_settings.h"
+#include "tst_startup.h"
+#include "tst_types.h"
+
+/**
+ * runs all test classes, the arguments are passed to each of them
+ * "-bench" runs only the benchmarks, "-nobench" skips them
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    bool benchOnly = args.removeAll("-bench") > 0;
+    bool noBench = args.removeAll("-nobench") > 0;
+    QList<QObject*> tests;
+    tests << new TestAudioKernels() << new TestMultichannelAdapter() << new TestSettings() << new TestStartup() << new TestTypes();
+    int status = 0;
+    for (auto test : tests) {
+        QStringList testArgs = args;
+        if (benchOnly || noBench) {                     // select the functions by name, benchmarks start with "bench"
+            const QMetaObject *meta = test->metaObject();
+            for (int i = meta->methodOffset(); i < meta->methodCount(); i++) {
+                const QMetaMethod method = meta->method(i);
+                const QString name = QString::fromLatin1(method.name());
+                if (method.methodType() == QMetaMethod::Slot && !name.endsWith("_data")
+                        && !name.startsWith("init") && !name.startsWith("cleanup")
+                        && name.startsWith("bench") == benchOnly)
+                    testArgs << name;
+            }
+            if (testArgs.size() == args.size())
+                continue;
+        }
+        status |= QTest::qExec(test, testArgs);
+    }
+    qDeleteAll(tests);
+    return status;
+}
@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+#   AWAHSip Library Tests and Benchmarks
+#   qmake tests.pro && make && ./awahsiplib_tests
+#   run the benchmarks only: ./awahsiplib_tests -bench
+#
+#-------------------------------------------------
+
+QT       += core gui network testlib
+
+TARGET = awahsiplib_tests
+TEMPLATE = app
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/..
+
+include(../awahsiplib.pri)
+
+SOURCES += \
+    $$PWD/main.cpp \
+    $$PWD/tst_audiokernels.cpp \
+    $$PWD/tst_multichanneladapter.cpp \
+    $$PWD/tst_settings.cpp \
+    $$PWD/tst_startup.cpp \
+    $$PWD/tst_types.cpp
+
+HEADERS += \
+    $$PWD/tst_audiokernels.h \
+    $$PWD/tst_multichanneladapter.h \
+    $$PWD/tst_settings.h \
+    $$PWD/tst_startup.h \
+    $$PWD/tst_types.h
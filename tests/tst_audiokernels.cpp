@@ -0,0 +1,178 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "tst_audiokernels.h"
+#include "audiokernels.h"
+#include <QtTest>
+#include <QVector>
+
+#define TST_BENCHSAMPLES 960            // samples per channel of a benchmark block, 20 ms at 48 kHz
+#define TST_BENCHBLOCKS 2000
+
+// the plain loops, the reference for the tests and the benchmarks
+static void scalarDeinterleave(qint16 *const *dst, const qint16 *src, unsigned channels, unsigned samplesPerChannel)
+{
+    for (unsigned ch = 0; ch < channels; ch++) {
+        for (unsigned i = 0; i < samplesPerChannel; i++) {
+            dst[ch][i] = src[i * channels + ch];
+        }
+    }
+}
+
+static void scalarInterleave(qint16 *dst, const qint16 *const *src, unsigned channels, unsigned samplesPerChannel)
+{
+    for (unsigned ch = 0; ch < channels; ch++) {
+        for (unsigned i = 0; i < samplesPerChannel; i++) {
+            dst[i * channels + ch] = src[ch] ? src[ch][i] : 0;
+        }
+    }
+}
+
+static QVector<qint16> noise(int count)
+{
+    QVector<qint16> samples(count);
+    for (auto & sample : samples) {
+        sample = qint16(QRandomGenerator::global()->generate());
+    }
+    return samples;
+}
+
+static void addSizes()
+{
+    QTest::addColumn<int>("channels");
+    QTest::addColumn<int>("samples");
+    for (int channels : {1, 2, 3, 8, 24, 64}) {
+        for (int samples : {0, 7, 160, 161}) {                  // with and without a tail for the scalar loop
+            QTest::addRow("%d channels, %d samples", channels, samples) << channels << samples;
+        }
+    }
+}
+
+void TestAudioKernels::deinterleave_data()
+{
+    addSizes();
+}
+
+void TestAudioKernels::deinterleave()
+{
+    QFETCH(int, channels);
+    QFETCH(int, samples);
+    const QVector<qint16> src = noise(channels * samples);
+    QVector<QVector<qint16>> out(channels, QVector<qint16>(samples + 1, 1)), expected(channels, QVector<qint16>(samples + 1, 1));
+    QVector<qint16*> outPtrs, expectedPtrs;
+    for (int ch = 0; ch < channels; ch++) {
+        outPtrs.append(out[ch].data());
+        expectedPtrs.append(expected[ch].data());
+    }
+    AudioKernels::deinterleave(outPtrs.data(), src.constData(), channels, samples);
+    scalarDeinterleave(expectedPtrs.data(), src.constData(), channels, samples);
+    QCOMPARE(out, expected);                                    // also checks that nothing is written past the end
+}
+
+void TestAudioKernels::interleave_data()
+{
+    addSizes();
+}
+
+void TestAudioKernels::interleave()
+{
+    QFETCH(int, channels);
+    QFETCH(int, samples);
+    QVector<QVector<qint16>> in;
+    QVector<const qint16*> inPtrs;
+    for (int ch = 0; ch < channels; ch++) {
+        in.append(noise(samples));
+        inPtrs.append(ch % 5 == 3 ? nullptr : in.last().constData());  // silent channels
+    }
+    QVector<qint16> out(channels * samples + 1, 1), expected(channels * samples + 1, 1);
+    AudioKernels::interleave(out.data(), inPtrs.constData(), channels, samples);
+    scalarInterleave(expected.data(), inPtrs.constData(), channels, samples);
+    QCOMPARE(out, expected);
+}
+
+static void addBenchSizes()
+{
+    QTest::addColumn<int>("channels");
+    QTest::addColumn<bool>("scalar");
+    for (int channels : {2, 8, 32, 64}) {
+        QTest::addRow("%d channels, %s", channels, AudioKernels::instructionSet()) << channels << false;
+        QTest::addRow("%d channels, scalar loop", channels) << channels << true;
+    }
+}
+
+static void reportSamplesPerSecond(qint64 samples, qint64 nsecs)
+{
+    qInfo("%.1f Msamples/s", samples * 1000.0 / qMax(nsecs, qint64(1)));
+}
+
+void TestAudioKernels::benchDeinterleave_data()
+{
+    addBenchSizes();
+}
+
+void TestAudioKernels::benchDeinterleave()
+{
+    QFETCH(int, channels);
+    QFETCH(bool, scalar);
+    const QVector<qint16> src = noise(channels * TST_BENCHSAMPLES);
+    QVector<QVector<qint16>> out(channels, QVector<qint16>(TST_BENCHSAMPLES));
+    QVector<qint16*> outPtrs;
+    for (auto & buffer : out) {
+        outPtrs.append(buffer.data());
+    }
+    QElapsedTimer timer;
+    QBENCHMARK_ONCE {
+        timer.start();
+        for (int block = 0; block < TST_BENCHBLOCKS; block++) {
+            if (scalar)
+                scalarDeinterleave(outPtrs.data(), src.constData(), channels, TST_BENCHSAMPLES);
+            else
+                AudioKernels::deinterleave(outPtrs.data(), src.constData(), channels, TST_BENCHSAMPLES);
+        }
+    }
+    reportSamplesPerSecond(qint64(TST_BENCHBLOCKS) * channels * TST_BENCHSAMPLES, timer.nsecsElapsed());
+}
+
+void TestAudioKernels::benchInterleave_data()
+{
+    addBenchSizes();
+}
+
+void TestAudioKernels::benchInterleave()
+{
+    QFETCH(int, channels);
+    QFETCH(bool, scalar);
+    QVector<QVector<qint16>> in;
+    QVector<const qint16*> inPtrs;
+    for (int ch = 0; ch < channels; ch++) {
+        in.append(noise(TST_BENCHSAMPLES));
+        inPtrs.append(in.last().constData());
+    }
+    QVector<qint16> out(channels * TST_BENCHSAMPLES);
+    QElapsedTimer timer;
+    QBENCHMARK_ONCE {
+        timer.start();
+        for (int block = 0; block < TST_BENCHBLOCKS; block++) {
+            if (scalar)
+                scalarInterleave(out.data(), inPtrs.constData(), channels, TST_BENCHSAMPLES);
+            else
+                AudioKernels::interleave(out.data(), inPtrs.constData(), channels, TST_BENCHSAMPLES);
+        }
+    }
+    reportSamplesPerSecond(qint64(TST_BENCHBLOCKS) * channels * TST_BENCHSAMPLES, timer.nsecsElapsed());
+}
@@ -0,0 +1,259 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "tst_multichanneladapter.h"
+#include "multichanneladapter.h"
+#include <QtTest>
+#include <QRandomGenerator>
+#include <QVector>
+#include <cmath>
+
+#define TST_CLOCKRATE 48000
+#define TST_SAMPLES 960                 // samples per channel of a frame, 20 ms
+#define TST_TICKS 500
+#define TST_DRIFT_SECONDS 480           // simulated run time of the drift test
+#define TST_DRIFT_SETTLED 240           // the drift estimates have converged after this time
+#define TST_DRIFT_TOLERANCE 10.0        // ppm
+#define TST_DRIFT_JITTER 4000           // scheduling jitter of the bridge and the sound devices in us
+
+namespace {
+
+qint64 s_simulatedUs = 0;
+
+/**
+ * the adapter on a simulated clock, the drift test runs the bridge and two sound devices in simulated time
+ */
+class SimulatedAdapter : public MultichannelAdapter
+{
+public:
+    using MultichannelAdapter::MultichannelAdapter;
+
+protected:
+    qint64 nowUs() const override { return s_simulatedUs; };
+};
+
+}
+
+void TestMultichannelAdapter::initTestCase()
+{
+    QCOMPARE(pj_init(), PJ_SUCCESS);
+    pj_caching_pool_init(&m_cachingPool, nullptr, 0);
+    m_pool = pj_pool_create(&m_cachingPool.factory, "tst_mcadapter", 4096, 4096, nullptr);
+    QVERIFY(m_pool);
+}
+
+void TestMultichannelAdapter::cleanupTestCase()
+{
+    pj_pool_release(m_pool);
+    pj_caching_pool_destroy(&m_cachingPool);
+    pj_shutdown();
+}
+
+void TestMultichannelAdapter::driftTwoDevices_data()
+{
+    QTest::addColumn<double>("ppmA");
+    QTest::addColumn<double>("ppmB");
+    QTest::newRow("+100 / -250 ppm") << 100.0 << -250.0;
+    QTest::newRow("-80 / +40 ppm") << -80.0 << 40.0;
+}
+
+/**
+ * two sound devices with clocks off by ppmA and ppmB against the bridge, the bridge routes channel 0 of device A to
+ * channel 0 of device B. Device A captures a 1 kHz sine: once the drift control has settled the estimates match the
+ * simulated offsets and device B plays the sine without gaps or discontinuities
+ */
+void TestMultichannelAdapter::driftTwoDevices()
+{
+    QFETCH(double, ppmA);
+    QFETCH(double, ppmB);
+    const unsigned channels = 2;
+    const double period = 1e6 * TST_SAMPLES / TST_CLOCKRATE;
+    const double periodA = period / (1.0 + ppmA * 1e-6);
+    const double periodB = period / (1.0 + ppmB * 1e-6);
+    SimulatedAdapter adapterA(TST_CLOCKRATE, channels, TST_SAMPLES), adapterB(TST_CLOCKRATE, channels, TST_SAMPLES);
+    QRandomGenerator random(3);
+    s_simulatedUs = 0;
+
+    QVector<qint16> captured(channels * TST_SAMPLES), played(channels * TST_SAMPLES), silence(channels * TST_SAMPLES);
+    QVector<qint16> channelBuf(TST_SAMPLES);
+    pjmedia_frame frame;
+    qint64 tickBridge = 0, tickA = 0, tickB = 0;
+    double jitterBridge = 0, jitterA = 0, jitterB = 0;
+    double sinePhase = 0, lastSample = 0;
+    int silentFrames = 0, jumps = 0, playedFrames = 0;
+    qint64 nextCheckUs = qint64(TST_DRIFT_SETTLED) * 1000000;
+    while (true) {
+        double timeBridge = tickBridge * period + jitterBridge;
+        double timeA = 3100 + tickA * periodA + jitterA;            // the devices start a bit after the bridge
+        double timeB = 7700 + tickB * periodB + jitterB;
+        double time = qMin(timeBridge, qMin(timeA, timeB));
+        if (time > TST_DRIFT_SECONDS * 1e6)
+            break;
+        s_simulatedUs = qint64(time);
+
+        if (time == timeBridge) {                                   // bridge tick
+            pj_bzero(&frame, sizeof(frame));
+            frame.buf = channelBuf.data();
+            frame.size = TST_SAMPLES * sizeof(qint16);
+            pjmedia_port_get_frame(adapterA.channelPort(0), &frame);
+            for (unsigned ch = 0; ch < channels; ch++) {
+                frame.timestamp.u64 = quint64(tickBridge) * TST_SAMPLES;
+                frame.type = ch == 0 ? PJMEDIA_FRAME_TYPE_AUDIO : PJMEDIA_FRAME_TYPE_NONE;
+                frame.size = ch == 0 ? TST_SAMPLES * sizeof(qint16) : 0;
+                pjmedia_port_put_frame(adapterB.channelPort(ch), &frame);
+                frame.type = PJMEDIA_FRAME_TYPE_NONE;
+                frame.size = 0;
+                pjmedia_port_put_frame(adapterA.channelPort(ch), &frame);
+            }
+            tickBridge++;
+            jitterBridge = random.bounded(TST_DRIFT_JITTER);
+        }
+        else if (time == timeA) {                                   // device A captures the sine on channel 0
+            for (int i = 0; i < TST_SAMPLES; i++) {
+                captured[i * channels] = qint16(10000 * sin(sinePhase));
+                sinePhase += 2 * M_PI * 1000 / TST_CLOCKRATE;
+            }
+            pj_bzero(&frame, sizeof(frame));
+            frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+            frame.buf = captured.data();
+            frame.size = captured.size() * sizeof(qint16);
+            pjmedia_port_put_frame(adapterA.devicePort(), &frame);
+            frame.buf = played.data();
+            pjmedia_port_get_frame(adapterA.devicePort(), &frame);
+            tickA++;
+            jitterA = random.bounded(TST_DRIFT_JITTER);
+        }
+        else {                                                      // device B plays channel 0
+            pj_bzero(&frame, sizeof(frame));
+            frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+            frame.buf = played.data();
+            frame.size = played.size() * sizeof(qint16);
+            pjmedia_port_get_frame(adapterB.devicePort(), &frame);
+            if (time > TST_DRIFT_SETTLED * 1e6) {
+                bool silent = true;
+                for (int i = 0; i < TST_SAMPLES; i++) {
+                    double sample = played[i * channels];
+                    if (qAbs(sample) > 100)
+                        silent = false;
+                    if (playedFrames > 0 && qAbs(sample - lastSample) > 2000)
+                        jumps++;
+                    lastSample = sample;
+                }
+                if (silent)
+                    silentFrames++;
+                playedFrames++;
+            }
+            frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+            frame.buf = silence.data();
+            frame.size = silence.size() * sizeof(qint16);
+            pjmedia_port_put_frame(adapterB.devicePort(), &frame);
+            tickB++;
+            jitterB = random.bounded(TST_DRIFT_JITTER);
+        }
+
+        if (s_simulatedUs >= nextCheckUs) {
+            QVERIFY2(qAbs(adapterA.captureDriftPpm() - ppmA) < TST_DRIFT_TOLERANCE, qPrintable(QString::number(adapterA.captureDriftPpm())));
+            QVERIFY2(qAbs(adapterA.playbackDriftPpm() - ppmA) < TST_DRIFT_TOLERANCE, qPrintable(QString::number(adapterA.playbackDriftPpm())));
+            QVERIFY2(qAbs(adapterB.captureDriftPpm() - ppmB) < TST_DRIFT_TOLERANCE, qPrintable(QString::number(adapterB.captureDriftPpm())));
+            QVERIFY2(qAbs(adapterB.playbackDriftPpm() - ppmB) < TST_DRIFT_TOLERANCE, qPrintable(QString::number(adapterB.playbackDriftPpm())));
+            nextCheckUs += 10000000;
+        }
+    }
+    QVERIFY(playedFrames > 0);
+    QCOMPARE(silentFrames, 0);
+    QCOMPARE(jumps, 0);
+}
+
+void TestMultichannelAdapter::benchTick_data()
+{
+    QTest::addColumn<int>("channels");
+    QTest::addColumn<bool>("splitcomb");
+    for (int channels : {8, 32, 64}) {
+        QTest::addRow("%d channels, adapter", channels) << channels << false;
+        QTest::addRow("%d channels, splitcomb", channels) << channels << true;
+    }
+}
+
+/**
+ * one sound device frame in both directions and one bridge tick that reads and writes every channel,
+ * through the adapter or through the splitcomb with one reverse channel per channel as AudioRouter did before
+ */
+void TestMultichannelAdapter::benchTick()
+{
+    QFETCH(int, channels);
+    QFETCH(bool, splitcomb);
+    QVector<qint16> deviceIn(channels * TST_SAMPLES), deviceOut(channels * TST_SAMPLES), channelBuf(TST_SAMPLES);
+    for (int i = 0; i < deviceIn.size(); i++) {
+        deviceIn[i] = qint16(i * 7);
+    }
+    pjmedia_port *devicePort;
+    QVector<pjmedia_port*> channelPorts(channels);
+    MultichannelAdapter *adapter = nullptr;
+    if (splitcomb) {
+        QCOMPARE(pjmedia_splitcomb_create(m_pool, TST_CLOCKRATE, channels, channels * TST_SAMPLES, 16, 0, &devicePort), PJ_SUCCESS);
+        for (int ch = 0; ch < channels; ch++) {
+            QCOMPARE(pjmedia_splitcomb_create_rev_channel(m_pool, devicePort, ch, 0, &channelPorts[ch]), PJ_SUCCESS);
+        }
+    } else {
+        adapter = new MultichannelAdapter(TST_CLOCKRATE, channels, TST_SAMPLES);
+        devicePort = adapter->devicePort();
+        for (int ch = 0; ch < channels; ch++) {
+            channelPorts[ch] = adapter->channelPort(ch);
+        }
+    }
+
+    pjmedia_frame deviceFrame, channelFrame;
+    pj_bzero(&deviceFrame, sizeof(deviceFrame));
+    pj_bzero(&channelFrame, sizeof(channelFrame));
+    QElapsedTimer timer;
+    QBENCHMARK_ONCE {
+        timer.start();
+        for (int tick = 0; tick < TST_TICKS; tick++) {
+            deviceFrame.type = PJMEDIA_FRAME_TYPE_AUDIO;            // the sound device captures
+            deviceFrame.buf = deviceIn.data();
+            deviceFrame.size = deviceIn.size() * sizeof(qint16);
+            pjmedia_port_put_frame(devicePort, &deviceFrame);
+
+            channelFrame.timestamp.u64 = quint64(tick) * TST_SAMPLES;    // the bridge reads all channels, then writes them
+            for (int ch = 0; ch < channels; ch++) {
+                channelFrame.buf = channelBuf.data();
+                channelFrame.size = TST_SAMPLES * sizeof(qint16);
+                pjmedia_port_get_frame(channelPorts[ch], &channelFrame);
+            }
+            for (int ch = 0; ch < channels; ch++) {
+                channelFrame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+                channelFrame.buf = channelBuf.data();
+                channelFrame.size = TST_SAMPLES * sizeof(qint16);
+                pjmedia_port_put_frame(channelPorts[ch], &channelFrame);
+            }
+
+            deviceFrame.buf = deviceOut.data();                     // the sound device plays
+            deviceFrame.size = deviceOut.size() * sizeof(qint16);
+            pjmedia_port_get_frame(devicePort, &deviceFrame);
+        }
+    }
+    qint64 nsecs = timer.nsecsElapsed();
+    qInfo("%.1f us per tick, %.1f Msamples/s", nsecs / 1000.0 / TST_TICKS, 2.0 * TST_TICKS * channels * TST_SAMPLES * 1000.0 / qMax(nsecs, qint64(1)));
+    if (splitcomb) {
+        for (auto port : channelPorts) {
+            pjmedia_port_destroy(port);
+        }
+        pjmedia_port_destroy(devicePort);
+    }
+    delete adapter;
+}
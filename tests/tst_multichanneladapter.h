@@ -0,0 +1,44 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TST_MULTICHANNELADAPTER_H
+#define TST_MULTICHANNELADAPTER_H
+
+#include <QObject>
+
+extern "C" {
+#include <pjmedia.h>
+}
+
+class TestMultichannelAdapter : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void driftTwoDevices_data();
+    void driftTwoDevices();
+    void benchTick_data();
+    void benchTick();
+
+private:
+    pj_caching_pool m_cachingPool;
+    pj_pool_t *m_pool = nullptr;
+};
+
+#endif // TST_MULTICHANNELADAPTER_H
@@ -0,0 +1,72 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "tst_settings.h"
+#include "settings.h"
+#include <QtTest>
+
+#define TST_ROUTES 5000
+#define TST_OFFLINEROUTES 500
+#define TST_DEVICES 100
+
+static s_audioRoutes makeRoute(int src, int dest, bool persistant)
+{
+    s_audioRoutes route;
+    route.srcSlot = src;
+    route.destSlot = dest;
+    route.srcDevName = QString("Source %1").arg(src % TST_DEVICES);
+    route.destDevName = QString("Destination %1").arg(dest % TST_DEVICES);
+    route.persistant = persistant;
+    return route;
+}
+
+void TestSettings::initTestCase()
+{
+    for (int i = 0; i < TST_ROUTES; i++) {              // every device pair is used by several routes
+        m_routes.append(makeRoute(i, i * 7, i % 4 != 0));
+    }
+    for (int i = 0; i < TST_OFFLINEROUTES; i++) {
+        if (i % 2)
+            m_offlineRoutes.append(makeRoute(i, i * 7, true));                  // online again
+        else
+            m_offlineRoutes.append(makeRoute(i + 1000000, i + 2000000, true));  // devices that are offline
+    }
+}
+
+void TestSettings::audioRouteRecordsDedupe()
+{
+    QList<s_audioRoutes> routes, offlineRoutes;
+    routes << makeRoute(1, 2, true) << makeRoute(1 + TST_DEVICES, 2, true)      // same devices, saved once
+           << makeRoute(3, 4, false);                                           // not persistent
+    offlineRoutes << makeRoute(1, 2, true)                                      // online again
+                  << makeRoute(5, 6, true) << makeRoute(5, 6, true)
+                  << makeRoute(7, 8, false);
+    const QList<ConfigRecord> records = audioRouteRecords(routes, offlineRoutes);
+    QCOMPARE(records.size(), 2);
+    QCOMPARE(records.at(0).first, QString("Source 1\nDestination 2"));
+    QCOMPARE(records.at(1).first, QString("Source 5\nDestination 6"));
+}
+
+void TestSettings::benchAudioRouteRecords()
+{
+    QList<ConfigRecord> records;
+    QBENCHMARK {
+        records = audioRouteRecords(m_routes, m_offlineRoutes);
+    }
+    QVERIFY(!records.isEmpty());
+}
@@ -0,0 +1,38 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TST_SETTINGS_H
+#define TST_SETTINGS_H
+
+#include <QObject>
+#include "types.h"
+
+class TestSettings : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void audioRouteRecordsDedupe();
+    void benchAudioRouteRecords();
+
+private:
+    QList<s_audioRoutes> m_routes;           // 5000 online routes
+    QList<s_audioRoutes> m_offlineRoutes;    // 500 offline routes, half of them online again
+};
+
+#endif // TST_SETTINGS_H
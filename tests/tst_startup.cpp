@@ -0,0 +1,187 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "tst_startup.h"
+#include "awahsiplib.h"
+#include "configstore.h"
+#include "websocket.h"
+#include <QtTest>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QNetworkDatagram>
+#include <QSettings>
+
+#define TST_ACCOUNT_NAME "Test"
+#define TST_ACCOUNT_UID "tstaccount"
+#define TST_TONEGEN_UID "tsttonegen"
+#define TST_TONEGEN_FREQUENCY 1000
+#define TST_REGISTER_TIMEOUT 10000          // ms
+#define TST_DISPATCH_COMMANDS 10000         // commands per benchmark iteration
+
+template <typename T>
+static ConfigRecord configRecord(const QString &key, const T &item)
+{
+    QByteArray value;
+    QDataStream out(&value, QIODevice::WriteOnly);
+    out << item;
+    return qMakePair(key, value);
+}
+
+/**
+ * the config of the cold start: an account that registers at m_sipServer and a tone generator with a route to the account,
+ * so the startup creates the account and restores the route. SIP and websocket ports are taken at random
+ */
+void TestStartup::initTestCase()
+{
+    QVERIFY(m_configDir.isValid());
+    QSettings::setPath(QSettings::NativeFormat, QSettings::UserScope, m_configDir.path());
+    QVERIFY(QDir::setCurrent(m_configDir.path()));
+    QVERIFY(m_sipServer.bind(QHostAddress::LocalHost, 0));
+    connect(&m_sipServer, &QUdpSocket::readyRead, this, &TestStartup::sipRequestReceived);
+
+    QSettings settings("awah", "AWAHsipConfig");
+    settings.setValue("settings/TransportConfig/Port", 0);
+    settings.setValue("settings/TransportConfig/Protocol", "udp");
+    settings.setValue("settings/Websocket/Port", 0);
+    settings.sync();
+
+    s_account account;
+    account.name = TST_ACCOUNT_NAME;
+    account.user = "test";
+    account.password = "test";
+    account.serverURI = QString("127.0.0.1:%1").arg(m_sipServer.localPort());
+    account.uid = TST_ACCOUNT_UID;
+    s_IODevices toneGen;
+    toneGen.devicetype = TestToneGenerator;
+    toneGen.uid = TST_TONEGEN_UID;
+    toneGen.genfrequency = TST_TONEGEN_FREQUENCY;
+    s_audioRoutes route;
+    route.srcDevName = QString("AD:%1-ToneGen %2Hz").arg(TST_TONEGEN_UID).arg(TST_TONEGEN_FREQUENCY);
+    route.destDevName = QString("Acc:%1-Ch:1").arg(TST_ACCOUNT_UID);
+    route.level = -6;
+    route.persistant = true;
+    ConfigStore store(QFileInfo(settings.fileName()).absoluteDir().filePath("AWAHsipConfig.journal"));
+    QVERIFY(store.create());
+    store.setSection("AccountConfig", {configRecord(account.uid, account)});
+    store.setSection("IODevConfig", {configRecord(toneGen.uid, toneGen)});
+    store.setSection("AudioRoutes", {configRecord(route.srcDevName + "\n" + route.destDevName, route)});
+    QVERIFY(store.compact());
+}
+
+void TestStartup::cleanupTestCase()
+{
+    delete m_lib;
+    m_lib = nullptr;
+}
+
+void TestStartup::benchColdStart()
+{
+    QBENCHMARK_ONCE {                                   // pjsua can only be started once per process
+        m_lib = AWAHSipLib::instance();
+    }
+    QVERIFY(m_lib);
+    connect(m_lib, &AWAHSipLib::regStateChanged, this, [this](int accId, bool status) {
+        Q_UNUSED(accId);
+        m_registered |= status;
+    });
+    const QJsonObject trace = m_lib->getStartupTrace();
+    qInfo("cold start: %.1f ms", trace["totalMs"].toDouble());
+    for (auto stage : trace["stages"].toArray()) {
+        const QJsonObject stageObj = stage.toObject();
+        qInfo("  %-20s %8.1f ms", qPrintable(stageObj["name"].toString()), stageObj["durationMs"].toDouble());
+        QCOMPARE(stageObj["state"].toString(), QString("done"));
+    }
+    QStringList spans;
+    for (auto span : trace["spans"].toArray()) {
+        const QJsonObject spanObj = span.toObject();
+        qInfo("  %-20s %8.1f ms", qPrintable(spanObj["name"].toString()), spanObj["durationMs"].toDouble());
+        spans << spanObj["name"].toString();
+    }
+    QVERIFY(spans.contains("createAccount " TST_ACCOUNT_NAME));
+    QVERIFY(spans.contains("loadAudioRoutes"));
+    QCOMPARE(trace["running"].toBool(), false);
+
+    QCOMPARE(m_lib->getAudioRoutes().size(), 1);        // the route from the tone generator to the account is restored
+    QElapsedTimer registerTimer;                        // the REGISTER waits in the socket until the event loop runs
+    registerTimer.start();
+    QTRY_VERIFY_WITH_TIMEOUT(m_registered, TST_REGISTER_TIMEOUT);
+    qInfo("registered %lld ms after the start", registerTimer.elapsed());
+}
+
+void TestStartup::benchDispatch_data()
+{
+    QTest::addColumn<bool>("commandTable");
+    QTest::newRow("commandTable") << true;
+    QTest::newRow("invokeMethod") << false;
+}
+
+/**
+ * the websocket command dispatch: the lookup in m_commands against QMetaObject::invokeMethod by name,
+ * which the websocket used before. echo does almost nothing, so the dispatch dominates
+ */
+void TestStartup::benchDispatch()
+{
+    QFETCH(bool, commandTable);
+    if (!m_lib)                                         // benchDispatch run alone
+        m_lib = AWAHSipLib::instance();
+    Websocket *websocket = m_lib->m_Websocket;
+    const QString command = "echo";
+    QJsonObject data{{"value", 1}};
+    QJsonObject ret;
+    if (commandTable) {
+        QBENCHMARK {
+            for (int i = 0; i < TST_DISPATCH_COMMANDS; i++) {
+                pCmdImplementationFn_t cmdFn = websocket->m_commands.value(command, nullptr);
+                if (cmdFn)
+                    (websocket->*cmdFn)(data, ret);
+            }
+        }
+    } else {
+        QBENCHMARK {
+            for (int i = 0; i < TST_DISPATCH_COMMANDS; i++) {
+                QMetaObject::invokeMethod(websocket, command.toStdString().c_str(), Qt::DirectConnection,
+                                          Q_ARG(QJsonObject &, data), Q_ARG(QJsonObject &, ret));
+            }
+        }
+    }
+    QCOMPARE(ret["data"].toObject(), data);
+}
+
+/**
+ * a minimal registrar: the response to a REGISTER copies the headers of the request that identify the transaction
+ * and the binding, other requests are not answered
+ */
+void TestStartup::sipRequestReceived()
+{
+    while (m_sipServer.hasPendingDatagrams()) {
+        const QNetworkDatagram request = m_sipServer.receiveDatagram();
+        const QStringList lines = QString::fromUtf8(request.data()).split("\r\n");
+        if (!lines.first().startsWith("REGISTER "))
+            continue;
+        QString response = "SIP/2.0 200 OK\r\n";
+        for (const auto &line : lines) {
+            const QString header = line.section(':', 0, 0).trimmed().toLower();
+            if (header == "via" || header == "from" || header == "call-id" || header == "cseq" || header == "contact")
+                response += line + "\r\n";
+            else if (header == "to")
+                response += line + (line.contains(";tag=") ? "\r\n" : ";tag=awahtest\r\n");
+        }
+        response += "Expires: 300\r\nContent-Length: 0\r\n\r\n";
+        m_sipServer.writeDatagram(response.toUtf8(), request.senderAddress(), request.senderPort());
+    }
+}
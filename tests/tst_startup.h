@@ -0,0 +1,47 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TST_STARTUP_H
+#define TST_STARTUP_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QUdpSocket>
+
+class AWAHSipLib;
+
+class TestStartup : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void benchColdStart();
+    void benchDispatch_data();
+    void benchDispatch();
+
+private:
+    void sipRequestReceived();
+
+    QTemporaryDir m_configDir;              // no sound device: the bridge runs on the null device
+    QUdpSocket m_sipServer;                 // the registrar of the account, answers every REGISTER with 200 OK
+    bool m_registered = false;
+    AWAHSipLib *m_lib = nullptr;            // pjsua is started once per process, the library runs until cleanupTestCase
+};
+
+#endif // TST_STARTUP_H
@@ -0,0 +1,67 @@
+﻿ /*
+ * Copyright (C) 2016 - 2022 Andy Weiss, Adi Hilber
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "tst_types.h"
+#include "types.h"
+#include <QtTest>
+#include <cmath>
+
+#define TST_ADJ_REFERENCE 64.0          // the table sets 0 dB as pjsua level adjust -64, half of the bridge unity gain
+#define TST_ADJ_TOLERANCE 0.7           // dB, the resolution of the level adjust is poor at low levels
+
+void TestTypes::dBtoAdjLevelAccuracy()
+{
+    int lastAdjust = -129;
+    for (int dB = DBTOADJ_MIN; dB <= DBTOADJ_MAX; dB++) {
+        int level = dB;
+        const int adjust = dBtoAdjLevel(level);
+        QVERIFY2(level <= dB, qPrintable(QString("%1 dB is mapped to the higher level %2 dB").arg(dB).arg(level)));
+        QVERIFY2(adjust >= lastAdjust, qPrintable(QString("the adjust of %1 dB is lower than the one of %2 dB").arg(dB).arg(dB - 1)));
+        lastAdjust = adjust;
+        const double gaindB = 20.0 * std::log10((adjust + 128) / TST_ADJ_REFERENCE);     // the gain the bridge really applies
+        QVERIFY2(qAbs(gaindB - level) <= TST_ADJ_TOLERANCE,
+                 qPrintable(QString("%1 dB: adjust %2 is %3 dB, the table reports %4 dB").arg(dB).arg(adjust).arg(gaindB).arg(level)));
+        int again = level;                                  // the level reported back maps to the same adjust
+        QCOMPARE(dBtoAdjLevel(again), adjust);
+        QCOMPARE(again, level);
+    }
+}
+
+void TestTypes::dBtoAdjLevelLimits()
+{
+    int level = DBTOADJ_MAX + 10;
+    QCOMPARE(dBtoAdjLevel(level), 1152);
+    QCOMPARE(level, DBTOADJ_MAX);
+    level = DBTOADJ_MIN - 1;
+    QCOMPARE(dBtoAdjLevel(level), -128);                    // muted
+    QCOMPARE(level, -96);
+    level = -96;
+    QCOMPARE(dBtoAdjLevel(level), -128);
+}
+
+void TestTypes::benchDBtoAdjLevel()
+{
+    int sum = 0;
+    QBENCHMARK {
+        for (int dB = DBTOADJ_MIN - 4; dB <= DBTOADJ_MAX + 4; dB++) {
+            int level = dB;
+            sum += dBtoAdjLevel(level);
+        }
+    }
+    QVERIFY(sum != 0);
+}
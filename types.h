@@ -48,6 +48,7 @@ extern "C" {
 
 class GpioDevice;
 class AccountGpioDev;
+class MultichannelAdapter;
 
 inline QString createNewUID() { return QUuid::createUuid().toString(QUuid::Id128); }
 
@@ -66,50 +67,39 @@ inline QString pj2Str(const pj_str_t &input_str)
     return QString();
 }
 
+#define DBTOADJ_MIN -36                  // lowest level in dB that is not muted
+#define DBTOADJ_MAX 26                   // highest level in dB, higher levels are limited to it
+
+/**
+ * @brief entry of the dB to pjsua level adjust table
+ */
+struct s_dBtoAdj{
+    int level;                          // the dB value that is really set, some levels can not be set due to poor resolution so the level is mapped to the next closest
+    int adjust;                         // the pjsua level adjust
+};
+
 inline int dBtoAdjLevel(int &level)
 {
-    int leveladjust = 0;
     // conversion table from dB to pjusa leveladjust, this is used because I din't find any algorithm to match the dB values over the whole range
-    QHash<int,int> const m_dbToAdjustVol = {{26,1152},{25,1013},{24,889},{23,778},{22,680},{21,592},
-                                            {20,514},{19,444},{18,382},{17,326},{16,277},{15,233},{14,193},{13,157},{12,128},{11,99},
-                                            {10,75},{9,51},{8,33},{7,15},{6,0},{5,-14},{4,-26},{3,-37},{2,-47},{1,-56},
-                                            {0,-64},{-1,-71},{-2,-77},{-3,-83},{-4,-88},{-5,-92},{-6,-96},{-7,-99},{-8,-103},{-9,-105},
-                                            {-10,-108},{-11,-110},{-12,-112},{-13,-114},{-14,-115},{-15,-117},{-16,-118},{-17,-119},{-18,-120},{-19,-121},
-                                            {-20,-122},{-22,-123},{-24,-124},{-26,-125},
-                                            {-30,-126},{-36,-127}};            // levels below -36 are not supported, mute = -128
-
-    if(level > 26) level = 26;              // limit the maximum gain to 20dB
-    if(level < -36){                        // values below -40 are not supported by pjsua, so mute the xp
-        leveladjust = -128;
+    // the table is a constant initialized static, built at compile time and shared by all threads without locking. Index = dB - DBTOADJ_MIN
+    static const s_dBtoAdj dbToAdjustVol[DBTOADJ_MAX - DBTOADJ_MIN + 1] = {
+        {-36,-127}, {-36,-127}, {-36,-127}, {-36,-127}, {-36,-127}, {-36,-127}, {-30,-126}, {-30,-126},
+        {-30,-126}, {-30,-126}, {-26,-125}, {-26,-125}, {-24,-124}, {-24,-124}, {-22,-123}, {-22,-123},
+        {-20,-122}, {-19,-121}, {-18,-120}, {-17,-119}, {-16,-118}, {-15,-117}, {-14,-115}, {-13,-114},
+        {-12,-112}, {-11,-110}, {-10,-108}, {-9,-105}, {-8,-103}, {-7,-99}, {-6,-96}, {-5,-92},
+        {-4,-88}, {-3,-83}, {-2,-77}, {-1,-71}, {0,-64}, {1,-56}, {2,-47}, {3,-37},
+        {4,-26}, {5,-14}, {6,0}, {7,15}, {8,33}, {9,51}, {10,75}, {11,99},
+        {12,128}, {13,157}, {14,193}, {15,233}, {16,277}, {17,326}, {18,382}, {19,444},
+        {20,514}, {21,592}, {22,680}, {23,778}, {24,889}, {25,1013}, {26,1152}};
+
+    if(level > DBTOADJ_MAX) level = DBTOADJ_MAX;        // limit the maximum gain to 20dB
+    if(level < DBTOADJ_MIN){                            // values below -40 are not supported by pjsua, so mute the xp
         level = -96;
+        return -128;
     }
-    switch (level) {                        // some levels can not be set due to poor resolution so the level is mapped to the next closest
-    case -21:
-        level = -22;
-        break;
-    case -23:
-        level = -24;
-        break;
-    case -25:
-        level = -26;
-        break;
-    case -27:
-    case -28:
-    case -29:
-        level = -30;
-        break;
-    case -31:
-    case -32:
-    case -33:
-    case -34:
-    case -35:
-        level = -36;
-        break;
-    }
-    if(m_dbToAdjustVol.contains(level)){
-        leveladjust = m_dbToAdjustVol.value(level);
-    }
-    return leveladjust;
+    const s_dBtoAdj &entry = dbToAdjustVol[level - DBTOADJ_MIN];
+    level = entry.level;
+    return entry.adjust;
 }
 
 inline float dBtoFact(const float dB)
@@ -174,8 +164,11 @@ struct s_IODevices{
     int PBDevID = -1;
     QString path = "n/a";                   // ony for devicetype Fileplayer, FileRecorder
     pjmedia_snd_port *soundport =nullptr;
-    uint inChannelCount = 0;            // For AudioDevices: not saved, only for listConfPorts
-    uint outChannelCount = 0;           // For AudioDevices: not saved, only for listConfPorts
+    MultichannelAdapter *adapter = nullptr;   // For AudioDevices: not saved, splits the sound port into the per channel conference ports
+    uint inChannelCount = 0;            // For AudioDevices: not saved, only for the conference port list
+    uint outChannelCount = 0;           // For AudioDevices: not saved, only for the conference port list
+    double captureDriftPpm = 0;         // For AudioDevices: not saved, estimated drift of the device clock against the bridge clock
+    double playbackDriftPpm = 0;        // For AudioDevices: not saved
     QJsonObject typeSpecificSettings = {};
     QJsonObject toJSON() const {
         QJsonArray portNrArr;
@@ -184,7 +177,8 @@ struct s_IODevices{
         }
         return {{"devicetype", devicetype}, {"uid", uid}, {"inputname", inputname}, {"outputname", outputame}, {"portNo", portNrArr},
                 {"genfrequency", genfrequency}, {"RecDevID", RecDevID}, {"PBDevID", PBDevID}, {"path", path},
-                {"inChannelCount", (int) inChannelCount}, {"outChannelCount", (int) outChannelCount}, {"typeSpecificSettings", typeSpecificSettings}};
+                {"inChannelCount", (int) inChannelCount}, {"outChannelCount", (int) outChannelCount}, {"captureDriftPpm", captureDriftPpm},
+                {"playbackDriftPpm", playbackDriftPpm}, {"typeSpecificSettings", typeSpecificSettings}};
     }
     s_IODevices* fromJSON(QJsonObject &ioDeviceJSON) {
         QJsonArray portNrArr = ioDeviceJSON["portNo"].toArray();
@@ -295,8 +289,9 @@ struct s_Call{
     QString SDP = QString();
     int splitterSlot;
     int callConfPort = -1;
+    qint64 callSeq = -1;        // unique for every call, it tags the call in the event log, pjsua reuses the call ids
     QJsonObject toJSON() const {
-        return {{"CallStatusText", CallStatusText}, {"CallStatusCode", CallStatusCode}, {"ConnectedTo", ConnectedTo}, {"callId", callId}, {"codec", codec.toJSON()}};
+        return {{"CallStatusText", CallStatusText}, {"CallStatusCode", CallStatusCode}, {"ConnectedTo", ConnectedTo}, {"callId", callId}, {"callSeq", QJsonValue(callSeq)}, {"codec", codec.toJSON()}};
     }
 };
 //Q_DECLARE_METATYPE(s_Call);
@@ -393,6 +388,31 @@ struct s_audioPort{
 };
 Q_DECLARE_METATYPE(s_audioPort);
 
+enum ConfPortOwner {
+    AudioDeviceOwner,
+    ToneGeneratorOwner,
+    FilePlayerOwner,
+    FileRecorderOwner,
+    AccountOwner
+};
+Q_ENUMS(ConfPortOwner)
+
+enum ConfPortDirection {
+    ConfPortSource = 1,
+    ConfPortDestination = 2,
+    ConfPortBidirectional = ConfPortSource | ConfPortDestination
+};
+Q_ENUMS(ConfPortDirection)
+
+struct s_confPortInfo{
+    int slot = INVALID_ID;
+    pj_str_t pjName;                    // the name of the port in the conference bridge e.g. "AD:<uid>-Ch:3"
+    ConfPortOwner owner = AudioDeviceOwner;
+    QString uid = "";                   // uid of the device or account owning the port
+    uint channel = 0;                   // channel of a multichannel device or account starting at 1, 0 if there is none
+    int direction = ConfPortBidirectional;
+};
+
 struct s_audioPortList{
     QList<s_audioPort> srcPorts = QList<s_audioPort>();
     QList<s_audioPort> destPorts = QList<s_audioPort>();
@@ -460,6 +480,26 @@ struct s_audioRoutes{
 Q_DECLARE_METATYPE(s_audioRoutes);
 Q_DECLARE_METATYPE(QList<s_audioRoutes>);
 
+enum audioRouteOpType{
+    ROUTE_CONNECT,
+    ROUTE_DISCONNECT,
+    ROUTE_CHANGE_LEVEL
+};
+Q_ENUMS(audioRouteOpType)
+
+struct s_audioRouteOp{
+    audioRouteOpType op = ROUTE_CONNECT;
+    int srcSlot = PJSUA_INVALID_ID;
+    int destSlot = PJSUA_INVALID_ID;
+    int level = 0;
+    bool persistant = true;
+    QJsonObject toJSON() const {
+        const char* opNames[] = {"connect", "disconnect", "changeLevel"};
+        return {{"op", opNames[op]}, {"src_slot", srcSlot}, {"sink_slot", destSlot}, {"level", level}, {"persistant", persistant} };
+    }
+};
+Q_DECLARE_METATYPE(s_audioRouteOp);
+
 enum settingType{
     INTEGER,
     STRING,
@@ -565,6 +605,18 @@ struct s_buddy{
 Q_DECLARE_METATYPE(s_buddy);
 Q_DECLARE_METATYPE(QList<s_buddy>);
 
+// serialization of the persistent types, implemented in awahsiplib.cpp
+QDataStream &operator<<(QDataStream &out, const s_IODevices &obj);
+QDataStream &operator>>(QDataStream &in, s_IODevices &obj);
+QDataStream &operator<<(QDataStream &out, const s_account &obj);
+QDataStream &operator>>(QDataStream &in, s_account &obj);
+QDataStream &operator<<(QDataStream &out, const s_audioRoutes &obj);
+QDataStream &operator>>(QDataStream &in, s_audioRoutes &obj);
+QDataStream &operator<<(QDataStream &out, const s_gpioRoute &obj);
+QDataStream &operator>>(QDataStream &in, s_gpioRoute &obj);
+QDataStream &operator<<(QDataStream &out, const s_buddy &obj);
+QDataStream &operator>>(QDataStream &in, s_buddy &obj);
+
 
 #endif // TYPES_H
 
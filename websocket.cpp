@@ -70,12 +70,12 @@ static bool jCheckString(QString &ret, QJsonValueRef val) {
     } else return false;
 }
 
-//static bool jCheckArray(QJsonArray &ret, QJsonValueRef val) {
-//    if(val.isArray()){
-//        ret = val.toArray();
-//        return true;
-//    } else return false;
-//}
+static bool jCheckArray(QJsonArray &ret, QJsonValueRef val) {
+    if(val.isArray()){
+        ret = val.toArray();
+        return true;
+    } else return false;
+}
 
 static bool jCheckObject(QJsonObject &ret, QJsonValueRef val) {
     if(val.isObject()){
@@ -84,12 +84,58 @@ static bool jCheckObject(QJsonObject &ret, QJsonValueRef val) {
     } else return false;
 }
 
+static QString collectionKey(const s_audioRoutes &route) {
+    return QString::number(route.srcSlot) + ":" + QString::number(route.destSlot);
+}
+
+static QString collectionKey(const s_account &account) {
+    return account.uid;
+}
+
+static QString collectionKey(const s_IODevices &device) {
+    return device.uid;
+}
+
+static QString collectionKey(const s_gpioRoute &route) {
+    return route.srcSlotId + ":" + route.destSlotId;
+}
+
+static void addSchemaKeys(QSet<QString> &schemaKeys, const QJsonObject &obj) {
+    for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+        schemaKeys.insert(it.key());
+        if (it.value().isObject())
+            addSchemaKeys(schemaKeys, it.value().toObject());
+    }
+}
+
 Websocket::Websocket(quint16 port, AWAHSipLib *parentLib, QObject *parent) : QObject(parent),  m_lib(parentLib),
     m_pWebSocketServer(new QWebSocketServer(QStringLiteral("Chat Server"), QWebSocketServer::NonSecureMode, this))
 {
+    registerCommands();
+    m_cborKeyNames << "command" << "data" << "error" << "signal" << "cmdID" << "code" << "string" << "first" << "keys";
+    for (int i = 0; i < m_cborKeyNames.size(); i++) {
+        m_cborKeys.insert(m_cborKeyNames.at(i), i);
+    }
+    // only the field names of the protocol and the structs are interned, keys taken from the data (uids, "src:dst", ...) are not
+    int splitterSlot = -1;
+    m_cborSchemaKeys = QSet<QString>(m_cborKeyNames.begin(), m_cborKeyNames.end());
+    m_cborSchemaKeys << "collection" << "version" << "baseVersion" << "added" << "updated" << "removed" << "entries"
+                     << "collections" << "topic" << "format";
+    addSchemaKeys(m_cborSchemaKeys, s_IODevices().toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_codec().toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_callHistory().toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_Call(splitterSlot).toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_account().toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_audioPortList().toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_audioPort().toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_audioRoutes().toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_audioRouteOp().toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_gpioPort().toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_gpioRoute().toJSON());
+    addSchemaKeys(m_cborSchemaKeys, s_buddy().toJSON());
     if (m_pWebSocketServer->listen(QHostAddress::Any, port))
     {
-        m_lib->m_Log->writeLog(3, QString("Websocket-Server started and listening on port %1").arg(port));
+        AWAHLOG(m_lib->m_Log, 3, QString("Websocket-Server started and listening on port %1").arg(port));
         connect(m_pWebSocketServer, &QWebSocketServer::newConnection,
                 this, &Websocket::onNewConnection);
     }
@@ -103,54 +149,179 @@ Websocket::~Websocket()
 void Websocket::onNewConnection()
 {
     auto pSocket = m_pWebSocketServer->nextPendingConnection();
-    m_lib->m_Log->writeLog(3, QString("Websocket-Server: %1 connected!").arg(getIdentifier(pSocket)));
+    AWAHLOG(m_lib->m_Log, 3, QString("Websocket-Server: %1 connected!").arg(getIdentifier(pSocket)));
     pSocket->setParent(this);
 
     connect(pSocket, &QWebSocket::textMessageReceived,
             this, &Websocket::processMessage);
     connect(pSocket, &QWebSocket::disconnected,
             this, &Websocket::socketDisconnected);
+    connect(pSocket, &QWebSocket::binaryMessageReceived,
+            this, &Websocket::processBinaryMessage);
+    connect(pSocket, &QWebSocket::bytesWritten,
+            this, &Websocket::socketBytesWritten);
 
     m_clients << pSocket;
 }
 
+void Websocket::registerCommands()
+{
+    m_commands.insert(QStringLiteral("echo"), &Websocket::echo);
+    m_commands.insert(QStringLiteral("getAllVariables"), &Websocket::getAllVariables);
+    m_commands.insert(QStringLiteral("getIoDevices"), &Websocket::getIoDevices);
+    m_commands.insert(QStringLiteral("createAccount"), &Websocket::createAccount);
+    m_commands.insert(QStringLiteral("modifyAccount"), &Websocket::modifyAccount);
+    m_commands.insert(QStringLiteral("removeAccount"), &Websocket::removeAccount);
+    m_commands.insert(QStringLiteral("getAccounts"), &Websocket::getAccounts);
+    m_commands.insert(QStringLiteral("makeCall"), &Websocket::makeCall);
+    m_commands.insert(QStringLiteral("hangupCall"), &Websocket::hangupCall);
+    m_commands.insert(QStringLiteral("acceptCall"), &Websocket::acceptCall);
+    m_commands.insert(QStringLiteral("holdCall"), &Websocket::holdCall);
+    m_commands.insert(QStringLiteral("transferCall"), &Websocket::transferCall);
+    m_commands.insert(QStringLiteral("getCallInfo"), &Websocket::getCallInfo);
+    m_commands.insert(QStringLiteral("getSDP"), &Websocket::getSDP);
+    m_commands.insert(QStringLiteral("getCallHistory"), &Websocket::getCallHistory);
+    m_commands.insert(QStringLiteral("getAccountByID"), &Websocket::getAccountByID);
+    m_commands.insert(QStringLiteral("getAudioRoutes"), &Websocket::getAudioRoutes);
+    m_commands.insert(QStringLiteral("listInputSoundDev"), &Websocket::listInputSoundDev);
+    m_commands.insert(QStringLiteral("listOutputSoundDev"), &Websocket::listOutputSoundDev);
+    m_commands.insert(QStringLiteral("addAudioDevice"), &Websocket::addAudioDevice);
+    m_commands.insert(QStringLiteral("removeAudioDevice"), &Websocket::removeAudioDevice);
+    m_commands.insert(QStringLiteral("addFilePlayer"), &Websocket::addFilePlayer);
+    m_commands.insert(QStringLiteral("addFileRecorder"), &Websocket::addFileRecorder);
+    m_commands.insert(QStringLiteral("getConfPortsList"), &Websocket::getConfPortsList);
+    m_commands.insert(QStringLiteral("connectConfPort"), &Websocket::connectConfPort);
+    m_commands.insert(QStringLiteral("disconnectConfPort"), &Websocket::disconnectConfPort);
+    m_commands.insert(QStringLiteral("changeConfPortLevel"), &Websocket::changeConfPortLevel);
+    m_commands.insert(QStringLiteral("applyRouteBatch"), &Websocket::applyRouteBatch);
+    m_commands.insert(QStringLiteral("addToneGen"), &Websocket::addToneGen);
+    m_commands.insert(QStringLiteral("getAudioDevices"), &Websocket::getAudioDevices);
+    m_commands.insert(QStringLiteral("getSoundDevID"), &Websocket::getSoundDevID);
+    m_commands.insert(QStringLiteral("changeConfportsrcName"), &Websocket::changeConfportsrcName);
+    m_commands.insert(QStringLiteral("changeConfportdstName"), &Websocket::changeConfportdstName);
+    m_commands.insert(QStringLiteral("addBuddy"), &Websocket::addBuddy);
+    m_commands.insert(QStringLiteral("editBuddy"), &Websocket::editBuddy);
+    m_commands.insert(QStringLiteral("removeBuddy"), &Websocket::removeBuddy);
+    m_commands.insert(QStringLiteral("getBuddies"), &Websocket::getBuddies);
+    m_commands.insert(QStringLiteral("getActiveCodecs"), &Websocket::getActiveCodecs);
+    m_commands.insert(QStringLiteral("createGpioDev"), &Websocket::createGpioDev);
+    m_commands.insert(QStringLiteral("removeGpioDevice"), &Websocket::removeGpioDevice);
+    m_commands.insert(QStringLiteral("getGpioDevices"), &Websocket::getGpioDevices);
+    m_commands.insert(QStringLiteral("getGpioDevTypes"), &Websocket::getGpioDevTypes);
+    m_commands.insert(QStringLiteral("setGPIStateOfDevice"), &Websocket::setGPIStateOfDevice);
+    m_commands.insert(QStringLiteral("getGpioRoutes"), &Websocket::getGpioRoutes);
+    m_commands.insert(QStringLiteral("getGpioPortsList"), &Websocket::getGpioPortsList);
+    m_commands.insert(QStringLiteral("connectGpioPort"), &Websocket::connectGpioPort);
+    m_commands.insert(QStringLiteral("disconnectGpioPort"), &Websocket::disconnectGpioPort);
+    m_commands.insert(QStringLiteral("changeGpioCrosspoint"), &Websocket::changeGpioCrosspoint);
+    m_commands.insert(QStringLiteral("getGpioStates"), &Websocket::getGpioStates);
+    m_commands.insert(QStringLiteral("readNewestLog"), &Websocket::readNewestLog);
+    m_commands.insert(QStringLiteral("queryEventLog"), &Websocket::queryEventLog);
+    m_commands.insert(QStringLiteral("sendDtmf"), &Websocket::sendDtmf);
+    m_commands.insert(QStringLiteral("getSettings"), &Websocket::getSettings);
+    m_commands.insert(QStringLiteral("setSettings"), &Websocket::setSettings);
+    m_commands.insert(QStringLiteral("getCodecPriorities"), &Websocket::getCodecPriorities);
+    m_commands.insert(QStringLiteral("setCodecPriorities"), &Websocket::setCodecPriorities);
+    m_commands.insert(QStringLiteral("getVersions"), &Websocket::getVersions);
+    m_commands.insert(QStringLiteral("getStartupTrace"), &Websocket::getStartupTrace);
+    m_commands.insert(QStringLiteral("resync"), &Websocket::resync);
+    m_commands.insert(QStringLiteral("setWireFormat"), &Websocket::setWireFormat);
+    m_commands.insert(QStringLiteral("subscribe"), &Websocket::subscribe);
+    m_commands.insert(QStringLiteral("unsubscribe"), &Websocket::unsubscribe);
+}
+
 void Websocket::processMessage(const QString &message)
 {
     QWebSocket *pSender = qobject_cast<QWebSocket *>(sender());
-    m_lib->m_Log->writeLog(4, QString("Websocket  RX:  %1 \n %2").arg(getIdentifier(pSender), message));
-    QJsonObject jObj, ret;
+    AWAHLOG(m_lib->m_Log, 4, QString("Websocket  RX:  %1 \n %2").arg(getIdentifier(pSender), message));
+    QJsonObject jObj;
     if(objectFromString(message, jObj)) {
-        QString command, cmdID;
-        QJsonObject data;
-        if(jCheckString(command, jObj["command"]) && jCheckObject(data, jObj["data"])) {
-            if(QMetaObject::invokeMethod(this, command.toStdString().c_str(), Qt::DirectConnection, Q_ARG(QJsonObject &, data), Q_ARG(QJsonObject &, ret))) {
-                if(jCheckString(cmdID, jObj["cmdID"]))
-                    ret["cmdID"] = cmdID;
-                ret["command"] = jObj["command"].toString();
-                pSender->sendTextMessage(QJsonDocument(ret).toJson(QJsonDocument::Compact));
-            } else {
-                ret["command"] = jObj["command"].toString();
-                ret["error"] = hasError("Command '" + command + "' could not be invoked!");
-                pSender->sendTextMessage(QJsonDocument(ret).toJson(QJsonDocument::Compact));
-            }
+        executeCommand(pSender, jObj);
+    } else {
+        QJsonObject ret;
+        ret["error"] = hasError("Not valid JSON");
+        sendReply(pSender, ret);
+    }
+}
+
+void Websocket::processBinaryMessage(const QByteArray &message)
+{
+    QWebSocket *pSender = qobject_cast<QWebSocket *>(sender());
+    QCborParserError parseError;
+    QCborValue value = QCborValue::fromCbor(message, &parseError);
+    if(parseError.error == QCborError::NoError && value.isMap()) {
+        QJsonObject jObj = cborToJson(value).toObject();
+        AWAHLOG(m_lib->m_Log, 4, QString("Websocket  RX:  %1 (CBOR) \n %2").arg(getIdentifier(pSender), QString::fromUtf8(QJsonDocument(jObj).toJson(QJsonDocument::Compact))));
+        executeCommand(pSender, jObj);
+    } else {
+        AWAHLOG(m_lib->m_Log, 4, QString("Websocket  RX:  %1 invalid CBOR message").arg(getIdentifier(pSender)));
+        QJsonObject ret;
+        ret["error"] = hasError("Not valid CBOR");
+        sendReply(pSender, ret);
+    }
+}
+
+void Websocket::executeCommand(QWebSocket *pSender, QJsonObject &jObj)
+{
+    QJsonObject ret;
+    QString command, cmdID;
+    QJsonObject data;
+    if(jCheckString(command, jObj["command"]) && jCheckObject(data, jObj["data"])) {
+        pCmdImplementationFn_t cmdFn = m_commands.value(command, nullptr);
+        if(cmdFn) {
+            m_currentClient = pSender;
+            (this->*cmdFn)(data, ret);
+            m_currentClient = nullptr;
+            if(jCheckString(cmdID, jObj["cmdID"]))
+                ret["cmdID"] = cmdID;
+            ret["command"] = jObj["command"].toString();
         } else {
-            ret["error"] = hasError("JSON does not have a 'command' and a 'data' Object");
-            pSender->sendTextMessage(QJsonDocument(ret).toJson(QJsonDocument::Compact));
+            ret["command"] = jObj["command"].toString();
+            ret["error"] = hasError("Command '" + command + "' could not be invoked!");
         }
     } else {
-        ret["error"] = hasError("Not valid JSON");
-        pSender->sendTextMessage(QJsonDocument(ret).toJson(QJsonDocument::Compact));
+        ret["error"] = hasError("JSON does not have a 'command' and a 'data' Object");
+    }
+    sendReply(pSender, ret);
+}
+
+void Websocket::sendReply(QWebSocket *pClient, const QJsonObject &ret)
+{
+    s_wsMessage reply;
+    if(m_cborClients.contains(pClient)) {
+        reply.binary = toCborMessage(ret);
+        AWAHLOG(m_lib->m_Log, 4, QString("Websocket  TX:  %1 (CBOR, %2 bytes) \n %3").arg(getIdentifier(pClient)).arg(reply.binary.size()).arg(QString::fromUtf8(QJsonDocument(ret).toJson(QJsonDocument::Compact))));
+    } else {
+        reply.text = QString::fromUtf8(QJsonDocument(ret).toJson(QJsonDocument::Compact));
+        AWAHLOG(m_lib->m_Log, 4, QString("Websocket  TX:  %1 \n %2").arg(getIdentifier(pClient), reply.text));
     }
-    m_lib->m_Log->writeLog(4, QString("Websocket  TX:  %1 \n %2").arg(getIdentifier(pSender), QJsonDocument(ret).toJson(QJsonDocument::Compact).toStdString().c_str()));
+    reply.keep = true;
+    sendToClient(pClient, reply);
+}
+
+void Websocket::socketBytesWritten(qint64 bytes)
+{
+    QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
+    auto queue = m_clientQueues.find(pClient);
+    if (queue == m_clientQueues.end())
+        return;
+    queue->pendingBytes = qMax(qint64(0), queue->pendingBytes - bytes);
+    flushClientQueue(pClient);
 }
 
 void Websocket::socketDisconnected()
 {
     QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
-    m_lib->m_Log->writeLog(3, QString("Websocket-Server: %1 disconnected!").arg(getIdentifier(pClient)));
+    AWAHLOG(m_lib->m_Log, 3, QString("Websocket-Server: %1 disconnected!").arg(getIdentifier(pClient)));
     if (pClient)
     {
         m_clients.removeAll(pClient);
+        m_deltaClients.remove(pClient);
+        if (m_deltaClients.isEmpty())                       // nobody gets deltas, the next resync starts from a new base
+            m_collections.clear();
+        m_clientQueues.remove(pClient);
+        m_cborClients.remove(pClient);
+        m_subscriptions.remove(pClient);
         pClient->deleteLater();
     }
 }
@@ -568,6 +739,45 @@ void Websocket::changeConfPortLevel(QJsonObject &data, QJsonObject &ret) {
     }
 }
 
+void Websocket::applyRouteBatch(QJsonObject &data, QJsonObject &ret) {
+    QJsonObject retDataObj;
+    QJsonArray opsArr;
+    QList<s_audioRouteOp> ops;
+    if (jCheckArray(opsArr, data["ops"])) {
+        for (const auto & opVal : qAsConst(opsArr)) {
+            QJsonObject opObj = opVal.toObject();
+            s_audioRouteOp op;
+            QString opStr, levelStr;
+            if (!jCheckString(opStr, opObj["op"]) || !jCheckInt(op.srcSlot, opObj["src_slot"]) || !jCheckInt(op.destSlot, opObj["sink_slot"])) {
+                ret["error"] = hasError("Parameters not accepted");
+                return;
+            }
+            if (opStr == "connect")
+                op.op = ROUTE_CONNECT;
+            else if (opStr == "disconnect")
+                op.op = ROUTE_DISCONNECT;
+            else if (opStr == "changeLevel")
+                op.op = ROUTE_CHANGE_LEVEL;
+            else {
+                ret["error"] = hasError("Unknown operation '" + opStr + "'");
+                return;
+            }
+            if (jCheckString(levelStr, opObj["level"]))             // level is sent as string by connectConfPort, accept both
+                op.level = levelStr.toInt();
+            else
+                jCheckInt(op.level, opObj["level"]);
+            jCheckBool(op.persistant, opObj["persistant"]);
+            ops.append(op);
+        }
+        int retVal = m_lib->applyRouteBatch(ops);
+        retDataObj["returnValue"] = retVal;
+        ret["data"] = retDataObj;
+        ret["error"] = noError();
+    } else {
+        ret["error"] = hasError("Parameters not accepted");
+    }
+}
+
 void Websocket::addToneGen(QJsonObject &data, QJsonObject &ret) {
     QJsonObject retDataObj;
     int freq;
@@ -843,10 +1053,22 @@ void Websocket::getGpioStates(QJsonObject &data, QJsonObject &ret) {
 }
 
 void Websocket::readNewestLog(QJsonObject &data, QJsonObject &ret) {
-    Q_UNUSED(data);
     QJsonObject retDataObj;
     QJsonArray logArr;
-    QStringList logList = m_lib->readNewestLog();
+    s_logQuery query;
+    if((!data["offset"].isUndefined() && !jCheckInt(query.offset, data["offset"]))
+            || (!data["count"].isUndefined() && !jCheckInt(query.count, data["count"]))
+            || (!data["level"].isUndefined() && !jCheckInt(query.maxLevel, data["level"]))
+            || (!data["from"].isUndefined() && !data["from"].isDouble())
+            || (!data["to"].isUndefined() && !data["to"].isDouble())
+            || (!data["contains"].isUndefined() && !jCheckString(query.contains, data["contains"]))
+            || query.offset < 0 || query.count < 0 || query.count > LOGRINGSIZE) {
+        ret["error"] = hasError("Parameters not accepted");
+        return;
+    }
+    query.from = qint64(data["from"].toDouble());
+    query.to = qint64(data["to"].toDouble());
+    QStringList logList = m_lib->readNewestLog(query);
     for (auto & logEntry : logList) {
         logArr.append(logEntry);
     }
@@ -855,6 +1077,39 @@ void Websocket::readNewestLog(QJsonObject &data, QJsonObject &ret) {
     ret["error"] = noError();
 }
 
+void Websocket::queryEventLog(QJsonObject &data, QJsonObject &ret) {
+    QJsonObject retDataObj;
+    QJsonArray eventsArr;
+    s_logRecordQuery query;
+    if((!data["from"].isUndefined() && !data["from"].isDouble())
+            || (!data["to"].isUndefined() && !data["to"].isDouble())
+            || (!data["level"].isUndefined() && !jCheckInt(query.maxLevel, data["level"]))
+            || (!data["accId"].isUndefined() && !jCheckInt(query.accId, data["accId"]))
+            || (!data["callId"].isUndefined() && !jCheckInt(query.callId, data["callId"]))
+            || (!data["callSeq"].isUndefined() && !data["callSeq"].isDouble())
+            || (!data["subsystem"].isUndefined() && !jCheckString(query.subsystem, data["subsystem"]))
+            || (!data["contains"].isUndefined() && !jCheckString(query.contains, data["contains"]))
+            || (!data["limit"].isUndefined() && !jCheckInt(query.limit, data["limit"]))) {
+        ret["error"] = hasError("Parameters not accepted");
+        return;
+    }
+    query.from = qint64(data["from"].toDouble());
+    query.to = qint64(data["to"].toDouble());
+    query.callSeq = qint64(data["callSeq"].toDouble(-1));
+    bool ok;
+    const QList<s_logRecord> events = m_lib->queryEvents(query, ok);
+    if(!ok) {
+        ret["error"] = hasError("Event log is disabled");
+        return;
+    }
+    for (auto & event : events) {
+        eventsArr.append(event.toJSON());
+    }
+    retDataObj["events"] = eventsArr;
+    ret["data"] = retDataObj;
+    ret["error"] = noError();
+}
+
 void Websocket::sendDtmf(QJsonObject &data, QJsonObject &ret) {
     QJsonObject retDataObj;
     int callId, AccID;
@@ -919,6 +1174,140 @@ void Websocket::getVersions(QJsonObject &data, QJsonObject &ret) {
     ret["error"] = noError();
 }
 
+void Websocket::getStartupTrace(QJsonObject &data, QJsonObject &ret) {
+    Q_UNUSED(data);
+    QJsonObject retDataObj;
+    retDataObj["StartupTrace"] = m_lib->getStartupTrace();
+    ret["data"] = retDataObj;
+    ret["error"] = noError();
+}
+
+void Websocket::resync(QJsonObject &data, QJsonObject &ret) {
+    QJsonObject retDataObj;
+    QJsonArray collectionsArr;
+    QStringList collections = {"audioRoutes", "Accounts", "ioDevices", "gpioRoutes"};
+    if (jCheckArray(collectionsArr, data["collections"])) {
+        QStringList requested;
+        for (const auto & collection : qAsConst(collectionsArr)) {
+            if (!collections.contains(collection.toString())) {
+                ret["error"] = hasError("Unknown collection '" + collection.toString() + "'");
+                return;
+            }
+            requested.append(collection.toString());
+        }
+        collections = requested;
+    }
+    if (m_currentClient) {
+        for (auto & collection : qAsConst(collections))
+            m_deltaClients[m_currentClient].insert(collection);
+    }
+    for (auto & collection : collections) {
+        pushCollectionDelta(collection, collectionEntries(collection));        // bring the stored state up to date
+        const s_wsCollection &state = m_collections[collection];
+        QJsonObject entriesObj, collectionObj;
+        for (auto it = state.entries.constBegin(); it != state.entries.constEnd(); ++it) {
+            entriesObj[it.key()] = it.value();
+        }
+        collectionObj["version"] = QJsonValue(qint64(state.version));
+        collectionObj["entries"] = entriesObj;
+        retDataObj[collection] = collectionObj;
+    }
+    ret["data"] = retDataObj;
+    ret["error"] = noError();
+}
+
+void Websocket::setWireFormat(QJsonObject &data, QJsonObject &ret) {
+    QString format;
+    QJsonObject retDataObj;
+    if(m_currentClient && jCheckString(format, data["format"]) && (format == "json" || format == "cbor")) {
+        if(format == "cbor") {
+            m_cborClients.insert(m_currentClient);
+            retDataObj["keys"] = QJsonArray::fromStringList(m_cborKeyNames);
+        } else {
+            m_cborClients.remove(m_currentClient);
+        }
+        retDataObj["format"] = format;
+        ret["data"] = retDataObj;
+        ret["error"] = noError();
+    } else {
+        ret["error"] = hasError("Parameters not accepted");
+    }
+}
+
+static QJsonObject subscriptionsToJSON(const QHash<QString, QSet<QString>> &subscriptions) {
+    QJsonObject subscriptionsObj;
+    for (auto it = subscriptions.constBegin(); it != subscriptions.constEnd(); ++it) {
+        QStringList keys = it.value().values();
+        keys.sort();
+        subscriptionsObj[it.key()] = QJsonArray::fromStringList(keys);
+    }
+    return subscriptionsObj;
+}
+
+static bool jCheckTopicKeys(QSet<QString> &ret, QJsonValueRef val) {
+    QJsonArray keysArr;
+    if (!jCheckArray(keysArr, val))
+        return false;
+    for (const auto & key : qAsConst(keysArr)) {
+        if (key.isString())
+            ret.insert(key.toString());
+        else if (key.isDouble())
+            ret.insert(QString::number(key.toInt()));
+        else
+            return false;
+    }
+    return !ret.isEmpty();
+}
+
+void Websocket::subscribe(QJsonObject &data, QJsonObject &ret) {
+    QString topic;
+    QSet<QString> keys;
+    if(m_currentClient && jCheckString(topic, data["topic"]) && (data["keys"].isUndefined() || jCheckTopicKeys(keys, data["keys"]))) {
+        QHash<QString, QSet<QString>> &subscriptions = m_subscriptions[m_currentClient];
+        auto subscribed = subscriptions.find(topic);
+        if (subscribed == subscriptions.end())
+            subscriptions.insert(topic, keys);
+        else if (keys.isEmpty())
+            subscribed->clear();                                    // all keys
+        else if (!subscribed->isEmpty())
+            subscribed->unite(keys);
+        ret["data"] = subscriptionsToJSON(subscriptions);
+        ret["error"] = noError();
+    } else {
+        ret["error"] = hasError("Parameters not accepted");
+    }
+}
+
+void Websocket::unsubscribe(QJsonObject &data, QJsonObject &ret) {
+    QString topic;
+    QSet<QString> keys;
+    if(!m_currentClient || !(data["keys"].isUndefined() || jCheckTopicKeys(keys, data["keys"]))) {
+        ret["error"] = hasError("Parameters not accepted");
+        return;
+    }
+    if (!jCheckString(topic, data["topic"])) {                     // no topic, back to all signals
+        m_subscriptions.remove(m_currentClient);
+        ret["data"] = QJsonObject();
+        ret["error"] = noError();
+        return;
+    }
+    auto subscriptions = m_subscriptions.find(m_currentClient);
+    if (subscriptions == m_subscriptions.end() || !subscriptions->contains(topic)) {
+        ret["error"] = hasError("Not subscribed to '" + topic + "'");
+        return;
+    }
+    QSet<QString> &subscribed = (*subscriptions)[topic];
+    if (!keys.isEmpty() && subscribed.isEmpty()) {
+        ret["error"] = hasError("Subscribed to all keys of '" + topic + "', unsubscribe the topic instead");
+        return;
+    }
+    subscribed.subtract(keys);
+    if (keys.isEmpty() || subscribed.isEmpty())
+        subscriptions->remove(topic);
+    ret["data"] = subscriptionsToJSON(*subscriptions);
+    ret["error"] = noError();
+}
+
 
 // Implementation-Functions for API-Signals
 void Websocket::regStateChanged(int accId, bool status){
@@ -927,7 +1316,7 @@ void Websocket::regStateChanged(int accId, bool status){
     data["status"] = status;
     obj["signal"] = "regStateChanged";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToAll(obj, "regStateChanged:" + QString::number(accId), QString::number(accId));
 }
 
 void Websocket::sipStatus(int accId, int status, QString remoteUri){
@@ -937,7 +1326,7 @@ void Websocket::sipStatus(int accId, int status, QString remoteUri){
     data["remoteUri"] = remoteUri;
     obj["signal"] = "sipStatus";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToAll(obj, QString(), QString::number(accId));
 }
 
 void Websocket::callStateChanged(int accID, int role, int callId, bool remoteofferer, long calldur, int state, int lastStatusCode, QString statustxt, QString remoteUri){
@@ -945,6 +1334,7 @@ void Websocket::callStateChanged(int accID, int role, int callId, bool remoteoff
     data["accId"] = accID;
     data["role"] = role;
     data["callId"] = callId;
+    data["callSeq"] = QJsonValue(m_lib->m_Log->callSeq(callId));
     data["remoteofferer"] = remoteofferer;
     data["calldur"] = QString::number(calldur);
     data["state"] = state;
@@ -953,17 +1343,18 @@ void Websocket::callStateChanged(int accID, int role, int callId, bool remoteoff
     data["remoteUri"] = remoteUri;
     obj["signal"] = "callStateChanged";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToAll(obj, QString(), QString::number(accID));
 }
 
 void Websocket::callInfo(int accId, int callId, QJsonObject callInfo){
     QJsonObject obj, data;
     data["accId"] = accId;
     data["callId"] = callId;
+    data["callSeq"] = QJsonValue(m_lib->m_Log->callSeq(callId));
     data["callInfo"] = callInfo;
     obj["signal"] = "callInfo";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToAll(obj, "callInfo:" + QString::number(accId) + ":" + QString::number(callId), QString::number(accId));
 }
 
 void Websocket::buddyStatus(QString buddyURI, int status){
@@ -972,7 +1363,7 @@ void Websocket::buddyStatus(QString buddyURI, int status){
     data["status"] = status;
     obj["signal"] = "buddyStatus";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToAll(obj, "buddyStatus:" + buddyURI, buddyURI);
 }
 
 void Websocket::BuddyEntryChanged(QList<s_buddy>* buddies){
@@ -984,7 +1375,7 @@ void Websocket::BuddyEntryChanged(QList<s_buddy>* buddies){
     data["buddies"] = buddyArr;
     obj["signal"] = "BuddyEntryChanged";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToAll(obj, "BuddyEntryChanged");
 }
 
 void Websocket::logMessage(QString msg){
@@ -998,13 +1389,17 @@ void Websocket::logMessage(QString msg){
 void Websocket::audioRoutesChanged(const QList<s_audioRoutes>& audioRoutes){
     QJsonObject obj, data;
     QJsonArray audioRoutesArr;
+    QHash<QString, QJsonObject> entries;
     for (auto & audioRoute: audioRoutes) {
-        audioRoutesArr.append(audioRoute.toJSON());
+        QJsonObject entry = audioRoute.toJSON();
+        audioRoutesArr.append(entry);
+        entries[collectionKey(audioRoute)] = entry;
     }
     data["audioRoutes"] = audioRoutesArr;
     obj["signal"] = "audioRoutesChanged";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToClients(obj, "audioRoutes", false, "audioRoutesChanged");
+    pushCollectionDelta("audioRoutes", entries);
 }
 
 void Websocket::confportLevelChanged(s_audioRoutes changedRoute){
@@ -1012,6 +1407,22 @@ void Websocket::confportLevelChanged(s_audioRoutes changedRoute){
     data["confportLevelChanged"] = changedRoute.toJSON();
     obj["signal"] = "confportLevelChanged";
     obj["data"] = data;
+    sendToAll(obj, "confportLevelChanged:" + QString::number(changedRoute.srcSlot) + ":" + QString::number(changedRoute.destSlot));
+}
+
+void Websocket::audioRoutesDiff(const QList<s_audioRoutes>& changedRoutes, const QList<s_audioRoutes>& removedRoutes){
+    QJsonObject obj, data;
+    QJsonArray changedArr, removedArr;
+    for (auto & audioRoute: changedRoutes) {
+        changedArr.append(audioRoute.toJSON());
+    }
+    for (auto & audioRoute: removedRoutes) {
+        removedArr.append(audioRoute.toJSON());
+    }
+    data["changed"] = changedArr;
+    data["removed"] = removedArr;
+    obj["signal"] = "audioRoutesDiff";
+    obj["data"] = data;
     sendToAll(obj);
 }
 
@@ -1020,31 +1431,48 @@ void Websocket::audioRoutesTableChanged(const s_audioPortList& portList){
     data["portList"] = portList.toJSON();
     obj["signal"] = "audioRoutesTableChanged";
     obj["data"] = data;
+    sendToAll(obj, "audioRoutesTableChanged");
+}
+
+void Websocket::audioPortsChanged(const s_audioPortList& changedPorts, const s_audioPortList& removedPorts){
+    QJsonObject obj, data;
+    data["changed"] = changedPorts.toJSON();
+    data["removed"] = removedPorts.toJSON();
+    obj["signal"] = "audioPortsChanged";
+    obj["data"] = data;
     sendToAll(obj);
 }
 
 void Websocket::AccountsChanged(QList <s_account>* Accounts){
     QJsonObject obj, data;
     QJsonArray accountsArr;
+    QHash<QString, QJsonObject> entries;
     for (auto & account : *Accounts) {
-        accountsArr.append(account.toJSON());
+        QJsonObject entry = account.toJSON();
+        accountsArr.append(entry);
+        entries[collectionKey(account)] = entry;
     }
     data["Accounts"] = accountsArr;
     obj["signal"] = "AccountsChanged";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToClients(obj, "Accounts", false, "AccountsChanged");
+    pushCollectionDelta("Accounts", entries);
 }
 
 void Websocket::gpioRoutesChanged(const QList<s_gpioRoute>& gpioRoutes){
     QJsonObject obj, data;
     QJsonArray gpioRoutesArr;
+    QHash<QString, QJsonObject> entries;
     for (auto & gpioRoute: gpioRoutes) {
-        gpioRoutesArr.append(gpioRoute.toJSON());
+        QJsonObject entry = gpioRoute.toJSON();
+        gpioRoutesArr.append(entry);
+        entries[collectionKey(gpioRoute)] = entry;
     }
     data["gpioRoutes"] = gpioRoutesArr;
     obj["signal"] = "gpioRoutesChanged";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToClients(obj, "gpioRoutes", false, "gpioRoutesChanged");
+    pushCollectionDelta("gpioRoutes", entries);
 }
 
 void Websocket::gpioRoutesTableChanged(const s_gpioPortList& portList){
@@ -1052,7 +1480,7 @@ void Websocket::gpioRoutesTableChanged(const s_gpioPortList& portList){
     data["portList"] = portList.toJSON();
     obj["signal"] = "gpioRoutesTableChanged";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToAll(obj, "gpioRoutesTableChanged");
 }
 
 void Websocket::gpioStatesChanged(const QMap<QString, bool> changedGpios)
@@ -1076,13 +1504,17 @@ void Websocket::gpioStatesChanged(const QMap<QString, bool> changedGpios)
 void Websocket::ioDevicesChanged(QList<s_IODevices> &IoDev){
     QJsonObject obj, data;
     QJsonArray audioDevArr;
+    QHash<QString, QJsonObject> entries;
     for (auto & device : IoDev) {
-        audioDevArr.append(device.toJSON());
+        QJsonObject entry = device.toJSON();
+        audioDevArr.append(entry);
+        entries[collectionKey(device)] = entry;
     }
     data["ioDevices"] = audioDevArr;
     obj["signal"] = "ioDevicesChanged";
     obj["data"] = data;
-    sendToAll(obj);
+    sendToClients(obj, "ioDevices", false, "ioDevicesChanged");
+    pushCollectionDelta("ioDevices", entries);
 }
 
 bool Websocket::objectFromString(const QString& in, QJsonObject &obj)
@@ -1103,9 +1535,254 @@ bool Websocket::objectFromString(const QString& in, QJsonObject &obj)
     return true;
 }
 
-void Websocket::sendToAll(QJsonObject &obj) {
+void Websocket::sendToAll(QJsonObject &obj, const QString &coalesceKey, const QString &topicKey) {
+    const QString topic = obj["signal"].toString();
+    QList<QWebSocket *> targets;
+    for (QWebSocket *pClient : qAsConst(m_clients)) {
+        if (isSubscribed(pClient, topic, topicKey))
+            targets.append(pClient);
+    }
+    if (targets.isEmpty())                                          // nobody is interested, skip the encoding
+        return;
     obj["error"] = noError();
+    sendEncoded(targets, obj, coalesceKey);
+}
+
+void Websocket::sendToClients(QJsonObject &obj, const QString &collection, bool deltaClients, const QString &coalesceKey) {
+    const QString topic = obj["signal"].toString();
+    QList<QWebSocket *> targets;
     for (QWebSocket *pClient : qAsConst(m_clients)) {
-        pClient->sendTextMessage(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+        if (m_deltaClients.value(pClient).contains(collection) == deltaClients && isSubscribed(pClient, topic))
+            targets.append(pClient);
     }
+    if (targets.isEmpty())
+        return;
+    obj["error"] = noError();
+    sendEncoded(targets, obj, coalesceKey);
+}
+
+bool Websocket::isSubscribed(QWebSocket *pClient, const QString &topic, const QString &topicKey) const {
+    auto subscriptions = m_subscriptions.constFind(pClient);
+    if (subscriptions == m_subscriptions.constEnd())                // clients without subscriptions get all signals
+        return true;
+    auto keys = subscriptions->constFind(topic);
+    if (keys == subscriptions->constEnd())
+        return false;
+    return keys->isEmpty() || topicKey.isEmpty() || keys->contains(topicKey);
+}
+
+void Websocket::sendEncoded(const QList<QWebSocket *> &targets, const QJsonObject &obj, const QString &coalesceKey) {
+    s_wsMessage textMessage, binaryMessage;                         // encode once per wire format for all clients
+    textMessage.coalesceKey = binaryMessage.coalesceKey = coalesceKey;
+    for (QWebSocket *pClient : targets) {
+        if (m_cborClients.contains(pClient)) {
+            if (binaryMessage.binary.isEmpty())
+                binaryMessage.binary = toCborMessage(obj);
+            sendToClient(pClient, binaryMessage);
+        } else {
+            if (textMessage.text.isEmpty())
+                textMessage.text = QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+            sendToClient(pClient, textMessage);
+        }
+    }
+}
+
+void Websocket::sendToClient(QWebSocket *pClient, const s_wsMessage &message) {
+    s_wsClientQueue &queue = m_clientQueues[pClient];
+    if (queue.messages.isEmpty() && queue.pendingBytes < WS_CLIENT_HIGHWATER) {
+        queue.pendingBytes += writeMessage(pClient, message);
+        return;
+    }
+    if (!message.coalesceKey.isEmpty()) {                           // a newer state replaces the queued one
+        for (int i = 0; i < queue.messages.size(); i++) {
+            if (queue.messages.at(i).coalesceKey == message.coalesceKey) {
+                queue.messages.removeAt(i);                         // appended again, so it stays behind the cborKeys it may use
+                break;
+            }
+        }
+    }
+    if (queue.messages.size() >= WS_CLIENT_MAXQUEUE) {             // drop the oldest signal, replies and cborKeys stay queued
+        for (int i = 0; i < queue.messages.size(); i++) {
+            if (!queue.messages.at(i).keep) {
+                queue.messages.removeAt(i);
+                queue.overflowed = true;
+                break;
+            }
+        }
+    }
+    queue.messages.append(message);
+}
+
+qint64 Websocket::writeMessage(QWebSocket *pClient, const s_wsMessage &message) {
+    // send*Message() returns the payload, bytesWritten() counts the frames on the wire: count wire bytes on both sides
+    qint64 payload;
+    if (!message.binary.isEmpty())
+        payload = pClient->sendBinaryMessage(message.binary);
+    else
+        payload = pClient->sendTextMessage(message.text);
+    qint64 wireBytes = payload;
+    for (qint64 frame = 0; frame < qMax(payload, qint64(1)); frame += WS_FRAME_SIZE) {
+        qint64 frameBytes = qMin(payload - frame, qint64(WS_FRAME_SIZE));
+        wireBytes += 2 + (frameBytes > 0xffff ? 8 : frameBytes > 125 ? 2 : 0);   // server frames are not masked
+    }
+    return wireBytes;
+}
+
+void Websocket::flushClientQueue(QWebSocket *pClient) {
+    s_wsClientQueue &queue = m_clientQueues[pClient];
+    if (queue.overflowed && queue.pendingBytes < WS_CLIENT_HIGHWATER) {
+        QJsonObject obj;
+        obj["signal"] = "messagesDropped";                          // the client has to fetch the state again, e.g. with resync
+        obj["data"] = QJsonObject();
+        obj["error"] = noError();
+        s_wsMessage message;
+        if (m_cborClients.contains(pClient))
+            message.binary = toCborMessage(obj);
+        else
+            message.text = QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+        queue.pendingBytes += writeMessage(pClient, message);
+        queue.overflowed = false;
+    }
+    while (!queue.messages.isEmpty() && queue.pendingBytes < WS_CLIENT_HIGHWATER) {
+        queue.pendingBytes += writeMessage(pClient, queue.messages.takeFirst());
+    }
+}
+
+QCborValue Websocket::jsonToCbor(const QJsonValue &value, QStringList &newKeys) {
+    switch (value.type()) {
+    case QJsonValue::Object: {
+        QCborMap map;
+        const QJsonObject obj = value.toObject();
+        for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+            int keyId = m_cborKeys.value(it.key(), -1);
+            if (keyId < 0 && m_cborKeyNames.size() < WS_CBOR_MAXKEYS && m_cborSchemaKeys.contains(it.key())) {
+                keyId = m_cborKeyNames.size();
+                m_cborKeys.insert(it.key(), keyId);
+                m_cborKeyNames.append(it.key());
+                newKeys.append(it.key());
+            }
+            if (keyId < 0)
+                map.insert(it.key(), jsonToCbor(it.value(), newKeys));     // data key or dictionary is full, keep the string key
+            else
+                map.insert(keyId, jsonToCbor(it.value(), newKeys));
+        }
+        return map;
+    }
+    case QJsonValue::Array: {
+        QCborArray array;
+        for (const auto & entry : value.toArray())
+            array.append(jsonToCbor(entry, newKeys));
+        return array;
+    }
+    case QJsonValue::Double: {
+        double number = value.toDouble();
+        if (qIsFinite(number) && qAbs(number) < 9.0e15 && number == qint64(number))   // JSON has no integers, CBOR encodes them much shorter
+            return QCborValue(qint64(number));
+        return QCborValue(number);
+    }
+    default:
+        return QCborValue::fromJsonValue(value);
+    }
+}
+
+QJsonValue Websocket::cborToJson(const QCborValue &value) {
+    if (value.isMap()) {
+        QJsonObject obj;
+        const QCborMap map = value.toMap();
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            QString key;
+            if (it.key().isInteger() && it.key().toInteger() >= 0 && it.key().toInteger() < m_cborKeyNames.size())
+                key = m_cborKeyNames.at(int(it.key().toInteger()));
+            else
+                key = it.key().toString();
+            obj[key] = cborToJson(it.value());
+        }
+        return obj;
+    }
+    if (value.isArray()) {
+        QJsonArray array;
+        for (const auto & entry : value.toArray())
+            array.append(cborToJson(entry));
+        return array;
+    }
+    return value.toJsonValue();
+}
+
+QByteArray Websocket::toCborMessage(const QJsonObject &obj) {
+    QStringList newKeys;
+    int first = m_cborKeyNames.size();
+    QCborValue message = jsonToCbor(obj, newKeys);
+    if (!newKeys.isEmpty()) {                                       // announce the new keys before they are used
+        QCborMap keysData, keysSignal, error;
+        keysData.insert(m_cborKeys.value("first"), first);
+        keysData.insert(m_cborKeys.value("keys"), QCborArray::fromStringList(newKeys));
+        error.insert(m_cborKeys.value("code"), false);
+        error.insert(m_cborKeys.value("string"), QStringLiteral("No Error"));
+        keysSignal.insert(m_cborKeys.value("signal"), QStringLiteral("cborKeys"));
+        keysSignal.insert(m_cborKeys.value("data"), keysData);
+        keysSignal.insert(m_cborKeys.value("error"), error);
+        s_wsMessage keysMessage;
+        keysMessage.keep = true;                                    // later messages use the keys, dropping it would break the dictionary
+        keysMessage.binary = keysSignal.toCborValue().toCbor();
+        for (QWebSocket *pClient : qAsConst(m_cborClients)) {
+            sendToClient(pClient, keysMessage);
+        }
+    }
+    return message.toCbor();
+}
+
+void Websocket::pushCollectionDelta(const QString &collection, const QHash<QString, QJsonObject> &entries) {
+    bool hasDeltaClient = false;
+    for (const auto & clientCollections : qAsConst(m_deltaClients))
+        hasDeltaClient |= clientCollections.contains(collection);
+    if (!hasDeltaClient) {                          // the state is built again from the next resync
+        m_collections.remove(collection);
+        return;
+    }
+    s_wsCollection &state = m_collections[collection];
+    QJsonObject added, updated;
+    QJsonArray removed;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        auto known = state.entries.constFind(it.key());
+        if (known == state.entries.constEnd())
+            added[it.key()] = it.value();
+        else if (known.value() != it.value())
+            updated[it.key()] = it.value();
+    }
+    for (auto it = state.entries.constBegin(); it != state.entries.constEnd(); ++it) {
+        if (!entries.contains(it.key()))
+            removed.append(it.key());
+    }
+    if (added.isEmpty() && updated.isEmpty() && removed.isEmpty())
+        return;
+    state.entries = entries;
+    state.version++;
+    QJsonObject obj, data;
+    data["collection"] = collection;
+    data["version"] = QJsonValue(qint64(state.version));
+    data["baseVersion"] = QJsonValue(qint64(state.version - 1));
+    data["added"] = added;
+    data["updated"] = updated;
+    data["removed"] = removed;
+    obj["signal"] = "collectionDelta";
+    obj["data"] = data;
+    sendToClients(obj, collection, true);
+}
+
+QHash<QString, QJsonObject> Websocket::collectionEntries(const QString &collection) {
+    QHash<QString, QJsonObject> entries;
+    if (collection == "audioRoutes") {
+        for (auto & route : m_lib->getAudioRoutes())
+            entries[collectionKey(route)] = route.toJSON();
+    } else if (collection == "Accounts") {
+        for (auto & account : *m_lib->getAccounts())
+            entries[collectionKey(account)] = account.toJSON();
+    } else if (collection == "ioDevices") {
+        for (auto & device : m_lib->getIoDevices())
+            entries[collectionKey(device)] = device.toJSON();
+    } else if (collection == "gpioRoutes") {
+        for (auto & route : m_lib->getGpioRoutes())
+            entries[collectionKey(route)] = route.toJSON();
+    }
+    return entries;
 }
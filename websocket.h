@@ -43,12 +43,54 @@
 
 #include <QObject>
 #include <QMetaObject>
+#include <QHash>
+#include <QSet>
+#include <QCborValue>
 #include "types.h"
 
 QT_FORWARD_DECLARE_CLASS(QWebSocketServer)
 QT_FORWARD_DECLARE_CLASS(QWebSocket)
 QT_FORWARD_DECLARE_CLASS(AWAHSipLib)
 
+class Websocket;
+typedef void (Websocket::*pCmdImplementationFn_t)(QJsonObject&, QJsonObject&);
+
+#define WS_CLIENT_HIGHWATER (1024 * 1024)          // bytes a client may have in flight before messages are queued
+#define WS_CLIENT_MAXQUEUE 500                      // queued signals per client, older ones are dropped. Replies are never dropped
+#define WS_FRAME_SIZE (512 * 1024)                  // outgoing frame size of QWebSocket (Qt default), for the bytes in flight
+#define WS_CBOR_MAXKEYS 4096                        // integer keys of the CBOR wire format, further keys stay strings
+
+/**
+ * @brief An encoded message, text for JSON clients or binary for CBOR clients
+ */
+struct s_wsMessage{
+    bool keep = false;                      // replies and cborKeys, they must reach the client
+    QString coalesceKey;
+    QString text;
+    QByteArray binary;
+};
+
+/**
+ * @brief Outbound queue of a client
+ * @details messages are queued while the socket has more than WS_CLIENT_HIGHWATER bytes in flight.
+ * Messages with the same coalesce key replace each other, so a slow client only gets the newest state
+ */
+struct s_wsClientQueue{
+    qint64 pendingBytes = 0;
+    QList<s_wsMessage> messages;
+    bool overflowed = false;
+};
+
+/**
+ * @brief State of a collection as last pushed to the delta clients
+ * @details collections are audioRoutes, Accounts, ioDevices and gpioRoutes. Every change
+ * increments the version, a client that misses a version has to call resync
+ */
+struct s_wsCollection{
+    quint64 version = 0;
+    QHash<QString, QJsonObject> entries;
+};
+
 class Websocket : public QObject
 {
     Q_OBJECT  
@@ -59,7 +101,9 @@ public:
 private slots:
     void onNewConnection();
     void processMessage(const QString &message);
+    void processBinaryMessage(const QByteArray &message);
     void socketDisconnected();
+    void socketBytesWritten(qint64 bytes);
 
     /**
      * Implementation-Functions for API-Command Executions
@@ -104,6 +148,7 @@ private slots:
     void connectConfPort(QJsonObject &data, QJsonObject &ret);
     void disconnectConfPort(QJsonObject &data, QJsonObject &ret);
     void changeConfPortLevel(QJsonObject &data, QJsonObject &ret);
+    void applyRouteBatch(QJsonObject &data, QJsonObject &ret);
     void addToneGen(QJsonObject &data, QJsonObject &ret);
     void getAudioDevices(QJsonObject &data, QJsonObject &ret);
     void getSoundDevID(QJsonObject &data, QJsonObject &ret);
@@ -135,8 +180,24 @@ private slots:
     void getGpioStates(QJsonObject &data, QJsonObject &ret);
 
     // Public API - Log
+
+    /**
+     * read the newest log lines, oldest first
+     * @param &data JSON-Object with the optional filters "offset" and "count" (default 500) for paging from the newest line,
+     * "level" (maximum log level), "from" and "to" (ms since epoch) and "contains" (case insensitive)
+     * @param &ret JSON-Object which contains Data and Error Object
+     */
     void readNewestLog(QJsonObject &data, QJsonObject &ret);
 
+    /**
+     * query the structured event log, it has to be enabled in the settings
+     * @param &data JSON-Object with the optional filters "from" and "to" (ms since epoch), "level" (maximum log level),
+     * "accId", "callId", "callSeq" (unique per call, callIds are reused), "subsystem", "contains" and "limit" (default 1000)
+     * the callSeq of a call is sent with callStateChanged, callInfo and the calls of an account
+     * @param &ret JSON-Object which contains Data ("events", the newest matches, newest first) and Error Object
+     */
+    void queryEventLog(QJsonObject &data, QJsonObject &ret);
+
     // Public API - MessageManager
     void sendDtmf(QJsonObject &data, QJsonObject &ret);
 
@@ -146,6 +207,45 @@ private slots:
     void getCodecPriorities(QJsonObject &data, QJsonObject &ret);
     void setCodecPriorities(QJsonObject &data, QJsonObject &ret);
     void getVersions(QJsonObject &data, QJsonObject &ret);
+    void getStartupTrace(QJsonObject &data, QJsonObject &ret);
+
+    /**
+     * use this function to switch a client to delta pushes
+     * the client gets the full state and version of the requested collections and from then on
+     * only collectionDelta signals instead of the full audioRoutesChanged, AccountsChanged, ioDevicesChanged and gpioRoutesChanged
+     * @param &data JSON-Object with an optional array "collections", default is all collections
+     * @param &ret JSON-Object which contains Data and Error Object
+     */
+    void resync(QJsonObject &data, QJsonObject &ret);
+
+    /**
+     * use this function to switch the wire format of a client between JSON text and CBOR binary messages
+     * CBOR messages use integer map keys, the reply contains the key dictionary in "keys" (index = key)
+     * keys added later are announced with a cborKeys signal {"first":index, "keys":[...]} before they are used
+     * cborKeys signals are never dropped, the dictionary stays complete after a messagesDropped signal
+     * commands can be sent as CBOR with integer or string keys in both formats
+     * @param &data JSON-Object with "format": "json" or "cbor"
+     * @param &ret JSON-Object which contains Data and Error Object
+     */
+    void setWireFormat(QJsonObject &data, QJsonObject &ret);
+
+    /**
+     * use this function to receive only the signals of interest
+     * a client without subscriptions receives all signals, after the first subscribe only the subscribed ones
+     * the topic is the signal name, e.g. gpioStatesChanged or collectionDelta
+     * callInfo, callStateChanged, regStateChanged and sipStatus can be filtered by accId, buddyStatus by buddy uri
+     * replies, messagesDropped and cborKeys are always sent
+     * @param &data JSON-Object with "topic" and an optional array "keys", without keys all keys are subscribed
+     * @param &ret JSON-Object which contains Data (the current subscriptions) and Error Object
+     */
+    void subscribe(QJsonObject &data, QJsonObject &ret);
+
+    /**
+     * use this function to remove a subscription
+     * @param &data JSON-Object with "topic" and an optional array "keys", without a topic the client receives all signals again
+     * @param &ret JSON-Object which contains Data (the current subscriptions) and Error Object
+     */
+    void unsubscribe(QJsonObject &data, QJsonObject &ret);
 
     /**
      * Implementation-Functions for API-Signals
@@ -161,7 +261,9 @@ public slots:
     void logMessage(QString msg);
     void audioRoutesChanged(const QList<s_audioRoutes>& audioRoutes);
     void audioRoutesTableChanged(const s_audioPortList& portList);
+    void audioPortsChanged(const s_audioPortList& changedPorts, const s_audioPortList& removedPorts);
     void confportLevelChanged(const s_audioRoutes changedRoute);
+    void audioRoutesDiff(const QList<s_audioRoutes>& changedRoutes, const QList<s_audioRoutes>& removedRoutes);
     void callInfo(int accId, int callId, QJsonObject callInfo);
     void AccountsChanged(QList <s_account>* Accounts);
     void gpioRoutesChanged(const QList<s_gpioRoute>& routes);
@@ -173,11 +275,61 @@ private:
     AWAHSipLib* m_lib;
     QWebSocketServer *m_pWebSocketServer;
     QList<QWebSocket *> m_clients;
+    QHash<QWebSocket *, QSet<QString>> m_deltaClients;      // the collections a client called resync for
+    QSet<QWebSocket *> m_cborClients;
+    QHash<QString, int> m_cborKeys;                          // CBOR key dictionary, shared by all clients
+    QStringList m_cborKeyNames;
+    QSet<QString> m_cborSchemaKeys;                          // the keys allowed in the dictionary, keys of entry maps stay strings
+    QHash<QWebSocket *, QHash<QString, QSet<QString>>> m_subscriptions;   // topic and keys per client, empty keys for all keys
+    QWebSocket *m_currentClient = nullptr;                  // the client whose command is executed
+    QMap<QString, s_wsCollection> m_collections;
+    QHash<QWebSocket *, s_wsClientQueue> m_clientQueues;
+    QHash<QString, pCmdImplementationFn_t> m_commands;      // command name to implementation, built once in the constructor
+    friend class TestStartup;                               // benchDispatch compares m_commands with the dispatch by name
+    void registerCommands();                                // every API command has to be registered here
     bool objectFromString(const QString& in, QJsonObject &obj);
-    void sendToAll(QJsonObject &obj);
 
-};
+    /**
+     * @brief send a signal to all clients, the JSON is encoded once
+     * @param obj the signal object
+     * @param coalesceKey messages with the same key replace each other in the queue of a slow client, empty for no coalescing
+     * @param topicKey the key for subscriptions filtered by key, e.g. the accId
+     */
+    void sendToAll(QJsonObject &obj, const QString &coalesceKey = QString(), const QString &topicKey = QString());
+    bool isSubscribed(QWebSocket *pClient, const QString &topic, const QString &topicKey = QString()) const;
+    void sendEncoded(const QList<QWebSocket *> &targets, const QJsonObject &obj, const QString &coalesceKey);
+    void sendToClient(QWebSocket *pClient, const s_wsMessage &message);
+    qint64 writeMessage(QWebSocket *pClient, const s_wsMessage &message);
+    void flushClientQueue(QWebSocket *pClient);
+    void executeCommand(QWebSocket *pSender, QJsonObject &jObj);
+    void sendReply(QWebSocket *pClient, const QJsonObject &ret);
+
+    /**
+     * @brief encode a message for the CBOR wire format
+     * @details keys that are not in the dictionary yet are added and announced to all CBOR clients first
+     * @param obj the message
+     * @return the encoded message
+     */
+    QByteArray toCborMessage(const QJsonObject &obj);
+    QCborValue jsonToCbor(const QJsonValue &value, QStringList &newKeys);
+    QJsonValue cborToJson(const QCborValue &value);
 
-typedef  bool (Websocket::*pCmdImplementationFn_t)(QWebSocket*, QJsonObject&);
+    /**
+     * @brief send to the clients with or without delta pushes
+     * @param obj the signal object
+     * @param collection the collection the signal is about
+     * @param deltaClients true to send to the clients that called resync for the collection, false for all others
+     */
+    void sendToClients(QJsonObject &obj, const QString &collection, bool deltaClients, const QString &coalesceKey = QString());
+
+    /**
+     * @brief compare a collection with the state last pushed and send a collectionDelta to the delta clients
+     * @param collection the name of the collection
+     * @param entries the current entries of the collection by key
+     */
+    void pushCollectionDelta(const QString &collection, const QHash<QString, QJsonObject> &entries);
+    QHash<QString, QJsonObject> collectionEntries(const QString &collection);
+
+};
 
 #endif // WEBSOCKET_H